@@ -1,39 +1,37 @@
 #include "A_Star_Pathfinding.h"
 
-#include <iostream>
-#include <set>
-#include <stack>
-#include <limits>
+#include <chrono>
 #include <ctime>
-#include <Windows.h>
 
-A_Star_Pathfinding::A_Star_Pathfinding(QWidget *parent)
-    : QMainWindow(parent)
+// Forwards what the search does to the view, and holds the search
+// while it is paused between steps
+class A_Star_Pathfinding::SolveObserver : public PathEngine::SearchObserver
 {
-    ui.setupUi(this);
+public:
+	explicit SolveObserver(A_Star_Pathfinding& window) : window(window) {}
 
-	ui.table->setRowCount(ROW);
-	ui.table->setColumnCount(COL);
-	
-	ui.table->horizontalHeader()->setVisible(false);
-	ui.table->verticalHeader()->setVisible(false);
+	void opened(Pair cell) override
+	{
+		window.pushEvent(CellEvent::Opened, cell);
+	}
 
-	ui.table->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
-	ui.table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+	bool expanded(Pair cell) override
+	{
+		window.pushEvent(CellEvent::Expanded, cell);
+		return window.waitForStep();
+	}
 
-	ui.table->horizontalHeader()->setDefaultSectionSize(1);
-	ui.table->verticalHeader()->setDefaultSectionSize(1);
+private:
+	A_Star_Pathfinding& window;
+};
 
-	ui.table->setShowGrid(false);
+A_Star_Pathfinding::A_Star_Pathfinding(QWidget *parent)
+    : QMainWindow(parent), mapSeed(uint64_t(time(nullptr))), solving(false), events(1 << 16), cancelRequested(false), stepBudget(-1)
+{
+    ui.setupUi(this);
 
-	for (int i = 0; i < ROW; i++)
-	{
-		for (int j = 0; j < COL; j++)
-		{
-			QTableWidgetItem* item = new QTableWidgetItem;
-			ui.table->setItem(i, j, item);
-		}
-	}
+	grid.resize(mazeRows, mazeCols);
+	ui.grid->setGridSize(grid.rows(), grid.cols());
 
 	messageBox = new QMessageBox;
 
@@ -41,642 +39,255 @@ A_Star_Pathfinding::A_Star_Pathfinding(QWidget *parent)
 
 	connect(ui.buttonSolve, &QPushButton::released, this, &A_Star_Pathfinding::onButtonSolveClicked);
 	connect(ui.buttonReset, &QPushButton::released, this, &A_Star_Pathfinding::onButtonResetClicked);
+	connect(ui.buttonCancel, &QPushButton::released, this, &A_Star_Pathfinding::onButtonCancelClicked);
+	connect(ui.buttonStep, &QPushButton::released, this, &A_Star_Pathfinding::onButtonStepClicked);
+	connect(&frameTimer, &QTimer::timeout, this, &A_Star_Pathfinding::onFrame);
 }
 
 
 A_Star_Pathfinding::~A_Star_Pathfinding()
 {
+	stopSolve();
 	delete messageBox;
 }
 
-// A Utility Function to check whether given cell (row, col) 
-// is a valid cell or not
-bool A_Star_Pathfinding::isValid(int row, int col)
+// The source and destination keep their own colour
+bool A_Star_Pathfinding::isEndpoint(int row, int col) const
 {
-	return (row >= 0) && (row < ROW) && (col >= 0) && (col < COL);
+	return (row == 0 && col == 0) || (row == grid.rows() - 1 && col == grid.cols() - 1);
 }
 
-// A Utility Function to check whether the given cell is 
-// blocked or not
-bool A_Star_Pathfinding::isUnBlocked(int grid[ROW][COL], int row, int col)
+// The cells were coloured as the search went, only the message is left
+void A_Star_Pathfinding::showResult(const PathEngine::SearchResult& result)
 {
-	return grid[row][col] == 1;
+	// The status, then what the search cost
+	QString message = QString("%1\n\n%2 cells expanded, %3 generated, %4 reinserted\nOpen list peak %5, %6 ms")
+		.arg(PathEngine::statusMessage(result.status))
+		.arg(result.expanded)
+		.arg(result.generated)
+		.arg(result.reinserted)
+		.arg(result.peakOpen)
+		.arg(result.searchMicros / 1000.0, 0, 'f', 3);
+
+	displayMessage(message);
 }
 
-// A Utility Function to check whether destination cell has 
-// been reached or not
-bool A_Star_Pathfinding::isDestination(int row, int col, Pair dest)
+void A_Star_Pathfinding::onButtonSolveClicked()
 {
-	return row == dest.first && col == dest.second;
-}
+	// A paused search carries on by itself
+	if (solving)
+	{
+		setStepBudget(-1);
+		return;
+	}
 
-// A Utility Function to calculate the 'h' heuristics
-double A_Star_Pathfinding::calculateHValue(int row, int col, Pair dest)
-{
-	// Return using the distance formula 
-	return ((double)sqrt((row - dest.first) * (row - dest.first) + (col - dest.second) * (col - dest.second)));
+	startSolve(false);
 }
 
-// A Utility Function to trace the path from the source 
-// to the destination
-void A_Star_Pathfinding::tracePath(cell cellDetails[ROW][COL], int grid[ROW][COL], Pair dest)
+// Starts a search, or lets a running one expand one more cell
+void A_Star_Pathfinding::onButtonStepClicked()
 {
-	int row = dest.first;
-	int col = dest.second;
+	if (!solving)
+		startSolve(true);
 
-	std::stack<Pair> Path;
+	setStepBudget(1);
+}
 
-	while (!(cellDetails[row][col].parent_i == row
-		&& cellDetails[row][col].parent_j == col))
+void A_Star_Pathfinding::onButtonCancelClicked()
+{
 	{
-		Path.push(std::make_pair(row, col));
-		int temp_row = cellDetails[row][col].parent_i;
-		int temp_col = cellDetails[row][col].parent_j;
-		row = temp_row;
-		col = temp_col;
+		std::lock_guard<std::mutex> lock(stepMutex);
+		cancelRequested = true;
 	}
 
-	Path.push(std::make_pair(row, col));
-	while (!Path.empty())
-	{
-		std::pair<int, int> p = Path.top();
-		grid[p.first][p.second] = 3;
-		Path.pop();
-	}
+	stepSignal.notify_all();
+}
 
+void A_Star_Pathfinding::onButtonResetClicked()
+{
+	// The solver reads the grid, it has to be gone first
+	stopSolve();
+
+	// 30% of the cells blocked. The seed is shown in the title, the
+	// same seed always gives the same maze
+	PathEngine::MapOptions options;
+	options.seed = mapSeed++;
+	options.obstacleDensity = 0.3;
+	generator.generate(grid.rows(), grid.cols(), options, grid);
+
+	// Make sure to set source and destination as unblocked cells, and
+	// join them to the rest so that there always is a path
+	grid.set(0, 0, 1);
+	grid.set(grid.rows() - 1, grid.cols() - 1, 1);
+	PathEngine::MapGenerator::connectRegions(grid);
+
+	setWindowTitle(QString("A_Star_Pathfinding - seed %1").arg(options.seed));
+	paintGrid();
+}
 
-	for (int i = 0; i < ROW; i++)
+// Blocked cells black, open ones white and the endpoints blue,
+// which also clears what an earlier search coloured. Only the image
+// of the grid view is written, it is uploaded once when repainted
+void A_Star_Pathfinding::paintGrid()
+{
+	for (int i = 0; i < grid.rows(); i++)
 	{
-		for (int j = 0; j < COL; j++)
+		for (int j = 0; j < grid.cols(); j++)
 		{
-			if (grid[i][j] == 3 && !((i == 0 && j == 0) || (i == ROW - 1 && j == COL - 1)))
-			{
-				updateBoxColor(i, j, QColor(0, 255, 0));
-			}
+			if (isEndpoint(i, j))
+				ui.grid->setCell(i, j, qRgb(0, 0, 255));
+			else if (!grid.isUnBlocked(i, j))
+				ui.grid->setCell(i, j, qRgb(0, 0, 0));
+			else
+				ui.grid->setCell(i, j, qRgb(255, 255, 255));
 		}
 	}
 
-	displayMessage("The destination cell is found!");
-
-	return;
+	ui.grid->update();
 }
 
-void A_Star_Pathfinding::aStarSearch(int grid[ROW][COL], Pair src, Pair dest)
+void A_Star_Pathfinding::startSolve(bool paused)
 {
-	// Either the source or the destination is invalid
-	if (!isValid(src.first, src.second) || !isValid(dest.first, dest.second))
-	{
-		displayMessage("Source or Destination is invalid.");
-		return;
-	}
-
-	// Either the source or the destination is blocked
-	if (!isUnBlocked(grid, src.first, src.second) || !isUnBlocked(grid, dest.first, dest.second))
-	{
-		displayMessage("Source or Destination is blocked.");
-		return;
-	}
+	paintGrid();
 
-	// If the destination cell is the same as source cell
-	if (isDestination(src.first, src.second, dest))
-	{
-		displayMessage("We are already at the destination.");
-		return;
-	}
+	cancelRequested = false;
+	stepBudget = paused ? 0 : -1;
+	solving = true;
 
-	// Create a closed list and initialise it to false which means 
-	// that no cell has been included yet 
-	// This closed list is implemented as a boolean 2D array 
-	bool closedList[ROW][COL];
-	memset(closedList, false, sizeof(closedList));
+	ui.buttonCancel->setEnabled(true);
+	frameTimer.start(frameMillis);
 
-	// Declare a 2D array of structure to hold the details 
-	// of that cell
-	cell cellDetails[ROW][COL];
+	solver = std::thread([this]()
+	{
+		// Source is the top-left corner
+		Pair src = std::make_pair(0, 0);
 
-	// Initializing all nodes to have infinite distance to destination (unknown distance), and -1 as parent node (unknown parent)
-	int i, j;
+		// Destination is the bottom-right corner
+		Pair dest = std::make_pair(grid.rows() - 1, grid.cols() - 1);
 
-	for (i = 0; i < ROW; i++)
-	{
-		for (j = 0; j < COL; j++)
-		{
-			cellDetails[i][j].f = FLT_MAX;
-			cellDetails[i][j].g = FLT_MAX;
-			cellDetails[i][j].h = FLT_MAX;
-			cellDetails[i][j].parent_i = -1;
-			cellDetails[i][j].parent_j = -1;
-		}
-	}
+		SolveObserver observer(*this);
 
-	// Initialising the parameters of the starting node
-	i = src.first, j = src.second;
-	cellDetails[i][j].f = 0.0;
-	cellDetails[i][j].g = 0.0;
-	cellDetails[i][j].h = 0.0;
-	cellDetails[i][j].parent_i = i;
-	cellDetails[i][j].parent_j = j;
-
-	/*
-	 Create an open list having information as-
-	 <f, <i, j>>
-	 where f = g + h,
-	 and i, j are the row and column index of that cell
-	 Note that 0 <= i < ROW & 0 <= j < COL
-	 This open list is implemented as a set of pair of pair.*/
-	std::set<pPair> openList;
-
-	// Put the starting node on the open list and set its 
-	// 'f' as 0
-	openList.insert(std::make_pair(0.0, std::make_pair(i, j)));
-
-	while (!openList.empty())
-	{
-		//Sleep(50);
-
-		pPair p = *openList.begin();
-
-		// Remove this vertex from the open list
-		openList.erase(openList.begin());
-
-		// Add this vertex to the closed list
-		i = p.second.first;
-		j = p.second.second;
-		closedList[i][j] = true;
-
-		/*
-		Generating all the 8 successor of this cell
-
-			N.W   N   N.E
-			  \   |   /
-			   \  |  /
-			W----Cell----E
-				 / | \
-			   /   |  \
-			S.W    S   S.E
-
-		Cell-->Popped Cell (i, j)
-		N -->  North       (i-1, j)
-		S -->  South       (i+1, j)
-		E -->  East        (i, j+1)
-		W -->  West           (i, j-1)
-		N.E--> North-East  (i-1, j+1)
-		N.W--> North-West  (i-1, j-1)
-		S.E--> South-East  (i+1, j+1)
-		S.W--> South-West  (i+1, j-1)*/
-
-		// To store the 'g', 'h' and 'f' of the 8 successors 
-		double gNew, hNew, fNew;
-
-		//----------- 1st Successor (North) ------------ 
-
-		// Only process this cell if this is a valid one 
-		if (isValid(i - 1, j))
-		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i - 1, j, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i - 1][j].parent_i = i;
-				cellDetails[i - 1][j].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i - 1][j] && isUnBlocked(grid, i - 1, j))
-			{
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i - 1, j, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i - 1][j].f == FLT_MAX ||
-					cellDetails[i - 1][j].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew,
-						std::make_pair(i - 1, j)));
-
-					// Update the details of this cell 
-					cellDetails[i - 1][j].f = fNew;
-					cellDetails[i - 1][j].g = gNew;
-					cellDetails[i - 1][j].h = hNew;
-					cellDetails[i - 1][j].parent_i = i;
-					cellDetails[i - 1][j].parent_j = j;
-
-					updateBoxColor(i - 1, j, QColor(255, 0, 0));
-				}
-			}
-		}
+		PathEngine::SearchOptions options;
+		options.observer = &observer;
 
-		//----------- 2nd Successor (South) ------------ 
+		// Starting the A* pathfinding algorithm. The result is written
+		// before Done is pushed, so the view can read it once Done arrives
+		solveResult = PathEngine::aStarSearch(grid, src, dest, options, searchContext);
 
-		// Only process this cell if this is a valid one 
-		if (isValid(i + 1, j))
-		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i + 1, j, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i + 1][j].parent_i = i;
-				cellDetails[i + 1][j].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i + 1][j] && isUnBlocked(grid, i + 1, j))
-			{
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i + 1, j, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i + 1][j].f == FLT_MAX ||
-					cellDetails[i + 1][j].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew, std::make_pair(i + 1, j)));
-					// Update the details of this cell 
-					cellDetails[i + 1][j].f = fNew;
-					cellDetails[i + 1][j].g = gNew;
-					cellDetails[i + 1][j].h = hNew;
-					cellDetails[i + 1][j].parent_i = i;
-					cellDetails[i + 1][j].parent_j = j;
-					updateBoxColor(i + 1, j, QColor(255, 0, 0));
-				}
-			}
-		}
+		for (const Pair& p : solveResult.path)
+			pushEvent(CellEvent::Path, p);
 
-		//----------- 3rd Successor (East) ------------ 
+		pushEvent(CellEvent::Done, src);
+	});
+}
 
-		// Only process this cell if this is a valid one 
-		if (isValid(i, j + 1))
-		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i, j + 1, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i][j + 1].parent_i = i;
-				cellDetails[i][j + 1].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i][j + 1] && isUnBlocked(grid, i, j + 1))
-			{
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i, j + 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i][j + 1].f == FLT_MAX ||
-					cellDetails[i][j + 1].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew,
-						std::make_pair(i, j + 1)));
-
-					// Update the details of this cell 
-					cellDetails[i][j + 1].f = fNew;
-					cellDetails[i][j + 1].g = gNew;
-					cellDetails[i][j + 1].h = hNew;
-					cellDetails[i][j + 1].parent_i = i;
-					cellDetails[i][j + 1].parent_j = j;
-					updateBoxColor(i, j + 1, QColor(255, 0, 0));
-				}
-			}
-		}
+// Called once Done arrived, the solver thread is about to end
+void A_Star_Pathfinding::finishSolve()
+{
+	frameTimer.stop();
+	solver.join();
+	solving = false;
+	ui.buttonCancel->setEnabled(false);
+}
 
-		//----------- 4th Successor (West) ------------ 
+// Cancels a running search and drops what it had not shown yet
+void A_Star_Pathfinding::stopSolve()
+{
+	if (!solving)
+		return;
 
-		// Only process this cell if this is a valid one 
-		if (isValid(i, j - 1))
-		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i, j - 1, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i][j - 1].parent_i = i;
-				cellDetails[i][j - 1].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i][j - 1] && isUnBlocked(grid, i, j - 1))
-			{
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i, j - 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i][j - 1].f == FLT_MAX ||
-					cellDetails[i][j - 1].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew,
-						std::make_pair(i, j - 1)));
-
-					// Update the details of this cell 
-					cellDetails[i][j - 1].f = fNew;
-					cellDetails[i][j - 1].g = gNew;
-					cellDetails[i][j - 1].h = hNew;
-					cellDetails[i][j - 1].parent_i = i;
-					cellDetails[i][j - 1].parent_j = j;
-					updateBoxColor(i, j - 1, QColor(255, 0, 0));
-				}
-			}
-		}
+	onButtonCancelClicked();
 
-		//----------- 5th Successor (North-East) ------------ 
+	CellEvent event;
+	for (;;)
+	{
+		if (!events.tryPop(event))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		else if (event.kind == CellEvent::Done)
+			break;
+	}
 
-		// Only process this cell if this is a valid one 
-		/*if (isValid(i - 1, j + 1))
-		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i - 1, j + 1, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i - 1][j + 1].parent_i = i;
-				cellDetails[i - 1][j + 1].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i - 1][j + 1] && isUnBlocked(grid, i - 1, j + 1))
-			{
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i - 1, j + 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i - 1][j + 1].f == FLT_MAX ||
-					cellDetails[i - 1][j + 1].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew,
-						std::make_pair(i - 1, j + 1)));
-
-					// Update the details of this cell 
-					cellDetails[i - 1][j + 1].f = fNew;
-					cellDetails[i - 1][j + 1].g = gNew;
-					cellDetails[i - 1][j + 1].h = hNew;
-					cellDetails[i - 1][j + 1].parent_i = i;
-					cellDetails[i - 1][j + 1].parent_j = j;
-					updateBoxColor(i - 1, j + 1, QColor(255, 0, 0));
-				}
-			}
-		}
+	finishSolve();
+}
 
-		//----------- 6th Successor (North-West) ------------ 
+void A_Star_Pathfinding::setStepBudget(int budget)
+{
+	{
+		std::lock_guard<std::mutex> lock(stepMutex);
+		stepBudget = budget;
+	}
 
-		// Only process this cell if this is a valid one 
-		if (isValid(i - 1, j - 1))
-		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i - 1, j - 1, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i - 1][j - 1].parent_i = i;
-				cellDetails[i - 1][j - 1].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i - 1][j - 1] && isUnBlocked(grid, i - 1, j - 1))
-			{
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i - 1, j - 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i - 1][j - 1].f == FLT_MAX ||
-					cellDetails[i - 1][j - 1].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew, std::make_pair(i - 1, j - 1)));
-					// Update the details of this cell 
-					cellDetails[i - 1][j - 1].f = fNew;
-					cellDetails[i - 1][j - 1].g = gNew;
-					cellDetails[i - 1][j - 1].h = hNew;
-					cellDetails[i - 1][j - 1].parent_i = i;
-					cellDetails[i - 1][j - 1].parent_j = j;
-					updateBoxColor(i - 1, j - 1, QColor(255, 0, 0));
-				}
-			}
-		}
+	stepSignal.notify_all();
+}
 
-		//----------- 7th Successor (South-East) ------------ 
+// Applies every event that arrived since the last frame. Only the
+// image changes here, the grid view is repainted once afterwards
+void A_Star_Pathfinding::onFrame()
+{
+	ui.grid->update();
 
-		// Only process this cell if this is a valid one 
-		if (isValid(i + 1, j + 1))
+	CellEvent event;
+	for (size_t i = 0; i < events.capacity() && events.tryPop(event); i++)
+	{
+		if (event.kind == CellEvent::Done)
 		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i + 1, j + 1, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i + 1][j + 1].parent_i = i;
-				cellDetails[i + 1][j + 1].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i + 1][j + 1] && isUnBlocked(grid, i + 1, j + 1))
-			{
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i + 1, j + 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i + 1][j + 1].f == FLT_MAX ||
-					cellDetails[i + 1][j + 1].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew,
-						std::make_pair(i + 1, j + 1)));
-
-					// Update the details of this cell 
-					cellDetails[i + 1][j + 1].f = fNew;
-					cellDetails[i + 1][j + 1].g = gNew;
-					cellDetails[i + 1][j + 1].h = hNew;
-					cellDetails[i + 1][j + 1].parent_i = i;
-					cellDetails[i + 1][j + 1].parent_j = j;
-					updateBoxColor(i + 1, j + 1, QColor(255, 0, 0));
-				}
-			}
+			finishSolve();
+			showResult(solveResult);
+			return;
 		}
 
-		//----------- 8th Successor (South-West) ------------ 
+		if (isEndpoint(event.row, event.col))
+			continue;
 
-		// Only process this cell if this is a valid one 
-		if (isValid(i + 1, j - 1))
-		{
-			// If the destination cell is the same as the 
-			// current successor 
-			if (isDestination(i + 1, j - 1, dest))
-			{
-				// Set the Parent of the destination cell 
-				cellDetails[i + 1][j - 1].parent_i = i;
-				cellDetails[i + 1][j - 1].parent_j = j;
-				tracePath(cellDetails, grid, dest);
-				return;
-			}
-
-			// If the successor is already on the closed 
-			// list or if it is blocked, then ignore it. 
-			// Else do the following 
-			else if (!closedList[i + 1][j - 1] && isUnBlocked(grid, i + 1, j - 1))
-			{
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i + 1, j - 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isnt on the open list, add it to 
-				// the open list. Make the current square 
-				// the parent of this square. Record the 
-				// f, g, and h costs of the square cell 
-				//                OR 
-				// If it is on the open list already, check 
-				// to see if this path to that square is better, 
-				// using 'f' cost as the measure. 
-				if (cellDetails[i + 1][j - 1].f == FLT_MAX ||
-					cellDetails[i + 1][j - 1].f > fNew)
-				{
-					openList.insert(std::make_pair(fNew,
-						std::make_pair(i + 1, j - 1)));
-
-					// Update the details of this cell 
-					cellDetails[i + 1][j - 1].f = fNew;
-					cellDetails[i + 1][j - 1].g = gNew;
-					cellDetails[i + 1][j - 1].h = hNew;
-					cellDetails[i + 1][j - 1].parent_i = i;
-					cellDetails[i + 1][j - 1].parent_j = j;
-					updateBoxColor(i + 1, j - 1, QColor(255, 0, 0));
-				}
-			}
-		}*/
+		// The frontier in red, cells already expanded paler behind it
+		if (event.kind == CellEvent::Opened)
+			updateBoxColor(event.row, event.col, QColor(255, 0, 0));
+		else if (event.kind == CellEvent::Expanded)
+			updateBoxColor(event.row, event.col, QColor(255, 160, 160));
+		else
+			updateBoxColor(event.row, event.col, QColor(0, 255, 0));
 	}
-
-	// When the destination cell is not found and the open 
-	// list is empty, then we conclude that we failed to 
-	// reach the destination cell. This may happen when the 
-	// there is no way to the destination cell (due to blockages) 
-	displayMessage("Failed to find the destination cell...");
-
-	return;
 }
 
-void A_Star_Pathfinding::onButtonSolveClicked()
+// Solver thread. When the queue is full the view is behind, wait for
+// it to catch up rather than drop cells. Once cancelled only Done
+// still matters
+void A_Star_Pathfinding::pushEvent(CellEvent::Kind kind, Pair cell)
 {
-	// Source is the top-left corner
-	Pair src = std::make_pair(0, 0);
+	const CellEvent event = { kind, cell.first, cell.second };
 
-	// Destination is the bottom-right corner 
-	Pair dest = std::make_pair(ROW - 1, COL - 1);
+	while (!events.tryPush(event))
+	{
+		if (kind != CellEvent::Done && cancelRequested.load(std::memory_order_relaxed))
+			return;
 
-	// Starting the A* pathfinding algorithm
-	aStarSearch(grid, src, dest);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
 }
 
-void A_Star_Pathfinding::onButtonResetClicked()
+// Solver thread, before each expansion: false to cancel the search,
+// waits while the step budget is spent
+bool A_Star_Pathfinding::waitForStep()
 {
-	// Using the rand() function to generate a random maze
-	time_t t;
-	srand((unsigned)time(&t));
-
-	for (int i = 0; i < ROW; i++) {
-		for (int j = 0; j < COL; j++) {
-			int r = rand() % 10;
-			if (r < 3) {
-				grid[i][j] = 0;
-				ui.table->item(i, j)->setBackground(QColor(0, 0, 0));
-			}
-			else {
-				grid[i][j] = 1;
-				ui.table->item(i, j)->setBackground(QColor(255, 255, 255));
-			}
-		}
-	}
+	// Running freely costs two relaxed loads per cell
+	if (stepBudget.load(std::memory_order_relaxed) < 0)
+		return !cancelRequested.load(std::memory_order_relaxed);
+
+	std::unique_lock<std::mutex> lock(stepMutex);
+	stepSignal.wait(lock, [this]() { return cancelRequested || stepBudget != 0; });
+
+	if (cancelRequested)
+		return false;
 
-	// Make sure to set source and destination as unblocked cells
-	grid[0][0] = 1;
-	ui.table->item(0, 0)->setBackground(QColor(0, 0, 255));
+	if (stepBudget > 0)
+		stepBudget--;
 
-	grid[ROW - 1][COL - 1] = 1;
-	ui.table->item(ROW - 1, COL - 1)->setBackground(QColor(0, 0, 255));
+	return true;
 }
 
 void A_Star_Pathfinding::updateBoxColor(int x, int y, QColor color)
 {
-	ui.table->item(x, y)->setBackground(color);
-	ui.table->repaint();
+	ui.grid->setCell(x, y, color.rgb());
 }
 
 void A_Star_Pathfinding::displayMessage(const QString& message)
@@ -5,11 +5,20 @@
 #include <QtWidgets/QMessageBox>
 #include <QtWidgets/QScrollBar>
 #include <QtWidgets/QPushButton>
-#include <QtWidgets/QTableWidgetItem>
-#include <QtWidgets/QHeaderView>
+#include <QtCore/QTimer>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
 
 #include "ui_A_Star_Pathfinding.h"
 
+#include "PathEngine/AStarSearch.h"
+#include "PathEngine/MapGenerator.h"
+#include "PathEngine/SpscQueue.h"
+
 class A_Star_Pathfinding : public QMainWindow
 {
     Q_OBJECT
@@ -19,41 +28,80 @@ public:
     ~A_Star_Pathfinding();
 
 private:
-#define ROW 38
-#define COL 40
+    // Size of the maze generated by the Reset button
+    static const int mazeRows = 38;
+    static const int mazeCols = 40;
 
     /* Description of the Grid-
      1--> The cell is not blocked
     0--> The cell is blocked */
-    int grid[ROW][COL];
+    PathEngine::Grid grid;
+
+    // Search memory reused by every Find Path click
+    PathEngine::SearchContext searchContext;
+
+    // Makes the maze of the Generate Maze button, from the next seed
+    PathEngine::MapGenerator generator;
+    uint64_t mapSeed;
 
     // Creating a shortcut for int, int pair type
-    typedef std::pair<int, int> Pair;
+    typedef PathEngine::Pair Pair;
 
-    // Creating a shortcut for pair<double, pair<int, int>> type
-    typedef std::pair<double, std::pair<int, int>> pPair;
+    QMessageBox* messageBox;
 
-    // A structure to hold the neccesary parameters
-    struct cell
+    // What the solver thread tells the view, one cell at a time
+    struct CellEvent
     {
-        int parent_i, parent_j;
-        double f, g, h;
+        enum Kind : uint8_t { Opened, Expanded, Path, Done };
+
+        Kind kind;
+        int row;
+        int col;
     };
 
-    QMessageBox* messageBox;
+    class SolveObserver;
+
+    // The view is brought up to date at most this often while solving
+    static const int frameMillis = 16;
+
+    /* A search runs on the solver thread and hands the cells it touches
+     to the view through the events queue, without taking a lock. The
+     view applies whatever has arrived once per frame, so the grid is
+     repainted at most once a frame however fast the search goes. When
+     the queue is full the solver waits for the next frame.
+     stepBudget is the number of cells the solver may still expand
+     before it pauses, or -1 while it runs freely. */
+    std::thread solver;
+    bool solving;
+    PathEngine::SpscQueue<CellEvent> events;
+    PathEngine::SearchResult solveResult;
+    std::atomic<bool> cancelRequested;
+    std::atomic<int> stepBudget;
+    std::mutex stepMutex;
+    std::condition_variable stepSignal;
+    QTimer frameTimer;
 
-    bool isValid(int row, int col);
-    bool isUnBlocked(int grid[ROW][COL], int row, int col);
-    bool isDestination(int row, int col, Pair dest);
-    double calculateHValue(int row, int col, Pair dest);
-    void tracePath(cell cellDetails[ROW][COL], int grid[ROW][COL], Pair dest);
-    void aStarSearch(int grid[ROW][COL], Pair src, Pair dest);
+    bool isEndpoint(int row, int col) const;
+    void showResult(const PathEngine::SearchResult& result);
     void updateBoxColor(int x, int y, QColor color);
     void displayMessage(const QString& message);
+    void paintGrid();
+
+    void startSolve(bool paused);
+    void finishSolve();
+    void stopSolve();
+    void setStepBudget(int budget);
+
+    // Called on the solver thread
+    void pushEvent(CellEvent::Kind kind, Pair cell);
+    bool waitForStep();
 
     Ui::A_Star_PathfindingClass ui;
 
 private slots:
     void onButtonSolveClicked();
     void onButtonResetClicked();
+    void onButtonCancelClicked();
+    void onButtonStepClicked();
+    void onFrame();
 };
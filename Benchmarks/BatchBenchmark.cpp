@@ -0,0 +1,47 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <thread>
+
+#include "../PathEngine/BatchSearch.h"
+
+// Runs one batch of random queries with 1, 2, 4, ... threads and prints
+// the throughput of each, to check how the batch API scales
+int runBatchBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 1024);
+	const int cols = intArgument(argc, argv, 1, 1024);
+	const int queryCount = intArgument(argc, argv, 2, 2000);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 3, 1));
+	const unsigned maxThreads = unsigned(intArgument(argc, argv, 4, int(std::thread::hardware_concurrency())));
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+
+	std::vector<PathEngine::PathQuery> queries;
+	for (const auto& query : makeRandomQueries(grid, queryCount, seed + 1))
+		queries.push_back(PathEngine::PathQuery{ query.first, query.second });
+
+	PathEngine::SearchOptions options;
+	options.openList = PathEngine::OpenListType::Bucket;
+
+	std::printf("%dx%d maze, %d queries, seed %u\n", rows, cols, queryCount, seed);
+	std::printf("%8s %10s %14s %8s\n", "threads", "total ms", "queries/s", "speedup");
+
+	double singleThreadMs = 0.0;
+
+	for (unsigned threads = 1; threads <= (maxThreads > 0 ? maxThreads : 1); threads *= 2)
+	{
+		PathEngine::BatchSearcher searcher(threads);
+
+		Stopwatch stopwatch;
+		std::vector<PathEngine::SearchResult> results = searcher.run(grid, queries, options);
+		double ms = stopwatch.elapsedMs();
+
+		if (threads == 1)
+			singleThreadMs = ms;
+
+		std::printf("%8u %10.1f %14.0f %8.2f\n", threads, ms, queryCount / (ms / 1000.0), singleThreadMs / ms);
+	}
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "../PathEngine/Grid.h"
+
+// Each benchmark is a sub-command of the Benchmarks executable and
+// gets the arguments that follow its name
+int runOpenListBenchmark(int argc, char* argv[]);
+int runHeuristicBenchmark(int argc, char* argv[]);
+int runBatchBenchmark(int argc, char* argv[]);
+int runReplanBenchmark(int argc, char* argv[]);
+int runLandmarkBenchmark(int argc, char* argv[]);
+int runMapFileBenchmark(int argc, char* argv[]);
+int runConvertMap(int argc, char* argv[]);
+int runScenarioBenchmark(int argc, char* argv[]);
+int runGenerateBenchmark(int argc, char* argv[]);
+int runComponentBenchmark(int argc, char* argv[]);
+int runPathBenchmark(int argc, char* argv[]);
+int runFlowFieldBenchmark(int argc, char* argv[]);
+int runPathCacheBenchmark(int argc, char* argv[]);
+int runHierarchicalBenchmark(int argc, char* argv[]);
+int runSearchCheck(int argc, char* argv[]);
+
+// A random maze like the one made by the Reset button of the window:
+// every cell is blocked with a 30% chance
+PathEngine::Grid makeRandomMaze(int rows, int cols, uint32_t seed);
+
+// Random pairs of unblocked cells
+std::vector<std::pair<PathEngine::Pair, PathEngine::Pair>> makeRandomQueries(const PathEngine::Grid& grid, int count, uint32_t seed);
+
+// Reads argument i as an integer, or returns fallback when it is missing
+int intArgument(int argc, char* argv[], int i, int fallback);
+
+// Wall clock time in milliseconds since the stopwatch was made
+class Stopwatch
+{
+public:
+	Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+	double elapsedMs() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
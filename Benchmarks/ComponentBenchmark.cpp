@@ -0,0 +1,70 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <random>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/Components.h"
+
+// Labels the regions of a random maze on one thread and on a pool, runs
+// the same queries with and without the labels, most of them without a
+// path at 30% blocked, then times updates of random cells
+int runComponentBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 1024);
+	const int cols = intArgument(argc, argv, 1, 1024);
+	const int queryCount = intArgument(argc, argv, 2, 200);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 3, 1));
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+	auto queries = makeRandomQueries(grid, queryCount, seed + 1);
+
+	std::printf("%dx%d maze, %d queries, seed %u\n", rows, cols, queryCount, seed);
+
+	PathEngine::ComponentMap components;
+
+	Stopwatch buildTime;
+	components.build(grid);
+	std::printf("%-18s %10.3f ms, %zu regions\n", "build", buildTime.elapsedMs(), components.componentCount());
+
+	PathEngine::ThreadPool pool;
+	Stopwatch parallelTime;
+	components.build(grid, &pool);
+	std::printf("%-18s %10.3f ms on %u threads\n", "build in parallel", parallelTime.elapsedMs(), pool.threadCount());
+
+	PathEngine::SearchContext context;
+	PathEngine::SearchOptions options;
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		options.components = pass == 0 ? nullptr : &components;
+		size_t noPath = 0, expanded = 0;
+
+		Stopwatch stopwatch;
+		for (const auto& query : queries)
+		{
+			PathEngine::SearchResult result = PathEngine::aStarSearch(grid, query.first, query.second, options, context);
+			noPath += result.status == PathEngine::SearchStatus::NoPath;
+			expanded += result.expanded;
+		}
+
+		std::printf("%-18s %10.3f ms, %zu without a path, %zu expanded\n", pass == 0 ? "queries" : "queries + regions", stopwatch.elapsedMs(), noPath, expanded);
+	}
+
+	// Flip random cells one at a time
+	std::mt19937 rng(seed + 2);
+	const int updateCount = 100000;
+
+	Stopwatch updateTime;
+	for (int i = 0; i < updateCount; i++)
+	{
+		const int row = int(rng() % uint32_t(rows)), col = int(rng() % uint32_t(cols));
+		grid.set(row, col, grid.get(row, col) == 0 ? 1 : 0);
+		components.update(grid, row, col);
+	}
+
+	const double updateMs = updateTime.elapsedMs();
+	std::printf("%-18s %10.3f us each, %zu regions after %d\n", "update", 1000.0 * updateMs / updateCount, components.componentCount(), updateCount);
+
+	return 0;
+}
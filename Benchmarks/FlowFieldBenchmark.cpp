@@ -0,0 +1,145 @@
+#include "Benchmarks.h"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/DistanceField.h"
+#include "../PathEngine/FlowFieldCache.h"
+
+// Sends agents from random cells of a maze to the nearest of a few exits,
+// once with a search each and once by following a flow field, and times
+// building the field on one thread and on a pool. Then sends each agent
+// to one of the exits through a FlowFieldCache, from every thread of the
+// pool, before and after random cells change
+int runFlowFieldBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 1024);
+	const int cols = intArgument(argc, argv, 1, 1024);
+	const int agentCount = intArgument(argc, argv, 2, 1000);
+	const int exitCount = intArgument(argc, argv, 3, 4);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 4, 1));
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+	auto queries = makeRandomQueries(grid, agentCount + exitCount, seed + 1);
+
+	std::vector<PathEngine::Pair> exits;
+	for (int i = 0; i < exitCount; i++)
+		exits.push_back(queries[size_t(agentCount + i)].second);
+
+	PathEngine::SearchOptions options;
+	options.allowDiagonal = true;
+
+	std::printf("%dx%d maze, %d agents, %d exits, seed %u\n", rows, cols, agentCount, exitCount, seed);
+
+	PathEngine::DistanceField field;
+
+	Stopwatch buildTime;
+	field.build(grid, exits.data(), exits.size(), options);
+	std::printf("%-18s %10.3f ms\n", "build", buildTime.elapsedMs());
+
+	PathEngine::ThreadPool pool;
+	PathEngine::DistanceField parallelField;
+
+	Stopwatch parallelTime;
+	parallelField.build(grid, exits.data(), exits.size(), options, &pool);
+	const double parallelMs = parallelTime.elapsedMs();
+
+	size_t differences = 0;
+	for (int row = 0; row < rows; row++)
+	{
+		for (int col = 0; col < cols; col++)
+		{
+			differences += field.distance(row, col) != parallelField.distance(row, col)
+				|| field.next(row, col) != parallelField.next(row, col);
+		}
+	}
+
+	std::printf("%-18s %10.3f ms on %u threads, %zu cells differ\n", "build in parallel", parallelMs, pool.threadCount(), differences);
+
+	PathEngine::SearchContext context;
+	size_t searchSteps = 0;
+
+	Stopwatch searchTime;
+	for (int i = 0; i < agentCount; i++)
+	{
+		PathEngine::SearchResult result = PathEngine::aStarSearchToAny(grid, queries[size_t(i)].first, exits.data(), exits.size(), options, context);
+		if (!result.path.empty())
+			searchSteps += result.path.size() - 1;
+	}
+
+	std::printf("%-18s %10.3f ms, %zu steps\n", "search each", searchTime.elapsedMs(), searchSteps);
+
+	size_t fieldSteps = 0;
+
+	Stopwatch followTime;
+	for (int i = 0; i < agentCount; i++)
+	{
+		PathEngine::Pair cell = queries[size_t(i)].first;
+		if (!field.reachable(cell.first, cell.second))
+			continue;
+
+		while (field.distance(cell.first, cell.second) != 0)
+		{
+			cell = field.next(cell.first, cell.second);
+			fieldSteps++;
+		}
+	}
+
+	std::printf("%-18s %10.3f ms, %zu steps\n", "follow field", followTime.elapsedMs(), fieldSteps);
+
+	// Fields built from inside the crowd run on the worker that asked
+	PathEngine::FlowFieldCache cache(options, size_t(exitCount), &pool);
+
+	auto crowd = [&](const char* name)
+	{
+		std::atomic<size_t> steps(0);
+		const size_t hitsBefore = cache.hits(), buildsBefore = cache.builds();
+
+		Stopwatch crowdTime;
+		pool.parallelFor(size_t(agentCount), 64, [&](size_t begin, size_t end, unsigned)
+		{
+			size_t taken = 0;
+
+			for (size_t i = begin; i < end; i++)
+			{
+				PathEngine::FlowFieldCache::Lease lease = cache.get(grid, exits[i % exits.size()]);
+				PathEngine::Pair cell = queries[i].first;
+				if (!lease || !grid.isUnBlocked(cell.first, cell.second) || !lease->reachable(cell.first, cell.second))
+					continue;
+
+				while (lease->distance(cell.first, cell.second) != 0)
+				{
+					cell = lease->next(cell.first, cell.second);
+					taken++;
+				}
+			}
+
+			steps.fetch_add(taken);
+		});
+
+		std::printf("%-18s %10.3f ms, %zu steps, %zu hits, %zu builds\n", name, crowdTime.elapsedMs(), steps.load(),
+			cache.hits() - hitsBefore, cache.builds() - buildsBefore);
+	};
+
+	crowd("crowd, cold cache");
+	crowd("crowd, warm cache");
+
+	// Flip random cells, the fields they leave as they were are kept
+	std::mt19937 rng(seed + 2);
+	const int changeCount = 10;
+
+	for (int i = 0; i < changeCount; i++)
+	{
+		const int row = int(rng() % uint32_t(rows)), col = int(rng() % uint32_t(cols));
+		grid.set(row, col, grid.get(row, col) == 0 ? 1 : 0);
+		cache.update(grid, row, col);
+	}
+
+	std::printf("%-18s %10d changes, %zu fields kept, %zu out of date\n", "edit", changeCount, cache.kept(), cache.invalidated());
+	crowd("crowd after edits");
+	std::printf("%-18s %10zu fields, %.1f MB\n", "cache", cache.size(), cache.bytes() / (1024.0 * 1024.0));
+
+	return 0;
+}
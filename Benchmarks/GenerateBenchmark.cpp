@@ -0,0 +1,96 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../PathEngine/MapGenerator.h"
+
+namespace
+{
+	bool parseMapType(const char* name, PathEngine::MapType& type)
+	{
+		const char* names[] = { "noise", "rooms", "maze", "terrain" };
+		const PathEngine::MapType types[] = { PathEngine::MapType::Noise, PathEngine::MapType::Rooms, PathEngine::MapType::Maze, PathEngine::MapType::Terrain };
+
+		for (int i = 0; i < 4; i++)
+		{
+			if (std::strcmp(name, names[i]) == 0)
+			{
+				type = types[i];
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+// Times making one map on 1, 2, 4... threads, checks every thread count
+// makes the same map and saves it as a map file when a path is given
+int runGenerateBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 4096);
+	const int cols = intArgument(argc, argv, 1, 4096);
+
+	PathEngine::MapOptions options;
+	if (argc > 2 && !parseMapType(argv[2], options.type))
+	{
+		std::printf("Unknown map type %s, expected noise, rooms, maze or terrain\n", argv[2]);
+		return 1;
+	}
+
+	options.seed = uint64_t(intArgument(argc, argv, 3, 1));
+	const unsigned maxThreads = unsigned(intArgument(argc, argv, 4, 8));
+	const std::string path = argc > 5 ? argv[5] : "";
+
+	// Water makes the terrain worth joining up
+	if (options.type == PathEngine::MapType::Terrain)
+		options.waterLevel = -0.2;
+
+	std::printf("%dx%d %s map, seed %llu\n", rows, cols, argc > 2 ? argv[2] : "noise", (unsigned long long)options.seed);
+	std::printf("%8s %10s %10s %8s\n", "threads", "ms", "joined ms", "same");
+
+	PathEngine::Grid first;
+
+	for (unsigned threads = 1; threads <= (maxThreads > 0 ? maxThreads : 1); threads *= 2)
+	{
+		PathEngine::MapGenerator generator(threads);
+		PathEngine::Grid grid, joined;
+
+		options.connected = false;
+		Stopwatch plainTime;
+		generator.generate(rows, cols, options, grid);
+		const double plainMs = plainTime.elapsedMs();
+
+		options.connected = true;
+		Stopwatch joinedTime;
+		generator.generate(rows, cols, options, joined);
+		const double joinedMs = joinedTime.elapsedMs();
+
+		if (threads == 1)
+			first = joined;
+
+		const bool same = std::memcmp(first.data(), joined.data(), joined.size()) == 0;
+		std::printf("%8u %10.1f %10.1f %8s\n", threads, plainMs, joinedMs, same ? "yes" : "NO");
+	}
+
+	size_t walkable = 0;
+	for (size_t i = 0; i < first.size(); i++)
+		walkable += first.data()[i] != 0;
+
+	std::printf("%.1f%% walkable, in one region\n", first.size() ? 100.0 * double(walkable) / double(first.size()) : 0.0);
+
+	if (!path.empty())
+	{
+		if (!first.save(path))
+		{
+			std::printf("Could not write %s\n", path.c_str());
+			return 1;
+		}
+
+		std::printf("Saved %s\n", path.c_str());
+	}
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+
+#include "../PathEngine/AStarSearch.h"
+
+// Runs the same queries with every heuristic and move cost and prints
+// the time, the cells expanded, and how much longer the paths are than
+// the optimal ones for the same moves
+int runHeuristicBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 1024);
+	const int cols = intArgument(argc, argv, 1, 1024);
+	const int queryCount = intArgument(argc, argv, 2, 200);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 3, 1));
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+	auto queries = makeRandomQueries(grid, queryCount, seed + 1);
+
+	using PathEngine::HeuristicType;
+	using PathEngine::MoveCostType;
+
+	struct Candidate
+	{
+		const char* name;
+		bool diagonal;
+		MoveCostType moveCost;
+		HeuristicType heuristic;
+		double weight;
+	};
+
+	// The first candidate of each kind of move is admissible and gives
+	// the optimal cost the others are compared with
+	const Candidate candidates[] =
+	{
+		{ "4 / manhattan", false, MoveCostType::Octile, HeuristicType::Manhattan, 1.0 },
+		{ "4 / euclidean", false, MoveCostType::Octile, HeuristicType::Euclidean, 1.0 },
+		{ "4 / manhattan*1.5", false, MoveCostType::Octile, HeuristicType::Manhattan, 1.5 },
+		{ "4 / manhattan*2", false, MoveCostType::Octile, HeuristicType::Manhattan, 2.0 },
+		{ "8 / octile", true, MoveCostType::Octile, HeuristicType::Octile, 1.0 },
+		{ "8 / euclidean", true, MoveCostType::Octile, HeuristicType::Euclidean, 1.0 },
+		{ "8 / chebyshev", true, MoveCostType::Octile, HeuristicType::Chebyshev, 1.0 },
+		{ "8 / manhattan", true, MoveCostType::Octile, HeuristicType::Manhattan, 1.0 },
+		{ "8 / octile*1.5", true, MoveCostType::Octile, HeuristicType::Octile, 1.5 },
+		{ "8 / octile*2", true, MoveCostType::Octile, HeuristicType::Octile, 2.0 },
+		{ "king / chebyshev", true, MoveCostType::Chebyshev, HeuristicType::Chebyshev, 1.0 },
+		{ "king / octile", true, MoveCostType::Chebyshev, HeuristicType::Octile, 1.0 },
+	};
+
+	PathEngine::SearchContext context;
+	std::vector<double> optimalCosts(queries.size(), 0.0);
+
+	std::printf("%dx%d maze, %d queries, seed %u\n", rows, cols, queryCount, seed);
+	std::printf("%-18s %10s %8s %14s %10s\n", "moves / h", "total ms", "found", "expanded", "cost +%");
+
+	for (size_t c = 0; c < sizeof(candidates) / sizeof(candidates[0]); c++)
+	{
+		const Candidate& candidate = candidates[c];
+		const bool baseline = c == 0 || candidates[c - 1].diagonal != candidate.diagonal || candidates[c - 1].moveCost != candidate.moveCost;
+
+		PathEngine::SearchOptions options;
+		options.allowDiagonal = candidate.diagonal;
+		options.moveCost = candidate.moveCost;
+		options.heuristic = candidate.heuristic;
+		options.heuristicWeight = candidate.weight;
+
+		size_t found = 0, expanded = 0;
+		double cost = 0.0, optimalCost = 0.0;
+		Stopwatch stopwatch;
+
+		for (size_t q = 0; q < queries.size(); q++)
+		{
+			PathEngine::SearchResult result = PathEngine::aStarSearch(grid, queries[q].first, queries[q].second, options, context);
+			expanded += result.expanded;
+
+			if (!result.found())
+				continue;
+
+			if (baseline)
+				optimalCosts[q] = result.cost;
+
+			found++;
+			cost += result.cost;
+			optimalCost += optimalCosts[q];
+		}
+
+		const double ms = stopwatch.elapsedMs();
+		const double excess = optimalCost > 0.0 ? 100.0 * (cost / optimalCost - 1.0) : 0.0;
+		std::printf("%-18s %10.1f %8zu %14zu %10.2f\n", candidate.name, ms, found, expanded, excess);
+	}
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/HierarchicalGraph.h"
+#include "../PathEngine/MapGenerator.h"
+
+// Builds the HPA* hierarchy of a large joined-up noise map (20% blocked)
+// and runs the same long queries on it and with plain A*, which also
+// gives the length of the shortest path to measure the hierarchy's by
+int runHierarchicalBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 8192);
+	const int cols = intArgument(argc, argv, 1, 8192);
+	const int queryCount = intArgument(argc, argv, 2, 20);
+	const int clusterSize = intArgument(argc, argv, 3, 32);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 4, 1));
+
+	PathEngine::MapOptions mapOptions;
+	mapOptions.seed = seed;
+	mapOptions.obstacleDensity = 0.2;
+	mapOptions.connected = true;
+
+	PathEngine::Grid grid;
+	PathEngine::MapGenerator generator;
+	generator.generate(rows, cols, mapOptions, grid);
+
+	auto queries = makeRandomQueries(grid, queryCount, seed + 1);
+
+	std::printf("%dx%d noise map, %d queries, clusters of %d, seed %u\n", rows, cols, queryCount, clusterSize, seed);
+
+	PathEngine::ThreadPool pool;
+	PathEngine::HierarchicalGraph hierarchy(clusterSize, true);
+
+	Stopwatch buildTime;
+	hierarchy.build(grid, &pool);
+	std::printf("build: %.1f ms on %u threads, %d levels, %zu clusters, %zu nodes, %zu edges\n", buildTime.elapsedMs(), pool.threadCount(),
+		hierarchy.levelCount(), hierarchy.clusterCount(), hierarchy.nodeCount(), hierarchy.edgeCount());
+
+	PathEngine::SearchContext context;
+	PathEngine::SearchOptions options;
+	options.allowDiagonal = true;
+
+	// Each search runs all the queries in a pass of its own, after one
+	// that grows the search memory, so neither is timed on caches the
+	// other just swept or on allocating
+	std::vector<PathEngine::SearchResult> abstract, shortest;
+	double hierarchyMs = 0.0, searchMs = 0.0;
+	size_t hierarchyExpanded = 0, searchExpanded = 0;
+
+	if (!queries.empty())
+		hierarchy.findPath(grid, queries[0].first, queries[0].second, context);
+
+	for (const auto& query : queries)
+	{
+		Stopwatch hierarchyTime;
+		abstract.push_back(hierarchy.findPath(grid, query.first, query.second, context));
+		hierarchyMs += hierarchyTime.elapsedMs();
+		hierarchyExpanded += abstract.back().expanded;
+	}
+
+	if (!queries.empty())
+		PathEngine::aStarSearch(grid, queries[0].first, queries[0].second, options, context);
+
+	for (const auto& query : queries)
+	{
+		Stopwatch searchTime;
+		shortest.push_back(PathEngine::aStarSearch(grid, query.first, query.second, options, context));
+		searchMs += searchTime.elapsedMs();
+		searchExpanded += shortest.back().expanded;
+	}
+
+	double excess = 0.0, worst = 0.0;
+	int found = 0;
+
+	for (size_t i = 0; i < queries.size(); i++)
+	{
+		if (abstract[i].found() && shortest[i].found() && shortest[i].cost > 0.0)
+		{
+			const double over = 100.0 * (abstract[i].cost - shortest[i].cost) / shortest[i].cost;
+			excess += over;
+			worst = over > worst ? over : worst;
+			found++;
+		}
+	}
+
+	const double count = queries.empty() ? 1.0 : double(queries.size());
+	std::printf("%12s %12s %14s\n", "search", "ms/query", "expanded/query");
+	std::printf("%12s %12.3f %14.0f\n", "HPA*", hierarchyMs / count, double(hierarchyExpanded) / count);
+	std::printf("%12s %12.3f %14.0f\n", "A*", searchMs / count, double(searchExpanded) / count);
+	std::printf("%d paths found by both, %.2f%% longer on average, %.2f%% at worst\n", found, found > 0 ? excess / found : 0.0, worst);
+
+	return 0;
+}
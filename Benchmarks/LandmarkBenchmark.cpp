@@ -0,0 +1,78 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <string>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/Landmarks.h"
+
+// Builds a landmark table for 4-connected and for octile moves, saves
+// it, maps it back in, and runs the same queries with the geometric
+// heuristic alone and with the ALT heuristic on top of it
+int runLandmarkBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 1024);
+	const int cols = intArgument(argc, argv, 1, 1024);
+	const int queryCount = intArgument(argc, argv, 2, 200);
+	const int landmarkCount = intArgument(argc, argv, 3, 16);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 4, 1));
+	const std::string path = argc > 5 ? argv[5] : "landmarks.bin";
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+	auto queries = makeRandomQueries(grid, queryCount, seed + 1);
+
+	std::printf("%dx%d maze, %d queries, %d landmarks, seed %u\n", rows, cols, queryCount, landmarkCount, seed);
+
+	PathEngine::SearchContext context;
+
+	for (int diagonal = 0; diagonal < 2; diagonal++)
+	{
+		PathEngine::SearchOptions options;
+		options.allowDiagonal = diagonal != 0;
+
+		Stopwatch buildTime;
+		PathEngine::LandmarkTable built;
+		built.build(grid, landmarkCount, options);
+		const double buildMs = buildTime.elapsedMs();
+
+		if (!built.save(path))
+		{
+			std::printf("Could not write %s\n", path.c_str());
+			return 1;
+		}
+
+		Stopwatch loadTime;
+		PathEngine::LandmarkTable table;
+		if (!table.load(path, grid))
+		{
+			std::printf("Could not load %s\n", path.c_str());
+			return 1;
+		}
+		const double loadMs = loadTime.elapsedMs();
+
+		std::printf("\n%s: build %.1f ms, load %.3f ms\n", diagonal ? "octile" : "4-connected", buildMs, loadMs);
+		std::printf("%-12s %10s %14s %10s\n", "heuristic", "total ms", "expanded", "cost");
+
+		for (int alt = 0; alt < 2; alt++)
+		{
+			options.landmarks = alt ? &table : nullptr;
+
+			size_t expanded = 0;
+			double cost = 0.0;
+			Stopwatch stopwatch;
+
+			for (const auto& query : queries)
+			{
+				PathEngine::SearchResult result = PathEngine::aStarSearch(grid, query.first, query.second, options, context);
+				expanded += result.expanded;
+				cost += result.cost;
+			}
+
+			const double ms = stopwatch.elapsedMs();
+			std::printf("%-12s %10.1f %14zu %10.1f\n", alt ? "ALT" : "geometric", ms, expanded, cost);
+		}
+	}
+
+	std::remove(path.c_str());
+	return 0;
+}
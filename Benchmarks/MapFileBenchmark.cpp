@@ -0,0 +1,109 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/MovingAI.h"
+
+namespace
+{
+	long long fileBytes(const std::string& path)
+	{
+		FILE* file = std::fopen(path.c_str(), "rb");
+		if (file == nullptr)
+			return -1;
+
+		std::fseek(file, 0, SEEK_END);
+		long long bytes = std::ftell(file);
+		std::fclose(file);
+		return bytes;
+	}
+}
+
+// Saves a random maze in both map file layouts and times loading them
+// against building the grid from a byte buffer, then runs one query on
+// the loaded grid, which is when its pages are first read
+int runMapFileBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 4096);
+	const int cols = intArgument(argc, argv, 1, 4096);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 2, 1));
+	const std::string path = argc > 3 ? argv[3] : "map.bin";
+
+	PathEngine::Grid maze = makeRandomMaze(rows, cols, seed);
+	maze.set(0, 0, 1);
+	maze.set(rows - 1, cols - 1, 1);
+
+	std::printf("%dx%d maze, seed %u\n", rows, cols, seed);
+
+	Stopwatch assignTime;
+	PathEngine::Grid assigned;
+	assigned.assign(maze.data(), rows, cols);
+	std::printf("%-12s %10.3f ms\n", "assign", assignTime.elapsedMs());
+
+	const PathEngine::MapLayout layouts[] = { PathEngine::MapLayout::Costs, PathEngine::MapLayout::Bits };
+	const char* names[] = { "costs", "bits" };
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (!maze.save(path, layouts[i]))
+		{
+			std::printf("Could not write %s\n", path.c_str());
+			return 1;
+		}
+
+		Stopwatch loadTime;
+		PathEngine::Grid loaded;
+		if (!loaded.load(path))
+		{
+			std::printf("Could not load %s\n", path.c_str());
+			return 1;
+		}
+		const double loadMs = loadTime.elapsedMs();
+
+		Stopwatch queryTime;
+		PathEngine::SearchResult result = PathEngine::aStarSearch(loaded, PathEngine::Pair(0, 0), PathEngine::Pair(rows - 1, cols - 1));
+		const double queryMs = queryTime.elapsedMs();
+
+		std::printf("%-12s %10.3f ms load, %8.1f ms first query (%zu expanded), %lld bytes\n", names[i], loadMs, queryMs, result.expanded, fileBytes(path));
+	}
+
+	std::remove(path.c_str());
+	return 0;
+}
+
+// Converts a MovingAI .map file into a map file
+int runConvertMap(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::printf("Usage: Benchmarks convert <input .map> <output> [bits]\n");
+		return 1;
+	}
+
+	const PathEngine::MapLayout layout = argc > 2 && std::strcmp(argv[2], "bits") == 0 ? PathEngine::MapLayout::Bits : PathEngine::MapLayout::Costs;
+
+	Stopwatch importTime;
+	PathEngine::Grid grid;
+	if (!PathEngine::importMovingAIMap(argv[0], grid))
+	{
+		std::printf("Could not read %s\n", argv[0]);
+		return 1;
+	}
+	const double importMs = importTime.elapsedMs();
+
+	if (!grid.save(argv[1], layout))
+	{
+		std::printf("Could not write %s\n", argv[1]);
+		return 1;
+	}
+
+	Stopwatch loadTime;
+	PathEngine::Grid loaded;
+	loaded.load(argv[1]);
+
+	std::printf("%dx%d: import %.1f ms, load %.3f ms\n", grid.rows(), grid.cols(), importMs, loadTime.elapsedMs());
+	return 0;
+}
@@ -0,0 +1,58 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+
+#include "../PathEngine/AStarSearch.h"
+
+// Runs the same queries on a large random maze with every open list
+// and prints the time and work each one needed
+int runOpenListBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 1024);
+	const int cols = intArgument(argc, argv, 1, 1024);
+	const int queryCount = intArgument(argc, argv, 2, 200);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 3, 1));
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+	auto queries = makeRandomQueries(grid, queryCount, seed + 1);
+
+	struct Candidate
+	{
+		const char* name;
+		PathEngine::OpenListType type;
+	};
+
+	const Candidate candidates[] =
+	{
+		{ "std::set", PathEngine::OpenListType::Set },
+		{ "4-ary heap", PathEngine::OpenListType::DaryHeap },
+		{ "bucket queue", PathEngine::OpenListType::Bucket },
+	};
+
+	// One context for every query, as a server would run them
+	PathEngine::SearchContext context;
+
+	std::printf("%dx%d maze, %d queries, seed %u\n", rows, cols, queryCount, seed);
+	std::printf("%-14s %10s %8s %14s %14s\n", "open list", "total ms", "found", "expanded", "generated");
+
+	for (const Candidate& candidate : candidates)
+	{
+		PathEngine::SearchOptions options;
+		options.openList = candidate.type;
+
+		size_t found = 0, expanded = 0, generated = 0;
+		Stopwatch stopwatch;
+
+		for (const auto& query : queries)
+		{
+			PathEngine::SearchResult result = PathEngine::aStarSearch(grid, query.first, query.second, options, context);
+			found += result.found() ? 1 : 0;
+			expanded += result.expanded;
+			generated += result.generated;
+		}
+
+		std::printf("%-14s %10.1f %8zu %14zu %14zu\n", candidate.name, stopwatch.elapsedMs(), found, expanded, generated);
+	}
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "Benchmarks.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "../PathEngine/AStarSearch.h"
+
+// Every allocation of the program is counted, so the benchmark can tell
+// how many a query makes
+namespace
+{
+	std::atomic<size_t> allocationCount(0);
+}
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* memory = std::malloc(size > 0 ? size : 1))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+// Runs the same queries with the path in SearchResult::path, in a buffer
+// of the caller's and as waypoints, and prints the time, the length of
+// the paths, the time taken to write them out and the allocations made
+// per query once the search memory has grown to the grid
+int runPathBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 1024);
+	const int cols = intArgument(argc, argv, 1, 1024);
+	const int queryCount = intArgument(argc, argv, 2, 500);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 3, 1));
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+	auto queries = makeRandomQueries(grid, queryCount, seed + 1);
+
+	std::vector<PathEngine::Pair> cells(grid.size());
+	PathEngine::PathBuffer buffer(cells.data(), cells.size());
+
+	PathEngine::SearchContext context;
+	PathEngine::SearchOptions options;
+	options.allowDiagonal = true;
+
+	// Grows the search memory, so that the passes below only measure
+	// what a query allocates
+	for (const auto& query : queries)
+		PathEngine::aStarSearch(grid, query.first, query.second, options, context);
+
+	std::printf("%dx%d maze, %d queries, seed %u\n", rows, cols, queryCount, seed);
+	std::printf("%-18s %10s %12s %16s %14s\n", "output", "ms", "mean cells", "reconstruct us", "allocs/query");
+
+	const char* names[] = { "result cells", "buffer cells", "buffer waypoints" };
+
+	for (int pass = 0; pass < 3; pass++)
+	{
+		options.pathBuffer = pass == 0 ? nullptr : &buffer;
+		options.pathFormat = pass == 2 ? PathEngine::PathFormat::Waypoints : PathEngine::PathFormat::Cells;
+
+		size_t length = 0;
+		double reconstructMicros = 0.0;
+		const size_t allocationsBefore = allocationCount.load();
+
+		Stopwatch stopwatch;
+		for (const auto& query : queries)
+		{
+			PathEngine::SearchResult result = PathEngine::aStarSearch(grid, query.first, query.second, options, context);
+			length += pass == 0 ? result.path.size() : buffer.size;
+			reconstructMicros += result.reconstructMicros;
+		}
+
+		const double ms = stopwatch.elapsedMs();
+		const size_t allocations = allocationCount.load() - allocationsBefore;
+
+		std::printf("%-18s %10.1f %12.1f %16.2f %14.2f\n", names[pass], ms, double(length) / queryCount,
+			reconstructMicros / queryCount, double(allocations) / queryCount);
+	}
+
+	return 0;
+}
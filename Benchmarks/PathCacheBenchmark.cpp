@@ -0,0 +1,139 @@
+#include "Benchmarks.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "../PathEngine/Components.h"
+#include "../PathEngine/PathCache.h"
+#include "../PathEngine/ThreadPool.h"
+
+namespace
+{
+	// The hits of one pass, the cache as it is after it
+	void printStats(const char* name, double ms, const PathEngine::PathCacheStats& before, const PathEngine::PathCacheStats& after)
+	{
+		PathEngine::PathCacheStats pass = after;
+		pass.hits -= before.hits;
+		pass.subpathHits -= before.subpathHits;
+		pass.misses -= before.misses;
+
+		std::printf("%-18s %10.1f ms, hit rate %.2f (%zu whole, %zu parts), %zu paths, %.1f KB\n", name, ms, pass.hitRate(),
+			pass.hits, pass.subpathHits, pass.paths, pass.bytes / 1024.0);
+	}
+
+	// Opening (0, 1) lets (0, 0) step diagonally to (1, 1), past the
+	// cell's corner without entering it. The cached path round it must go
+	bool openedCornerDropsPath()
+	{
+		PathEngine::Grid grid(3, 3);
+		grid.set(0, 1, 0);
+
+		PathEngine::SearchOptions options;
+		options.allowDiagonal = true;
+
+		PathEngine::PathCache cache(options, size_t(1) << 20);
+		PathEngine::SearchContext context;
+		cache.search(grid, PathEngine::Pair(0, 0), PathEngine::Pair(1, 1), context);
+
+		grid.set(0, 1, 1);
+		cache.update(grid, 0, 1);
+
+		const PathEngine::SearchResult result = cache.search(grid, PathEngine::Pair(0, 0), PathEngine::Pair(1, 1), context);
+		return result.path.size() == 2 && cache.stats().invalidated == 1;
+	}
+}
+
+// Runs a stream of queries between a few places of a maze, as units going
+// back and forth between bases do, without a cache and through a
+// PathCache, on one thread and on a pool, then again after random cells
+// change, checking every answer against a fresh search. Queries without
+// a path are not cached, the regions of the maze answer them
+int runPathCacheBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 512);
+	const int cols = intArgument(argc, argv, 1, 512);
+	const int queryCount = intArgument(argc, argv, 2, 2000);
+	const int placeCount = intArgument(argc, argv, 3, 16);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 4, 1));
+
+	PathEngine::Grid grid = makeRandomMaze(rows, cols, seed);
+	std::vector<PathEngine::Pair> places;
+	for (const auto& query : makeRandomQueries(grid, placeCount, seed + 1))
+		places.push_back(query.first);
+
+	std::mt19937 rng(seed + 2);
+	std::vector<std::pair<PathEngine::Pair, PathEngine::Pair>> queries;
+	for (int i = 0; i < queryCount; i++)
+		queries.push_back(std::make_pair(places[rng() % places.size()], places[rng() % places.size()]));
+
+	PathEngine::ComponentMap components;
+	components.build(grid);
+
+	PathEngine::SearchOptions options;
+	options.allowDiagonal = true;
+	options.components = &components;
+
+	std::printf("%dx%d maze, %d queries between %d places, seed %u\n", rows, cols, queryCount, placeCount, seed);
+
+	PathEngine::SearchContext context;
+
+	Stopwatch searchTime;
+	for (const auto& query : queries)
+		PathEngine::aStarSearch(grid, query.first, query.second, options, context);
+
+	std::printf("%-18s %10.1f ms\n", "no cache", searchTime.elapsedMs());
+
+	PathEngine::PathCache cache(options, size_t(64) << 20);
+
+	PathEngine::PathCacheStats before = cache.stats();
+	Stopwatch cachedTime;
+	for (const auto& query : queries)
+		cache.search(grid, query.first, query.second, context);
+
+	printStats("cache", cachedTime.elapsedMs(), before, cache.stats());
+
+	PathEngine::ThreadPool pool;
+	std::vector<PathEngine::SearchContext> contexts(pool.threadCount());
+
+	before = cache.stats();
+	Stopwatch parallelTime;
+	pool.parallelFor(queries.size(), 16, [&](size_t begin, size_t end, unsigned worker)
+	{
+		for (size_t i = begin; i < end; i++)
+			cache.search(grid, queries[i].first, queries[i].second, contexts[worker]);
+	});
+
+	printStats("cache, threads", parallelTime.elapsedMs(), before, cache.stats());
+
+	const int changeCount = 100;
+	for (int i = 0; i < changeCount; i++)
+	{
+		const int row = int(rng() % uint32_t(rows)), col = int(rng() % uint32_t(cols));
+		grid.set(row, col, grid.get(row, col) == 0 ? 1 : 0);
+		components.update(grid, row, col);
+		cache.update(grid, row, col);
+	}
+
+	before = cache.stats();
+	std::printf("%-18s %10d changes, %zu paths dropped, %zu kept\n", "edit", changeCount, before.invalidated, before.paths);
+
+	Stopwatch afterTime;
+	for (const auto& query : queries)
+		cache.search(grid, query.first, query.second, context);
+
+	printStats("cache after edits", afterTime.elapsedMs(), before, cache.stats());
+
+	size_t stale = 0;
+	for (const auto& query : queries)
+	{
+		const PathEngine::SearchResult cached = cache.search(grid, query.first, query.second, context);
+		const PathEngine::SearchResult fresh = PathEngine::aStarSearch(grid, query.first, query.second, options, context);
+		stale += cached.status != fresh.status || std::fabs(cached.cost - fresh.cost) > 1e-6;
+	}
+
+	const bool corner = openedCornerDropsPath();
+	std::printf("%-18s %10zu answers differ from a fresh search, opened corner %s\n", "check", stale, corner ? "dropped" : "KEPT");
+
+	return stale == 0 && corner ? 0 : 1;
+}
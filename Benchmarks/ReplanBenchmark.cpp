@@ -0,0 +1,123 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <random>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/Components.h"
+#include "../PathEngine/DStarLite.h"
+#include "../PathEngine/MapGenerator.h"
+
+// Walks an agent from one corner of a random maze to the other. After
+// every step a few cells close to the agent open or close, as if it
+// only discovered them on arrival, and the path is planned again both
+// incrementally with D* Lite and from scratch with A*. The maze is
+// joined up and no change cuts the agent off from its destination, so
+// every run walks the whole way whatever the seed
+int runReplanBenchmark(int argc, char* argv[])
+{
+	const int rows = intArgument(argc, argv, 0, 512);
+	const int cols = intArgument(argc, argv, 1, 512);
+	const int changesPerStep = intArgument(argc, argv, 2, 4);
+	const int radius = intArgument(argc, argv, 3, 8);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 4, 1));
+
+	PathEngine::MapOptions mapOptions;
+	mapOptions.seed = seed;
+	mapOptions.connected = true;
+
+	PathEngine::Grid grid;
+	PathEngine::MapGenerator generator;
+	generator.generate(rows, cols, mapOptions, grid);
+
+	PathEngine::Pair agent(0, 0);
+	const PathEngine::Pair dest(rows - 1, cols - 1);
+	grid.set(agent.first, agent.second, 1);
+	grid.set(dest.first, dest.second, 1);
+
+	// The corners may have been walled in
+	PathEngine::MapGenerator::connectRegions(grid);
+
+	PathEngine::ComponentMap components;
+	components.build(grid);
+
+	PathEngine::SearchOptions options;
+	options.allowDiagonal = true;
+
+	PathEngine::DStarLite planner(true);
+	PathEngine::SearchContext context;
+
+	std::mt19937 rng(seed + 1);
+	std::uniform_int_distribution<int> offset(-radius, radius);
+
+	double incrementalMs = 0.0;
+	double scratchMs = 0.0;
+	size_t incrementalExpanded = 0;
+	size_t scratchExpanded = 0;
+	int steps = 0;
+	int mismatches = 0;
+
+	std::printf("%dx%d maze, %d changes within %d cells per step, seed %u\n", rows, cols, changesPerStep, radius, seed);
+
+	Stopwatch firstPlan;
+	PathEngine::SearchResult planned = planner.plan(grid, agent, dest);
+	std::printf("initial plan: %.2f ms, %zu expanded\n", firstPlan.elapsedMs(), planned.expanded);
+
+	while (planned.found() && planned.path.size() > 1)
+	{
+		agent = planned.path[1];
+		steps++;
+
+		std::vector<PathEngine::Pair> changed;
+		for (int i = 0; i < changesPerStep; i++)
+		{
+			PathEngine::Pair cell(agent.first + offset(rng), agent.second + offset(rng));
+			if (!grid.isValid(cell.first, cell.second) || cell == agent || cell == dest)
+				continue;
+
+			const uint8_t before = grid.get(cell.first, cell.second);
+			grid.set(cell.first, cell.second, before ? 0 : 1);
+			components.update(grid, cell.first, cell.second);
+
+			// Blocking it would leave no way to the destination
+			if (!components.connected(agent, dest))
+			{
+				grid.set(cell.first, cell.second, before);
+				components.update(grid, cell.first, cell.second);
+				continue;
+			}
+
+			changed.push_back(cell);
+		}
+
+		Stopwatch incremental;
+		planner.update(grid, changed);
+		planned = planner.plan(grid, agent, dest);
+		incrementalMs += incremental.elapsedMs();
+		incrementalExpanded += planned.expanded;
+
+		Stopwatch scratch;
+		PathEngine::SearchResult fresh = PathEngine::aStarSearch(grid, agent, dest, options, context);
+		scratchMs += scratch.elapsedMs();
+		scratchExpanded += fresh.expanded;
+
+		if (fresh.status != planned.status || (fresh.found() && fresh.cost - planned.cost > 1e-6))
+			mismatches++;
+	}
+
+	if (steps == 0)
+	{
+		std::printf("no path: %s\n", PathEngine::statusMessage(planned.status));
+		return 1;
+	}
+
+	std::printf("%d steps, %s\n", steps, PathEngine::statusMessage(planned.status));
+	std::printf("%12s %10s %12s %14s\n", "planner", "total ms", "ms/step", "expanded/step");
+	std::printf("%12s %10.1f %12.3f %14.0f\n", "D* Lite", incrementalMs, incrementalMs / steps, double(incrementalExpanded) / steps);
+	std::printf("%12s %10.1f %12.3f %14.0f\n", "A*", scratchMs, scratchMs / steps, double(scratchExpanded) / steps);
+
+	if (mismatches > 0)
+		std::printf("%d steps where the two planners disagreed!\n", mismatches);
+
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/HierarchicalGraph.h"
+#include "../PathEngine/Landmarks.h"
+#include "../PathEngine/MovingAI.h"
+
+namespace
+{
+	// One way of answering the queries. setup runs once per map and is
+	// timed apart from the queries (building landmarks or clusters)
+	struct Mode
+	{
+		const char* name;
+		std::function<void(const PathEngine::Grid&)> setup;
+		std::function<PathEngine::SearchResult(const PathEngine::Grid&, PathEngine::Pair, PathEngine::Pair)> run;
+	};
+
+	struct Report
+	{
+		std::string map;
+		const char* mode;
+		size_t queries;
+		size_t found;
+		double setupMs;
+		double meanExpanded;
+		double meanPeakOpen;
+		double p50Us;
+		double p99Us;
+		double queriesPerSecond;
+		double meanExcess;
+		double maxExcess;
+	};
+
+	std::string directoryOf(const std::string& path)
+	{
+		const size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	// Scenario files name their map relative to themselves, or by a path
+	// from the root of the benchmark set
+	bool loadMap(const std::string& scenarioPath, const std::string& map, PathEngine::Grid& grid)
+	{
+		const std::string directory = directoryOf(scenarioPath);
+		const std::string fileName = map.substr(directoryOf(map).size());
+
+		return PathEngine::importMovingAIMap(directory + map, grid) ||
+			PathEngine::importMovingAIMap(directory + fileName, grid) ||
+			PathEngine::importMovingAIMap(map, grid);
+	}
+
+	double percentile(const std::vector<double>& sorted, double fraction)
+	{
+		return sorted.empty() ? 0.0 : sorted[size_t(fraction * double(sorted.size() - 1))];
+	}
+
+	std::string jsonString(const std::string& text)
+	{
+		std::string quoted = "\"";
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				quoted += '\\';
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	void printReport(const Report& report, bool json, bool first)
+	{
+		if (json)
+		{
+			std::printf("%s  { \"map\": %s, \"mode\": \"%s\", \"queries\": %zu, \"found\": %zu, \"setup_ms\": %.3f, "
+				"\"mean_expanded\": %.1f, \"mean_peak_open\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+				"\"queries_per_s\": %.1f, \"mean_excess_pct\": %.4f, \"max_excess_pct\": %.4f }",
+				first ? "" : ",\n", jsonString(report.map).c_str(), report.mode, report.queries, report.found, report.setupMs,
+				report.meanExpanded, report.meanPeakOpen, report.p50Us, report.p99Us,
+				report.queriesPerSecond, report.meanExcess, report.maxExcess);
+			return;
+		}
+
+		std::printf("%s,%s,%zu,%zu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.4f,%.4f\n",
+			report.map.c_str(), report.mode, report.queries, report.found, report.setupMs,
+			report.meanExpanded, report.meanPeakOpen, report.p50Us, report.p99Us,
+			report.queriesPerSecond, report.meanExcess, report.maxExcess);
+	}
+}
+
+// Runs every query of MovingAI scenario files with each search mode and
+// prints one line per map and mode, as CSV or as a JSON array. Costs are
+// compared with the optimal lengths in the scenarios, which are for
+// octile moves, so every mode moves diagonally. The any-angle modes cut
+// across them and come out shorter, with a negative excess
+int runScenarioBenchmark(int argc, char* argv[])
+{
+	bool json = false;
+	int first = 0;
+
+	if (argc > 0 && (std::strcmp(argv[0], "csv") == 0 || std::strcmp(argv[0], "json") == 0))
+	{
+		json = std::strcmp(argv[0], "json") == 0;
+		first = 1;
+	}
+
+	if (first >= argc)
+	{
+		std::printf("Usage: Benchmarks scen [csv|json] <file.scen>...\n");
+		return 1;
+	}
+
+	PathEngine::SearchContext context;
+	PathEngine::LandmarkTable landmarks;
+	PathEngine::HierarchicalGraph hierarchy(32, true);
+
+	auto options = [](PathEngine::SearchMode mode)
+	{
+		PathEngine::SearchOptions result;
+		result.mode = mode;
+		result.allowDiagonal = true;
+		return result;
+	};
+
+	auto search = [&context](PathEngine::SearchOptions searchOptions)
+	{
+		return [&context, searchOptions](const PathEngine::Grid& grid, PathEngine::Pair src, PathEngine::Pair dest)
+		{
+			return PathEngine::aStarSearch(grid, src, dest, searchOptions, context);
+		};
+	};
+
+	PathEngine::SearchOptions setList = options(PathEngine::SearchMode::AStar);
+	setList.openList = PathEngine::OpenListType::Set;
+
+	PathEngine::SearchOptions euclidean = options(PathEngine::SearchMode::AStar);
+	euclidean.heuristic = PathEngine::HeuristicType::Euclidean;
+
+	PathEngine::SearchOptions weighted = options(PathEngine::SearchMode::AStar);
+	weighted.heuristicWeight = 1.5;
+
+	PathEngine::SearchOptions oneThread = options(PathEngine::SearchMode::Bidirectional);
+	oneThread.parallelBidirectional = false;
+
+	PathEngine::SearchOptions alt = options(PathEngine::SearchMode::AStar);
+	alt.landmarks = &landmarks;
+
+	const Mode modes[] =
+	{
+		{ "astar", nullptr, search(options(PathEngine::SearchMode::AStar)) },
+		{ "astar-set", nullptr, search(setList) },
+		{ "euclidean", nullptr, search(euclidean) },
+		{ "weighted-1.5", nullptr, search(weighted) },
+		{ "jps", nullptr, search(options(PathEngine::SearchMode::JumpPoint)) },
+		{ "bidirectional", nullptr, search(options(PathEngine::SearchMode::Bidirectional)) },
+		{ "bidirectional-1t", nullptr, search(oneThread) },
+		{ "theta", nullptr, search(options(PathEngine::SearchMode::ThetaStar)) },
+		{ "lazy-theta", nullptr, search(options(PathEngine::SearchMode::LazyThetaStar)) },
+		{ "alt-16", [&](const PathEngine::Grid& grid) { landmarks.build(grid, 16, alt); }, search(alt) },
+		{ "hpa-32", [&](const PathEngine::Grid& grid) { hierarchy.build(grid); },
+			[&](const PathEngine::Grid& grid, PathEngine::Pair src, PathEngine::Pair dest) { return hierarchy.findPath(grid, src, dest, context); } },
+	};
+
+	if (json)
+		std::printf("[\n");
+	else
+		std::printf("map,mode,queries,found,setup_ms,mean_expanded,mean_peak_open,p50_us,p99_us,queries_per_s,mean_excess_pct,max_excess_pct\n");
+
+	bool firstReport = true;
+
+	for (int f = first; f < argc; f++)
+	{
+		std::vector<PathEngine::MovingAIScenario> scenarios;
+		if (!PathEngine::loadMovingAIScenarios(argv[f], scenarios))
+		{
+			std::fprintf(stderr, "Could not read %s\n", argv[f]);
+			return 1;
+		}
+
+		// A file usually holds the queries of one map, but need not
+		size_t begin = 0;
+		while (begin < scenarios.size())
+		{
+			size_t end = begin;
+			while (end < scenarios.size() && scenarios[end].map == scenarios[begin].map)
+				end++;
+
+			PathEngine::Grid grid;
+			if (!loadMap(argv[f], scenarios[begin].map, grid))
+			{
+				std::fprintf(stderr, "Could not read the map %s of %s\n", scenarios[begin].map.c_str(), argv[f]);
+				return 1;
+			}
+
+			for (const Mode& mode : modes)
+			{
+				Report report = Report();
+				report.map = scenarios[begin].map;
+				report.mode = mode.name;
+				report.queries = end - begin;
+
+				Stopwatch setupTime;
+				if (mode.setup)
+					mode.setup(grid);
+				report.setupMs = setupTime.elapsedMs();
+
+				std::vector<double> latencies;
+				size_t expanded = 0, peakOpen = 0, compared = 0;
+				double excess = 0.0;
+				Stopwatch total;
+
+				for (size_t q = begin; q < end; q++)
+				{
+					const PathEngine::MovingAIScenario& scenario = scenarios[q];
+
+					Stopwatch latency;
+					PathEngine::SearchResult result = mode.run(grid, scenario.src, scenario.dest);
+					latencies.push_back(latency.elapsedMs() * 1000.0);
+
+					expanded += result.expanded;
+					peakOpen += result.peakOpen;
+
+					if (!result.found() && result.status != PathEngine::SearchStatus::AlreadyAtDestination)
+						continue;
+
+					report.found++;
+
+					if (scenario.optimalLength > 0.0)
+					{
+						const double percent = 100.0 * (result.cost / scenario.optimalLength - 1.0);
+						excess += percent;
+						report.maxExcess = std::max(report.maxExcess, percent);
+						compared++;
+					}
+				}
+
+				const double totalMs = total.elapsedMs();
+				std::sort(latencies.begin(), latencies.end());
+
+				report.meanExpanded = report.queries ? double(expanded) / double(report.queries) : 0.0;
+				report.meanPeakOpen = report.queries ? double(peakOpen) / double(report.queries) : 0.0;
+				report.p50Us = percentile(latencies, 0.5);
+				report.p99Us = percentile(latencies, 0.99);
+				report.queriesPerSecond = totalMs > 0.0 ? 1000.0 * double(report.queries) / totalMs : 0.0;
+				report.meanExcess = compared ? excess / double(compared) : 0.0;
+
+				printReport(report, json, firstReport);
+				firstReport = false;
+			}
+
+			begin = end;
+		}
+	}
+
+	if (json)
+		std::printf("\n]\n");
+
+	return 0;
+}
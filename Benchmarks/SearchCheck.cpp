@@ -0,0 +1,435 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <random>
+
+#include "../PathEngine/AStarSearch.h"
+#include "../PathEngine/DStarLite.h"
+#include "../PathEngine/LineOfSight.h"
+#include "../PathEngine/ThreadPool.h"
+
+namespace
+{
+	// How the search is expected to move for a set of options. Terrain
+	// steps are summed as the same exact integers the search uses
+	struct Moves
+	{
+		bool diagonal;
+		bool terrain;
+		double straight;
+		double diagonalCost;
+		double scale;
+	};
+
+	Moves movesFor(const PathEngine::SearchOptions& options)
+	{
+		const bool anyAngle = options.mode == PathEngine::SearchMode::ThetaStar || options.mode == PathEngine::SearchMode::LazyThetaStar;
+
+		// Off terrain these always move in 8 directions at octile cost
+		const bool octileOnly = !options.terrainCosts && (options.mode == PathEngine::SearchMode::JumpPoint || anyAngle);
+
+		Moves moves;
+		moves.terrain = options.terrainCosts;
+		moves.diagonal = options.allowDiagonal || octileOnly;
+
+		const bool octile = moves.diagonal && (options.moveCost == PathEngine::MoveCostType::Octile || octileOnly);
+		const bool fixedPoint = octile && options.terrainCosts;
+
+		// Written out rather than taken from the engine, which is what is
+		// being checked: 1/1024ths of a step, sqrt(2) rounded up
+		moves.straight = fixedPoint ? 1024.0 : 1.0;
+		moves.diagonalCost = fixedPoint ? 1449.0 : octile ? std::sqrt(2.0) : 1.0;
+		moves.scale = fixedPoint ? 1024.0 : 1.0;
+		return moves;
+	}
+
+	double stepCost(const PathEngine::Grid& grid, const Moves& moves, PathEngine::Pair from, PathEngine::Pair to)
+	{
+		const bool diagonal = from.first != to.first && from.second != to.second;
+		const double length = diagonal ? moves.diagonalCost : moves.straight;
+		return moves.terrain ? length * grid.get(to.first, to.second) : length;
+	}
+
+	bool canStep(const PathEngine::Grid& grid, const Moves& moves, PathEngine::Pair from, PathEngine::Pair to)
+	{
+		const int dr = to.first - from.first, dc = to.second - from.second;
+		if (std::abs(dr) > 1 || std::abs(dc) > 1 || (dr == 0 && dc == 0) || !grid.isValid(to.first, to.second) || !grid.isUnBlocked(to.first, to.second))
+			return false;
+
+		if (dr == 0 || dc == 0)
+			return true;
+
+		// No cutting the corner of a blocked cell
+		return moves.diagonal && grid.isUnBlocked(from.first + dr, from.second) && grid.isUnBlocked(from.first, from.second + dc);
+	}
+
+	// Plain Dijkstra over the same moves, -1 without a path
+	double referenceCost(const PathEngine::Grid& grid, const Moves& moves, PathEngine::Pair src, PathEngine::Pair dest)
+	{
+		typedef std::pair<double, uint32_t> Item;
+
+		std::vector<double> distance(grid.size(), HUGE_VAL);
+		std::priority_queue<Item, std::vector<Item>, std::greater<Item>> open;
+
+		distance[grid.index(src.first, src.second)] = 0;
+		open.push(Item(0, grid.index(src.first, src.second)));
+
+		while (!open.empty())
+		{
+			const Item top = open.top();
+			open.pop();
+
+			if (top.first != distance[top.second])
+				continue;
+
+			const PathEngine::Pair cell = grid.position(top.second);
+			if (cell == dest)
+				return top.first / moves.scale;
+
+			for (int dr = -1; dr <= 1; dr++)
+			{
+				for (int dc = -1; dc <= 1; dc++)
+				{
+					const PathEngine::Pair next(cell.first + dr, cell.second + dc);
+					if (!canStep(grid, moves, cell, next))
+						continue;
+
+					const double g = top.first + stepCost(grid, moves, cell, next);
+					const uint32_t index = grid.index(next.first, next.second);
+					if (g < distance[index])
+					{
+						distance[index] = g;
+						open.push(Item(g, index));
+					}
+				}
+			}
+		}
+
+		return -1.0;
+	}
+
+	// Whether path is a walk of single moves from src to dest, or of
+	// straight and diagonal runs between waypoints, costing cost
+	bool validPath(const PathEngine::Grid& grid, const Moves& moves, const std::vector<PathEngine::Pair>& path, bool waypoints,
+		PathEngine::Pair src, PathEngine::Pair dest, double cost)
+	{
+		if (path.empty() || path.front() != src || path.back() != dest)
+			return false;
+
+		double sum = 0.0;
+		for (size_t i = 1; i < path.size(); i++)
+		{
+			const int dr = path[i].first - path[i - 1].first, dc = path[i].second - path[i - 1].second;
+			if (waypoints && dr != 0 && dc != 0 && std::abs(dr) != std::abs(dc))
+				return false;
+
+			const int steps = std::max(std::abs(dr), std::abs(dc));
+			if (steps == 0 || (!waypoints && steps > 1))
+				return false;
+
+			PathEngine::Pair at = path[i - 1];
+			for (int s = 0; s < steps; s++)
+			{
+				const PathEngine::Pair next(at.first + (dr > 0) - (dr < 0), at.second + (dc > 0) - (dc < 0));
+				if (!canStep(grid, moves, at, next))
+					return false;
+
+				sum += stepCost(grid, moves, at, next);
+				at = next;
+			}
+		}
+
+		return std::fabs(sum / moves.scale - cost) < 1e-6;
+	}
+
+	// Corners of an any-angle path in sight of each other, costing cost
+	bool validAnyAnglePath(const PathEngine::Grid& grid, const std::vector<PathEngine::Pair>& path, PathEngine::Pair src, PathEngine::Pair dest, double cost)
+	{
+		if (path.empty() || path.front() != src || path.back() != dest)
+			return false;
+
+		double length = 0.0;
+		for (size_t i = 1; i < path.size(); i++)
+		{
+			if (!PathEngine::lineOfSight(grid, path[i - 1], path[i]))
+				return false;
+
+			length += std::hypot(double(path[i].first - path[i - 1].first), double(path[i].second - path[i - 1].second));
+		}
+
+		return std::fabs(length - cost) < 1e-6;
+	}
+
+	PathEngine::Grid randomGrid(std::mt19937& rng, bool terrain)
+	{
+		const int rows = 4 + int(rng() % 40), cols = 4 + int(rng() % 40);
+		const uint32_t blocked = rng() % 40;
+
+		// Now and then costs up to 255, where the bucket queue gives way
+		// to the heap. A cheapest cost above 1 scales the heuristic
+		const uint32_t lowest = 1 + rng() % 3;
+		const uint32_t spread = rng() % 4 == 0 ? 256 - lowest : 8;
+
+		PathEngine::Grid grid(rows, cols);
+		for (int row = 0; row < rows; row++)
+		{
+			for (int col = 0; col < cols; col++)
+			{
+				const uint8_t value = rng() % 100 < blocked ? 0 : terrain ? uint8_t(lowest + rng() % spread) : 1;
+				grid.set(row, col, value);
+			}
+		}
+
+		return grid;
+	}
+
+	PathEngine::Pair randomCell(std::mt19937& rng, const PathEngine::Grid& grid)
+	{
+		return PathEngine::Pair(int(rng() % uint32_t(grid.rows())), int(rng() % uint32_t(grid.cols())));
+	}
+
+	const char* modeName(PathEngine::SearchMode mode)
+	{
+		switch (mode)
+		{
+		case PathEngine::SearchMode::JumpPoint:
+			return "jps";
+		case PathEngine::SearchMode::Bidirectional:
+			return "bidirectional";
+		case PathEngine::SearchMode::ThetaStar:
+			return "theta";
+		case PathEngine::SearchMode::LazyThetaStar:
+			return "lazy-theta";
+		case PathEngine::SearchMode::AStar:
+		default:
+			return "astar";
+		}
+	}
+
+	// The first failures are printed, the rest only counted
+	struct Failures
+	{
+		size_t count = 0;
+
+		void report(const char* what, const PathEngine::SearchOptions& options, PathEngine::Pair src, PathEngine::Pair dest, double expected, double got)
+		{
+			if (count++ < 20)
+			{
+				std::printf("FAIL %s: %s diagonal %d chebyshev %d terrain %d list %d waypoints %d, (%d, %d) to (%d, %d), expected %.4f got %.4f\n",
+					what, modeName(options.mode), int(options.allowDiagonal), int(options.moveCost == PathEngine::MoveCostType::Chebyshev),
+					int(options.terrainCosts), int(options.openList), int(options.pathFormat == PathEngine::PathFormat::Waypoints),
+					src.first, src.second, dest.first, dest.second, expected, got);
+			}
+		}
+	};
+
+	// Checks one search against the reference. Paths of a weighted search
+	// need only be within weight of the shortest, any-angle paths no
+	// longer than the shortest on the grid, or 10% longer for Lazy
+	// Theta*, which now and then gives up a shorter line
+	void checkQuery(const PathEngine::Grid& grid, const PathEngine::SearchOptions& options, PathEngine::Pair src, PathEngine::Pair dest,
+		PathEngine::SearchContext& context, Failures& failures)
+	{
+		const Moves moves = movesFor(options);
+		const double expected = referenceCost(grid, moves, src, dest);
+		const PathEngine::SearchResult result = PathEngine::aStarSearch(grid, src, dest, options, context);
+
+		if (expected < 0.0)
+		{
+			if (result.status != PathEngine::SearchStatus::NoPath)
+				failures.report("path where none exists", options, src, dest, expected, result.cost);
+			return;
+		}
+
+		if (!result.found())
+		{
+			failures.report("no path found", options, src, dest, expected, -1.0);
+			return;
+		}
+
+		const bool anyAngle = !options.terrainCosts &&
+			(options.mode == PathEngine::SearchMode::ThetaStar || options.mode == PathEngine::SearchMode::LazyThetaStar);
+
+		if (anyAngle)
+		{
+			if (!validAnyAnglePath(grid, result.path, src, dest, result.cost))
+				failures.report("invalid any-angle path", options, src, dest, expected, result.cost);
+			else if (result.cost > expected * options.heuristicWeight * (options.mode == PathEngine::SearchMode::LazyThetaStar ? 1.1 : 1.0) + 1e-6)
+				failures.report("any-angle path longer than the grid's", options, src, dest, expected, result.cost);
+			return;
+		}
+
+		if (!validPath(grid, moves, result.path, options.pathFormat == PathEngine::PathFormat::Waypoints, src, dest, result.cost))
+			failures.report("invalid path", options, src, dest, expected, result.cost);
+		else if (result.cost > expected * options.heuristicWeight + 1e-6 || result.cost < expected - 1e-6)
+			failures.report("wrong cost", options, src, dest, expected, result.cost);
+	}
+
+	// Walks an agent to its goal while random cells change, comparing every
+	// plan of D* Lite with the reference
+	void checkReplanning(std::mt19937& rng, Failures& failures, size_t& checked)
+	{
+		PathEngine::Grid grid = randomGrid(rng, false);
+		const bool diagonal = rng() % 2 == 0;
+
+		PathEngine::SearchOptions options;
+		options.allowDiagonal = diagonal;
+		const Moves moves = movesFor(options);
+
+		PathEngine::Pair agent = randomCell(rng, grid), dest = randomCell(rng, grid);
+		grid.set(agent.first, agent.second, 1);
+		grid.set(dest.first, dest.second, 1);
+
+		PathEngine::DStarLite planner(diagonal);
+
+		for (int step = 0; step < 40 && agent != dest; step++)
+		{
+			const PathEngine::SearchResult planned = planner.plan(grid, agent, dest);
+			const double expected = referenceCost(grid, moves, agent, dest);
+			checked++;
+
+			if (expected < 0.0 ? planned.found() : !planned.found() || std::fabs(planned.cost - expected) > 1e-6)
+			{
+				failures.report("D* Lite plan", options, agent, dest, expected, planned.found() ? planned.cost : -1.0);
+				return;
+			}
+
+			if (expected < 0.0)
+				return;
+
+			agent = planned.path[1];
+
+			std::vector<PathEngine::Pair> changed;
+			for (int i = 0; i < 3; i++)
+			{
+				const PathEngine::Pair cell = randomCell(rng, grid);
+				if (cell == agent || cell == dest)
+					continue;
+
+				grid.set(cell.first, cell.second, grid.get(cell.first, cell.second) ? 0 : 1);
+				changed.push_back(cell);
+			}
+
+			planner.update(grid, changed);
+		}
+	}
+}
+
+// Runs random queries on small random grids with every search mode,
+// open list, path format and kind of move, with and without terrain,
+// and checks each path and its cost against a plain Dijkstra. Then runs
+// two-threaded bidirectional searches from every thread of a pool at
+// once, and D* Lite through random changes. Exits 1 on any difference
+int runSearchCheck(int argc, char* argv[])
+{
+	const int gridCount = intArgument(argc, argv, 0, 200);
+	const uint32_t seed = uint32_t(intArgument(argc, argv, 1, 1));
+
+	const PathEngine::SearchMode modes[] =
+	{
+		PathEngine::SearchMode::AStar, PathEngine::SearchMode::JumpPoint, PathEngine::SearchMode::Bidirectional,
+		PathEngine::SearchMode::ThetaStar, PathEngine::SearchMode::LazyThetaStar
+	};
+
+	const PathEngine::OpenListType lists[] = { PathEngine::OpenListType::DaryHeap, PathEngine::OpenListType::Bucket, PathEngine::OpenListType::Set };
+
+	std::printf("%d grids, seed %u\n", gridCount, seed);
+
+	std::mt19937 rng(seed);
+	PathEngine::SearchContext context;
+	Failures failures;
+	size_t checked = 0;
+
+	Stopwatch queryTime;
+	for (int g = 0; g < gridCount; g++)
+	{
+		const bool terrain = g % 2 == 1;
+		const PathEngine::Grid grid = randomGrid(rng, terrain);
+
+		for (PathEngine::SearchMode mode : modes)
+		{
+			for (int moves = 0; moves < 3; moves++)
+			{
+				for (PathEngine::OpenListType list : lists)
+				{
+					for (int format = 0; format < 2; format++)
+					{
+						PathEngine::SearchOptions options;
+						options.mode = mode;
+						options.terrainCosts = terrain;
+						options.allowDiagonal = moves > 0;
+						options.moveCost = moves == 2 ? PathEngine::MoveCostType::Chebyshev : PathEngine::MoveCostType::Octile;
+						options.openList = list;
+						options.pathFormat = format == 1 ? PathEngine::PathFormat::Waypoints : PathEngine::PathFormat::Cells;
+						options.parallelBidirectional = g % 4 < 2;
+						options.heuristicWeight = g % 8 == 7 ? 1.5 : 1.0;
+
+						for (int i = 0; i < 4; i++)
+						{
+							const PathEngine::Pair src = randomCell(rng, grid), dest = randomCell(rng, grid);
+							if (src == dest || !grid.isUnBlocked(src.first, src.second) || !grid.isUnBlocked(dest.first, dest.second))
+								continue;
+
+							checkQuery(grid, options, src, dest, context, failures);
+							checked++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	std::printf("%-18s %10zu queries, %.1f ms\n", "modes", checked, queryTime.elapsedMs());
+
+	// Bidirectional searches with their second thread, many at once
+	PathEngine::ThreadPool pool(4);
+	std::vector<PathEngine::SearchContext> contexts(pool.threadCount());
+	std::vector<Failures> threadFailures(pool.threadCount());
+	std::atomic<size_t> threadChecked(0);
+
+	Stopwatch threadTime;
+	for (int g = 0; g < gridCount / 2 + 1; g++)
+	{
+		const PathEngine::Grid grid = randomGrid(rng, g % 2 == 1);
+		const uint32_t gridSeed = rng();
+
+		pool.parallelFor(1024, 16, [&](size_t begin, size_t end, unsigned worker)
+		{
+			std::mt19937 queryRng(gridSeed + uint32_t(begin));
+			for (size_t i = begin; i < end; i++)
+			{
+				PathEngine::SearchOptions options;
+				options.mode = PathEngine::SearchMode::Bidirectional;
+				options.terrainCosts = g % 2 == 1;
+				options.allowDiagonal = i % 2 == 0;
+
+				const PathEngine::Pair src = randomCell(queryRng, grid), dest = randomCell(queryRng, grid);
+				if (src == dest || !grid.isUnBlocked(src.first, src.second) || !grid.isUnBlocked(dest.first, dest.second))
+					continue;
+
+				checkQuery(grid, options, src, dest, contexts[worker], threadFailures[worker]);
+				threadChecked++;
+			}
+		});
+	}
+
+	for (const Failures& thread : threadFailures)
+		failures.count += thread.count;
+
+	std::printf("%-18s %10zu queries, %.1f ms on %u threads\n", "bidirectional", threadChecked.load(), threadTime.elapsedMs(), pool.threadCount());
+
+	size_t plans = 0;
+	Stopwatch replanTime;
+	for (int g = 0; g < gridCount; g++)
+		checkReplanning(rng, failures, plans);
+
+	std::printf("%-18s %10zu plans, %.1f ms\n", "D* Lite", plans, replanTime.elapsedMs());
+
+	std::printf("%zu failures\n", failures.count);
+	return failures.count == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+PathEngine::Grid makeRandomMaze(int rows, int cols, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	PathEngine::Grid grid(rows, cols);
+
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < cols; j++)
+		{
+			if (rng() % 10 < 3)
+				grid.set(i, j, 0);
+		}
+	}
+
+	return grid;
+}
+
+std::vector<std::pair<PathEngine::Pair, PathEngine::Pair>> makeRandomQueries(const PathEngine::Grid& grid, int count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> row(0, grid.rows() - 1);
+	std::uniform_int_distribution<int> col(0, grid.cols() - 1);
+
+	auto randomFreeCell = [&]()
+	{
+		for (;;)
+		{
+			PathEngine::Pair p(row(rng), col(rng));
+			if (grid.isUnBlocked(p.first, p.second))
+				return p;
+		}
+	};
+
+	std::vector<std::pair<PathEngine::Pair, PathEngine::Pair>> queries;
+	for (int i = 0; i < count; i++)
+	{
+		PathEngine::Pair src = randomFreeCell();
+		queries.push_back(std::make_pair(src, randomFreeCell()));
+	}
+
+	return queries;
+}
+
+int intArgument(int argc, char* argv[], int i, int fallback)
+{
+	return i < argc ? std::atoi(argv[i]) : fallback;
+}
+
+static void printUsage()
+{
+	std::printf("Usage: Benchmarks <benchmark> [arguments]\n");
+	std::printf("  openlist [rows] [cols] [queries] [seed]\n");
+	std::printf("  heuristics [rows] [cols] [queries] [seed]\n");
+	std::printf("  batch [rows] [cols] [queries] [seed] [max threads]\n");
+	std::printf("  replan [rows] [cols] [changes per step] [radius] [seed]\n");
+	std::printf("  landmarks [rows] [cols] [queries] [landmarks] [seed] [file]\n");
+	std::printf("  mapfile [rows] [cols] [seed] [file]\n");
+	std::printf("  convert <input .map> <output> [bits]\n");
+	std::printf("  scen [csv|json] <file.scen>...\n");
+	std::printf("  generate [rows] [cols] [noise|rooms|maze|terrain] [seed] [max threads] [file]\n");
+	std::printf("  components [rows] [cols] [queries] [seed]\n");
+	std::printf("  paths [rows] [cols] [queries] [seed]\n");
+	std::printf("  flowfield [rows] [cols] [agents] [exits] [seed]\n");
+	std::printf("  pathcache [rows] [cols] [queries] [places] [seed]\n");
+	std::printf("  hierarchical [rows] [cols] [queries] [cluster size] [seed]\n");
+	std::printf("  check [grids] [seed]\n");
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (std::strcmp(argv[1], "openlist") == 0)
+		return runOpenListBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "heuristics") == 0)
+		return runHeuristicBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "batch") == 0)
+		return runBatchBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "replan") == 0)
+		return runReplanBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "landmarks") == 0)
+		return runLandmarkBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "mapfile") == 0)
+		return runMapFileBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "convert") == 0)
+		return runConvertMap(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "scen") == 0)
+		return runScenarioBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "generate") == 0)
+		return runGenerateBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "components") == 0)
+		return runComponentBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "paths") == 0)
+		return runPathBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "flowfield") == 0)
+		return runFlowFieldBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "pathcache") == 0)
+		return runPathCacheBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "hierarchical") == 0)
+		return runHierarchicalBenchmark(argc - 2, argv + 2);
+
+	if (std::strcmp(argv[1], "check") == 0)
+		return runSearchCheck(argc - 2, argv + 2);
+
+	printUsage();
+	return 1;
+}
@@ -0,0 +1,131 @@
+#include "GridView.h"
+
+#include <QtGui/QMouseEvent>
+#include <QtGui/QPainter>
+#include <QtGui/QPaintEvent>
+#include <QtGui/QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Widget pixels per cell when zoomed all the way in
+	const double maxScale = 64.0;
+}
+
+GridView::GridView(QWidget* parent)
+	: QWidget(parent), scale(1.0), fitted(true), panning(false)
+{
+	// Every pixel is painted, Qt need not clear the widget first
+	setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void GridView::setGridSize(int rows, int cols, QRgb color)
+{
+	image = QImage(cols, rows, QImage::Format_RGB32);
+	image.fill(color);
+	fitToView();
+}
+
+void GridView::fitToView()
+{
+	fitted = true;
+
+	if (image.isNull())
+		return;
+
+	scale = std::min(double(width()) / image.width(), double(height()) / image.height());
+	offset = QPointF((width() - scale * image.width()) / 2.0, (height() - scale * image.height()) / 2.0);
+	update();
+}
+
+// Only the cells inside the repainted rectangle are drawn, one pixel of
+// the image scaled up to each of them
+void GridView::paintEvent(QPaintEvent* event)
+{
+	QPainter painter(this);
+	painter.fillRect(event->rect(), palette().window());
+
+	if (image.isNull() || scale <= 0.0)
+		return;
+
+	const QRectF area = event->rect();
+
+	const int firstCol = std::max(0, int(std::floor((area.left() - offset.x()) / scale)));
+	const int firstRow = std::max(0, int(std::floor((area.top() - offset.y()) / scale)));
+	const int endCol = std::min(image.width(), int(std::ceil((area.right() - offset.x()) / scale)) + 1);
+	const int endRow = std::min(image.height(), int(std::ceil((area.bottom() - offset.y()) / scale)) + 1);
+
+	if (firstCol >= endCol || firstRow >= endRow)
+		return;
+
+	const QRectF source(firstCol, firstRow, endCol - firstCol, endRow - firstRow);
+	const QRectF target(offset.x() + firstCol * scale, offset.y() + firstRow * scale, source.width() * scale, source.height() * scale);
+
+	painter.drawImage(target, image, source);
+}
+
+void GridView::resizeEvent(QResizeEvent* event)
+{
+	QWidget::resizeEvent(event);
+
+	if (fitted)
+		fitToView();
+}
+
+// Zooms around the cursor, so the cell under it stays there. The grid
+// can shrink to a quarter of the size that fits the widget
+void GridView::wheelEvent(QWheelEvent* event)
+{
+	if (image.isNull())
+		return;
+
+	const double fitScale = std::min(double(width()) / image.width(), double(height()) / image.height());
+	const double factor = std::pow(1.25, event->angleDelta().y() / 120.0);
+	const double newScale = std::max(fitScale / 4.0, std::min(maxScale, scale * factor));
+
+	const QPointF cursor = event->position();
+	offset = cursor - (cursor - offset) * (newScale / scale);
+	scale = newScale;
+	fitted = false;
+
+	update();
+	event->accept();
+}
+
+void GridView::mousePressEvent(QMouseEvent* event)
+{
+	if (event->button() == Qt::LeftButton || event->button() == Qt::MiddleButton)
+	{
+		panning = true;
+		lastMouse = event->position();
+		setCursor(Qt::ClosedHandCursor);
+	}
+}
+
+void GridView::mouseMoveEvent(QMouseEvent* event)
+{
+	if (!panning)
+		return;
+
+	offset += event->position() - lastMouse;
+	lastMouse = event->position();
+	fitted = false;
+	update();
+}
+
+void GridView::mouseReleaseEvent(QMouseEvent* event)
+{
+	if (panning && (event->button() == Qt::LeftButton || event->button() == Qt::MiddleButton))
+	{
+		panning = false;
+		unsetCursor();
+	}
+}
+
+void GridView::mouseDoubleClickEvent(QMouseEvent* event)
+{
+	(void)event;
+	fitToView();
+}
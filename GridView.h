@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QtCore/QPointF>
+#include <QtGui/QImage>
+#include <QtWidgets/QWidget>
+
+/*
+ Draws a grid from an image holding one pixel per cell. Changing cells
+ only writes to the image; the widget blits the part of it that is on
+ screen when it is repainted, scaled without smoothing, so a million
+ cells cost one upload rather than a million item updates.
+ The wheel zooms around the cursor, dragging pans, and a double click
+ fits the whole grid in the widget again. Until the user zooms or pans
+ the grid follows the size of the widget.*/
+class GridView : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit GridView(QWidget* parent = Q_NULLPTR);
+
+	// Every cell starts out with the given colour
+	void setGridSize(int rows, int cols, QRgb color = qRgb(255, 255, 255));
+
+	int rows() const { return image.height(); }
+	int cols() const { return image.width(); }
+
+	// Call update() once after a batch of these to show them
+	void setCell(int row, int col, QRgb color)
+	{
+		reinterpret_cast<QRgb*>(image.scanLine(row))[col] = color;
+	}
+
+	QRgb cell(int row, int col) const
+	{
+		return reinterpret_cast<const QRgb*>(image.constScanLine(row))[col];
+	}
+
+	// Fits the whole grid in the widget and follows its size again
+	void fitToView();
+
+protected:
+	void paintEvent(QPaintEvent* event) override;
+	void resizeEvent(QResizeEvent* event) override;
+	void wheelEvent(QWheelEvent* event) override;
+	void mousePressEvent(QMouseEvent* event) override;
+	void mouseMoveEvent(QMouseEvent* event) override;
+	void mouseReleaseEvent(QMouseEvent* event) override;
+	void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+	QImage image;
+
+	// Widget pixels per cell, and where the corner of cell (0, 0) is
+	double scale;
+	QPointF offset;
+
+	bool fitted;
+	bool panning;
+	QPointF lastMouse;
+};
@@ -0,0 +1,1089 @@
+#include "AStarSearch.h"
+#include "Components.h"
+#include "JumpPointSearch.h"
+#include "Landmarks.h"
+#include "LineOfSight.h"
+#include "SearchStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace PathEngine
+{
+	namespace
+	{
+		/*
+		 Generating the successors of a cell
+
+			N.W   N   N.E
+			  \   |   /
+			   \  |  /
+			W----Cell----E
+				 / | \
+			   /   |  \
+			S.W    S   S.E
+
+		The diagonal ones are only generated when diagonal movement is
+		allowed, and only when neither cell beside the move is blocked,
+		so a path never squeezes between two diagonal walls. The cost of
+		each step comes from the Moves policy, see Heuristics.h.*/
+		struct Direction
+		{
+			int di, dj;
+		};
+
+		const Direction straightDirections[] =
+		{
+			{ -1,  0 },	// North
+			{  1,  0 },	// South
+			{  0,  1 },	// East
+			{  0, -1 },	// West
+		};
+
+		const Direction diagonalDirections[] =
+		{
+			{ -1,  1 },	// North-East
+			{ -1, -1 },	// North-West
+			{  1,  1 },	// South-East
+			{  1, -1 },	// South-West
+		};
+
+		template <class Moves>
+		class NeighbourExpander
+		{
+		public:
+			// A reverse expander walks the moves backwards, for the search
+			// from the destination: on terrain a move then costs the cell
+			// it comes from instead of the one it goes to
+			NeighbourExpander(const Grid& grid, bool diagonal, bool reverse = false) : grid(grid), diagonal(diagonal), reverse(reverse) {}
+
+			template <class Visit>
+			void operator()(Pair pos, Pair, Visit visit) const
+			{
+				// All 8 neighbours in one read of the bit grid,
+				// cells outside the grid read as blocked
+				const uint32_t around = grid.bits().neighbourhood(pos.first, pos.second);
+
+				for (const Direction& d : straightDirections)
+				{
+					if (around & bit(d.di, d.dj))
+						visit(pos.first + d.di, pos.second + d.dj, stepCost(pos, d, Moves::straight));
+				}
+
+				if (!diagonal)
+					return;
+
+				for (const Direction& d : diagonalDirections)
+				{
+					const uint32_t needed = bit(d.di, d.dj) | bit(d.di, 0) | bit(0, d.dj);
+					if ((around & needed) == needed)
+						visit(pos.first + d.di, pos.second + d.dj, stepCost(pos, d, Moves::diagonal));
+				}
+			}
+
+		private:
+			double stepCost(Pair pos, const Direction& d, double length) const
+			{
+				if (!Moves::terrain)
+					return length;
+
+				return reverse ? length * grid.get(pos.first, pos.second) : length * grid.get(pos.first + d.di, pos.second + d.dj);
+			}
+
+			static uint32_t bit(int di, int dj) { return 1u << ((di + 1) * 3 + (dj + 1)); }
+
+			const Grid& grid;
+			bool diagonal;
+			bool reverse;
+		};
+
+		/*
+		 The ends of one query. The search starts from every usable cell of
+		 sources at once: there is just one, but for the searches to or
+		 from the nearest of several cells. A backward query searches from
+		 the targets back to the source, walking every move the wrong way
+		 round, so its path is traced from the source on.*/
+		struct Query
+		{
+			const Pair* sources;
+			size_t sourceCount;
+			Pair dest;
+			bool backward;
+
+			// One source and one destination, as aStarSearch has them
+			bool single() const { return sourceCount == 1 && !backward; }
+		};
+
+		// A source the search can start from: on the grid, walkable, and
+		// in the region of the destination when the options know regions
+		bool usableSource(const Grid& grid, const SearchOptions& options, Pair source, Pair dest)
+		{
+			if (!grid.isValid(source.first, source.second) || !grid.isUnBlocked(source.first, source.second))
+				return false;
+
+			return options.components == nullptr || !options.components->matches(grid) || options.components->connected(source, dest);
+		}
+
+		// Where a path goes: SearchResult::path, or the caller's buffer
+		// when the options have one. The length is set first and the cells
+		// are written by position, so nothing has to be reversed
+		class PathWriter
+		{
+		public:
+			PathWriter(const SearchOptions& options, SearchResult& result) : buffer(options.pathBuffer), path(result.path) {}
+
+			void resize(size_t size)
+			{
+				if (buffer != nullptr)
+					buffer->size = size;
+				else
+					path.resize(size);
+			}
+
+			void write(size_t at, Pair cell)
+			{
+				if (buffer == nullptr)
+					path[at] = cell;
+				else if (at < buffer->capacity)
+					buffer->cells[at] = cell;
+			}
+
+		private:
+			PathBuffer* buffer;
+			std::vector<Pair>& path;
+		};
+
+		// Going from a to b and on from b to c keeps the same direction
+		bool sameDirection(Pair a, Pair b, Pair c)
+		{
+			const long long di1 = b.first - a.first, dj1 = b.second - a.second;
+			const long long di2 = c.first - b.first, dj2 = c.second - b.second;
+			return di1 * dj2 == dj1 * di2 && di1 * di2 + dj1 * dj2 > 0;
+		}
+
+		/*
+		 Walks a path from cell along the parents of context to the start
+		 of that search, calling visit for every cell in that order. before
+		 is the cell the walk comes from, or cell itself when the path
+		 ends there. A parent can be several cells away along a straight
+		 or diagonal line (Jump Point Search), fill visits the cells in
+		 between; any-angle paths only have their corners. For waypoints
+		 only the two ends and the cells where the direction changes are
+		 visited. Nothing is allocated, a trace walks twice: once to count
+		 the cells and once to write them.*/
+		template <class Visit>
+		void walkParents(const Grid& grid, const SearchContext& context, uint32_t cell, uint32_t before, bool fill, bool waypoints, Visit visit)
+		{
+			for (;;)
+			{
+				const uint32_t parent = context.at(cell).parent;
+				const Pair pos = grid.position(cell);
+
+				if (parent == cell)
+				{
+					visit(pos);
+					return;
+				}
+
+				const Pair to = grid.position(parent);
+
+				if (waypoints)
+				{
+					if (before == cell || !sameDirection(grid.position(before), pos, to))
+						visit(pos);
+				}
+				else if (fill)
+				{
+					const int di = (to.first > pos.first) - (to.first < pos.first);
+					const int dj = (to.second > pos.second) - (to.second < pos.second);
+
+					for (Pair from = pos; from != to; from.first += di, from.second += dj)
+						visit(from);
+				}
+				else
+				{
+					visit(pos);
+				}
+
+				before = cell;
+				cell = parent;
+			}
+		}
+
+		// A Utility Function to trace the path from the source
+		// to the destination, in the format the options ask for.
+		// The parents of a backward search lead from the source to
+		// the target instead. Returns the cell the search started from
+		Pair tracePath(const Grid& grid, const SearchContext& context, uint32_t dest, bool fill, bool backward, const SearchOptions& options, SearchResult& result)
+		{
+			const bool waypoints = options.pathFormat == PathFormat::Waypoints;
+
+			size_t size = 0;
+			Pair start;
+			walkParents(grid, context, dest, dest, fill, waypoints, [&](Pair cell) { size++; start = cell; });
+
+			PathWriter writer(options, result);
+			writer.resize(size);
+
+			size_t at = backward ? 0 : size;
+			walkParents(grid, context, dest, dest, fill, waypoints, [&](Pair cell) { writer.write(backward ? at++ : --at, cell); });
+			return start;
+		}
+
+		template <class OpenList, class HValue, class Expander>
+		SearchResult runSearch(const Grid& grid, const Query& query, const SearchOptions& options, SearchContext& context, OpenList& openList, HValue calculateHValue, const Expander& expander)
+		{
+			SearchResult result;
+
+			const Pair dest = query.dest;
+			const uint32_t destIndex = grid.index(dest.first, dest.second);
+
+			for (size_t i = 0; i < query.sourceCount; i++)
+			{
+				const Pair src = query.sources[i];
+				if (!usableSource(grid, options, src, dest))
+					continue;
+
+				// Initialising the parameters of the starting node, every
+				// other node starts unvisited with an infinite distance
+				const uint32_t srcIndex = grid.index(src.first, src.second);
+				Node& start = context.node(srcIndex);
+				if (SearchContext::state(start) != Unvisited)
+					continue;
+
+				start.g = 0.0;
+				start.parent = srcIndex;
+				SearchContext::setState(start, Open);
+
+				// The open list is keyed on f = g + h and holds
+				// the flat row-major index of each cell
+				openList.push(srcIndex, calculateHValue(src.first, src.second, dest));
+				result.generated++;
+
+				if (options.recordOpened)
+					result.opened.push_back(src);
+
+				if (options.observer)
+					options.observer->opened(src);
+			}
+
+			while (!openList.empty())
+			{
+				// Remove this vertex from the open list
+				const uint32_t current = openList.pop();
+
+				// Open lists without decrease-key hold a cell several times
+				// when a better path to it was found, skip the stale copies
+				Node& parent = context.node(current);
+				if (SearchContext::state(parent) == Closed)
+					continue;
+
+				// Add this vertex to the closed list
+				SearchContext::setState(parent, Closed);
+				result.expanded++;
+
+				const Pair pos = grid.position(current);
+
+				if (options.observer && !options.observer->expanded(pos))
+				{
+					result.status = SearchStatus::Cancelled;
+					result.touched = context.touchedCount();
+					return result;
+				}
+
+				// The destination is only final once it leaves the open list,
+				// testing it when it is generated could return a longer path
+				if (current == destIndex)
+				{
+					result.status = SearchStatus::Found;
+					result.cost = parent.g;
+					result.touched = context.touchedCount();
+
+					PATHENGINE_STAT(StatsTimer reconstruct);
+					const Pair start = tracePath(grid, context, current, true, query.backward, options, result);
+					PATHENGINE_STAT(result.reconstructMicros = reconstruct.elapsedMicros());
+
+					if (!query.single())
+						result.nearest = size_t(std::find(query.sources, query.sources + query.sourceCount, start) - query.sources);
+
+					return result;
+				}
+
+				expander(pos, grid.position(parent.parent), [&](int ni, int nj, double cost)
+				{
+					const uint32_t next = grid.index(ni, nj);
+					Node& node = context.node(next);
+
+					// Ignore it if it is already on the closed list
+					if (SearchContext::state(node) == Closed)
+						return;
+
+					double gNew = parent.g + cost;
+
+					// If it isn't on the open list, add it to
+					// the open list. Make the current square
+					// the parent of this square.
+					//                OR
+					// If it is on the open list already, check
+					// to see if this path to that square is better.
+					// Both paths share the same 'h', so comparing
+					// 'g' is the same as comparing 'f'.
+					if (gNew < node.g)
+					{
+						double fNew = gNew + calculateHValue(ni, nj, dest);
+						openList.push(next, fNew);
+						result.generated++;
+						PATHENGINE_STAT(result.reinserted += SearchContext::state(node) == Open);
+
+						if (SearchContext::state(node) == Unvisited)
+						{
+							if (options.recordOpened)
+								result.opened.push_back(std::make_pair(ni, nj));
+							if (options.observer)
+								options.observer->opened(std::make_pair(ni, nj));
+						}
+
+						// Update the details of this cell
+						node.g = gNew;
+						node.parent = current;
+						SearchContext::setState(node, Open);
+					}
+				});
+
+				result.peakOpen = std::max(result.peakOpen, openList.size());
+			}
+
+			// When the destination cell is not found and the open
+			// list is empty, then we conclude that we failed to
+			// reach the destination cell. This may happen when the
+			// there is no way to the destination cell (due to blockages)
+			result.status = SearchStatus::NoPath;
+			result.touched = context.touchedCount();
+			return result;
+		}
+
+		// Calls run(h) with the heuristic the options ask for. One search
+		// is compiled for every heuristic, so picking one costs a switch
+		// per query rather than a call per cell. weight scales h on top of
+		// the weight in the options, terrain uses it to measure h in the
+		// units and the cheapest cost of g. With landmarks the heuristic
+		// is the larger of that and the ALT bound, unit converting the
+		// table to the units of g
+		template <class Run>
+		SearchResult withHeuristic(const Grid& grid, const SearchOptions& options, HeuristicType fallback, double weight, const LandmarkTable* landmarks, double unit, Run run)
+		{
+			const HeuristicType heuristic = options.heuristic == HeuristicType::Default ? fallback : options.heuristic;
+
+			if (landmarks != nullptr)
+			{
+				switch (heuristic)
+				{
+				case HeuristicType::Manhattan:
+					return run(LandmarkHValue<ManhattanHValue>(grid, *landmarks, ManhattanHValue(), weight, unit, options.heuristicWeight));
+				case HeuristicType::Chebyshev:
+					return run(LandmarkHValue<ChebyshevHValue>(grid, *landmarks, ChebyshevHValue(), weight, unit, options.heuristicWeight));
+				case HeuristicType::Euclidean:
+					return run(LandmarkHValue<EuclideanHValue>(grid, *landmarks, EuclideanHValue(), weight, unit, options.heuristicWeight));
+				case HeuristicType::Octile:
+				default:
+					return run(LandmarkHValue<OctileHValue>(grid, *landmarks, OctileHValue(), weight, unit, options.heuristicWeight));
+				}
+			}
+
+			weight *= options.heuristicWeight;
+
+			if (weight != 1.0)
+			{
+				switch (heuristic)
+				{
+				case HeuristicType::Manhattan:
+					return run(WeightedHValue<ManhattanHValue>(weight));
+				case HeuristicType::Chebyshev:
+					return run(WeightedHValue<ChebyshevHValue>(weight));
+				case HeuristicType::Euclidean:
+					return run(WeightedHValue<EuclideanHValue>(weight));
+				case HeuristicType::Octile:
+				default:
+					return run(WeightedHValue<OctileHValue>(weight));
+				}
+			}
+
+			switch (heuristic)
+			{
+			case HeuristicType::Manhattan:
+				return run(ManhattanHValue());
+			case HeuristicType::Chebyshev:
+				return run(ChebyshevHValue());
+			case HeuristicType::Euclidean:
+				return run(EuclideanHValue());
+			case HeuristicType::Octile:
+			default:
+				return run(OctileHValue());
+			}
+		}
+
+		template <class OpenList, class Expander>
+		SearchResult searchWithHeuristic(const Grid& grid, const Query& query, const SearchOptions& options, SearchContext& context, OpenList& openList, const Expander& expander,
+			HeuristicType fallback, double weight = 1.0, const LandmarkTable* landmarks = nullptr, double unit = 1.0)
+		{
+			return withHeuristic(grid, options, fallback, weight, landmarks, unit, [&](auto calculateHValue)
+			{
+				return runSearch(grid, query, options, context, openList, calculateHValue, expander);
+			});
+		}
+
+		// The best path found so far between the two halves of a
+		// bidirectional search: the forward half reaches forwardCell, one
+		// move (or none) leads to backwardCell, and the backward half
+		// reaches the destination from there
+		struct Meeting
+		{
+			Meeting() : cost(DBL_MAX), forwardCell(0), backwardCell(0), done(false) {}
+
+			void offer(double pathCost, uint32_t forwardEnd, uint32_t backwardEnd)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (pathCost < cost.load())
+				{
+					forwardCell = forwardEnd;
+					backwardCell = backwardEnd;
+					cost.store(pathCost);
+				}
+			}
+
+			std::atomic<double> cost;
+			uint32_t forwardCell;
+			uint32_t backwardCell;
+			std::atomic<bool> done;
+			std::mutex mutex;
+		};
+
+		/*
+		 One half of a bidirectional search (NBA*, Pijls and Post): A* from
+		 one end towards the other on its own context. A cell belongs to
+		 the half that takes it off its open list first; the other half
+		 never expands it, so the two frontiers do not overlap. Where they
+		 touch, the two distances plus the move between them are a path.
+		 A cell is closed without expanding it when no path through it can
+		 beat the best one found so far: either its own f is not lower, or
+		 its g plus the lowest f of the other half, minus the other half's
+		 h of the cell, is not. The search is over once either half has an
+		 empty open list.*/
+		template <class HValue, class Expander>
+		class Frontier
+		{
+		public:
+			Frontier(const Grid& grid, const SearchOptions& options, SearchContext& context, SearchContext& claims, unsigned half, Pair start, Pair target, HValue calculateHValue, const Expander& expander, Meeting& meeting)
+				: context(context), cancelled(false), grid(grid), options(options), claims(claims), half(half), start(start), target(target),
+				  calculateHValue(calculateHValue), expander(expander), meeting(meeting), lowestF(0.0)
+			{
+				const uint32_t startIndex = grid.index(start.first, start.second);
+
+				Node& node = context.node(startIndex);
+				node.g = 0.0;
+				node.parent = startIndex;
+				SearchContext::setState(node, Open);
+
+				context.heap().push(startIndex, 0.0);
+				result.generated++;
+
+				if (options.recordOpened)
+					result.opened.push_back(start);
+
+				if (options.observer)
+					options.observer->opened(start);
+			}
+
+			// Closes one cell, false once the search is over
+			bool step(const Frontier& other)
+			{
+				if (meeting.done.load(std::memory_order_relaxed))
+					return false;
+
+				IndexedDaryHeap<4>& openList = context.heap();
+				if (openList.empty() || !(openList.topKey() < meeting.cost.load()))
+				{
+					// Every cell left would be rejected on its own f
+					meeting.done.store(true, std::memory_order_relaxed);
+					return false;
+				}
+
+				const double f = openList.topKey();
+				const uint32_t current = openList.pop();
+				Node& parent = context.node(current);
+				SearchContext::setState(parent, Closed);
+
+				// The children of this cell may still go on the open list below
+				// the next key, but never below f while h is consistent
+				lowestF.store(f, std::memory_order_relaxed);
+
+				// The other half got here first, its distance is final
+				if (claims.claim(current, half) != half)
+				{
+					offer(current, parent.g, current, other);
+					return true;
+				}
+
+				const Pair pos = grid.position(current);
+				const double otherLowestF = other.lowestF.load(std::memory_order_relaxed);
+				if (!(parent.g + otherLowestF - calculateHValue(pos.first, pos.second, start) < meeting.cost.load()))
+					return true;
+
+				if (options.observer && !options.observer->expanded(pos))
+				{
+					cancelled = true;
+					meeting.done.store(true, std::memory_order_relaxed);
+					return false;
+				}
+
+				result.expanded++;
+
+				expander(pos, grid.position(parent.parent), [&](int ni, int nj, double cost)
+				{
+					const uint32_t next = grid.index(ni, nj);
+					Node& node = context.node(next);
+
+					if (SearchContext::state(node) == Closed)
+						return;
+
+					double gNew = parent.g + cost;
+
+					if (claims.owner(next) == 1 - int(half))
+					{
+						offer(current, gNew, next, other);
+						return;
+					}
+
+					if (gNew < node.g)
+					{
+						openList.push(next, gNew + calculateHValue(ni, nj, target));
+						result.generated++;
+						PATHENGINE_STAT(result.reinserted += SearchContext::state(node) == Open);
+
+						if (SearchContext::state(node) == Unvisited)
+						{
+							if (options.recordOpened)
+								result.opened.push_back(std::make_pair(ni, nj));
+							if (options.observer)
+								options.observer->opened(std::make_pair(ni, nj));
+						}
+
+						node.g = gNew;
+						node.parent = current;
+						SearchContext::setState(node, Open);
+					}
+				});
+
+				if (!openList.empty())
+					lowestF.store(openList.topKey(), std::memory_order_relaxed);
+
+				result.peakOpen = std::max(result.peakOpen, openList.size());
+
+				return true;
+			}
+
+			SearchContext& context;
+			SearchResult result;
+
+			// The observer stopped this half
+			bool cancelled;
+
+		private:
+			// A path that runs through mine, costing g to get to there,
+			// and on through theirs, owned by the other half
+			void offer(uint32_t mine, double g, uint32_t theirs, const Frontier& other)
+			{
+				const double pathCost = g + other.context.at(theirs).g;
+
+				if (half == 0)
+					meeting.offer(pathCost, mine, theirs);
+				else
+					meeting.offer(pathCost, theirs, mine);
+			}
+
+			const Grid& grid;
+			const SearchOptions& options;
+			SearchContext& claims;
+			unsigned half;
+			Pair start;
+			Pair target;
+			HValue calculateHValue;
+			const Expander& expander;
+			Meeting& meeting;
+
+			// The lowest f on the open list, read by the other half
+			std::atomic<double> lowestF;
+		};
+
+		template <class HValue, class Expander>
+		SearchResult runBidirectional(const Grid& grid, Pair src, Pair dest, const SearchOptions& options, SearchContext& context, HValue calculateHValue, const Expander& forwardExpander, const Expander& backwardExpander)
+		{
+			SearchContext& backwardContext = context.reverse();
+			backwardContext.beginQuery(grid.size());
+			context.prepareClaims();
+
+			Meeting meeting;
+			Frontier<HValue, Expander> forward(grid, options, context, context, 0, src, dest, calculateHValue, forwardExpander, meeting);
+			Frontier<HValue, Expander> backward(grid, options, backwardContext, context, 1, dest, src, calculateHValue, backwardExpander, meeting);
+
+			if (options.parallelBidirectional)
+			{
+				std::thread helper([&]()
+				{
+					while (backward.step(forward))
+					{
+					}
+				});
+
+				while (forward.step(backward))
+				{
+				}
+
+				helper.join();
+			}
+			else
+			{
+				// Take turns on one thread
+				while (forward.step(backward) && backward.step(forward))
+				{
+				}
+			}
+
+			SearchResult result;
+			result.expanded = forward.result.expanded + backward.result.expanded;
+			result.generated = forward.result.generated + backward.result.generated;
+			result.peakOpen = forward.result.peakOpen + backward.result.peakOpen;
+			result.reinserted = forward.result.reinserted + backward.result.reinserted;
+			result.touched = context.touchedCount() + backwardContext.touchedCount();
+			result.opened = std::move(forward.result.opened);
+			result.opened.insert(result.opened.end(), backward.result.opened.begin(), backward.result.opened.end());
+
+			if (forward.cancelled || backward.cancelled)
+			{
+				result.status = SearchStatus::Cancelled;
+				return result;
+			}
+
+			double best = meeting.cost.load();
+			uint32_t forwardCell = meeting.forwardCell;
+			uint32_t backwardCell = meeting.backwardCell;
+
+			// A half that finished before the other one started may have
+			// claimed the far end itself, with no one to offer it to
+			const uint32_t srcIndex = grid.index(src.first, src.second);
+			const uint32_t destIndex = grid.index(dest.first, dest.second);
+
+			if (context.state(destIndex) == Closed && context.at(destIndex).g < best)
+			{
+				best = context.at(destIndex).g;
+				forwardCell = backwardCell = destIndex;
+			}
+
+			if (backwardContext.state(srcIndex) == Closed && backwardContext.at(srcIndex).g < best)
+			{
+				best = backwardContext.at(srcIndex).g;
+				forwardCell = backwardCell = srcIndex;
+			}
+
+			if (best == DBL_MAX)
+			{
+				result.status = SearchStatus::NoPath;
+				return result;
+			}
+
+			// Source to the meeting from the forward parents, then on to
+			// the destination from the backward ones
+			result.status = SearchStatus::Found;
+			result.cost = best;
+
+			PATHENGINE_STAT(StatsTimer reconstruct);
+
+			// The backward half goes on from the cell after the meeting,
+			// unless the forward one got all the way to the destination
+			const uint32_t after = backwardCell != forwardCell ? backwardCell : backwardContext.at(backwardCell).parent;
+			const bool tail = after != forwardCell;
+			const bool waypoints = options.pathFormat == PathFormat::Waypoints;
+
+			size_t head = 0, size = 0;
+			walkParents(grid, context, forwardCell, after, true, waypoints, [&](Pair) { head++; });
+			if (tail)
+				walkParents(grid, backwardContext, after, forwardCell, true, waypoints, [&](Pair) { size++; });
+
+			PathWriter writer(options, result);
+			writer.resize(head + size);
+
+			size = head;
+			walkParents(grid, context, forwardCell, after, true, waypoints, [&](Pair cell) { writer.write(--head, cell); });
+			if (tail)
+				walkParents(grid, backwardContext, after, forwardCell, true, waypoints, [&](Pair cell) { writer.write(size++, cell); });
+
+			PATHENGINE_STAT(result.reconstructMicros = reconstruct.elapsedMicros());
+			return result;
+		}
+
+		/*
+		 Theta* (Nash, Daniel, Koenig and Felner) and Lazy Theta* (Nash,
+		 Koenig and Tovey): A* over the 8 neighbours of a cell, except that
+		 a neighbour in sight of the cell's parent skips the cell and takes
+		 the parent as its own, at the straight-line distance. Parents end
+		 up on the corners of obstacles, and the path is the line between
+		 them.
+		 Theta* checks the line of sight for every neighbour, but only when
+		 the parent would give it a lower g than it has. Lazy Theta* takes
+		 the line for granted when it puts a cell on the open list, and
+		 only checks it once, when the cell is expanded. Most cells never
+		 are; for one whose parent turns out to be out of sight, the best
+		 expanded neighbour becomes its parent instead.*/
+		template <class HValue>
+		SearchResult runAnyAngle(const Grid& grid, Pair src, Pair dest, const SearchOptions& options, SearchContext& context, HValue calculateHValue)
+		{
+			SearchResult result;
+
+			const bool lazy = options.mode == SearchMode::LazyThetaStar;
+			const uint32_t srcIndex = grid.index(src.first, src.second);
+			const uint32_t destIndex = grid.index(dest.first, dest.second);
+
+			NeighbourExpander<OctileMoves> expander(grid, true);
+			EuclideanHValue distance;
+			IndexedDaryHeap<4>& openList = context.heap();
+
+			Node& start = context.node(srcIndex);
+			start.g = 0.0;
+			start.parent = srcIndex;
+			SearchContext::setState(start, Open);
+
+			openList.push(srcIndex, 0.0);
+			result.generated++;
+
+			if (options.recordOpened)
+				result.opened.push_back(src);
+
+			if (options.observer)
+				options.observer->opened(src);
+
+			while (!openList.empty())
+			{
+				const uint32_t current = openList.pop();
+				Node& cell = context.node(current);
+				SearchContext::setState(cell, Closed);
+				result.expanded++;
+
+				const Pair pos = grid.position(current);
+
+				if (options.observer && !options.observer->expanded(pos))
+				{
+					result.status = SearchStatus::Cancelled;
+					result.touched = context.touchedCount();
+					return result;
+				}
+
+				// The cell it was opened from is closed and one move away,
+				// so there always is a neighbour to fall back on
+				if (lazy && !lineOfSight(grid, grid.position(cell.parent), pos))
+				{
+					cell.g = DBL_MAX;
+
+					expander(pos, pos, [&](int ni, int nj, double cost)
+					{
+						const uint32_t next = grid.index(ni, nj);
+						if (context.state(next) == Closed && context.at(next).g + cost < cell.g)
+						{
+							cell.g = context.at(next).g + cost;
+							cell.parent = next;
+						}
+					});
+				}
+
+				if (current == destIndex)
+				{
+					result.status = SearchStatus::Found;
+					result.cost = cell.g;
+					result.touched = context.touchedCount();
+
+					PATHENGINE_STAT(StatsTimer reconstruct);
+					tracePath(grid, context, current, false, false, options, result);
+					PATHENGINE_STAT(result.reconstructMicros = reconstruct.elapsedMicros());
+					return result;
+				}
+
+				const uint32_t parentIndex = cell.parent;
+				const Pair parentPos = grid.position(parentIndex);
+				const double parentG = context.at(parentIndex).g;
+
+				expander(pos, parentPos, [&](int ni, int nj, double cost)
+				{
+					const uint32_t next = grid.index(ni, nj);
+					Node& node = context.node(next);
+
+					if (SearchContext::state(node) == Closed)
+						return;
+
+					// Straight from the parent when it can see the cell, the
+					// line is never longer than the way round through this one
+					double gNew = parentG + distance(ni, nj, parentPos);
+					uint32_t from = parentIndex;
+
+					if (!(gNew < node.g))
+						return;
+
+					if (!lazy && parentIndex != current && !lineOfSight(grid, parentPos, Pair(ni, nj)))
+					{
+						gNew = cell.g + cost;
+						from = current;
+
+						if (!(gNew < node.g))
+							return;
+					}
+
+					openList.push(next, gNew + calculateHValue(ni, nj, dest));
+					result.generated++;
+					PATHENGINE_STAT(result.reinserted += SearchContext::state(node) == Open);
+
+					if (SearchContext::state(node) == Unvisited)
+					{
+						if (options.recordOpened)
+							result.opened.push_back(std::make_pair(ni, nj));
+						if (options.observer)
+							options.observer->opened(std::make_pair(ni, nj));
+					}
+
+					node.g = gNew;
+					node.parent = from;
+					SearchContext::setState(node, Open);
+				});
+
+				result.peakOpen = std::max(result.peakOpen, openList.size());
+			}
+
+			result.status = SearchStatus::NoPath;
+			result.touched = context.touchedCount();
+			return result;
+		}
+
+		template <class Moves>
+		SearchResult searchWithMoves(const Grid& grid, const Query& query, const SearchOptions& options, SearchContext& context, HeuristicType fallback)
+		{
+			const bool bidirectional = options.mode == SearchMode::Bidirectional && query.single();
+			NeighbourExpander<Moves> expander(grid, options.allowDiagonal, query.backward);
+
+			// Every step costs at least the cheapest cell, in the units of g
+			const double weight = Moves::terrain ? Moves::scale * grid.minCost() : 1.0;
+
+			// On terrain the landmarks only bound the distance from a cell,
+			// the backward half of a bidirectional search and a backward
+			// query need the other way
+			const LandmarkTable* landmarks = options.landmarks != nullptr && options.landmarks->matches(grid, options) &&
+				((!bidirectional && !query.backward) || options.landmarks->symmetric()) ? options.landmarks : nullptr;
+			const double unit = landmarks != nullptr ? Moves::scale / landmarks->scale() : 1.0;
+
+			SearchResult result;
+
+			if (bidirectional)
+			{
+				// The backward half walks every move the wrong way round, so
+				// on terrain it pays for the cell it leaves
+				NeighbourExpander<Moves> backwardExpander(grid, options.allowDiagonal, true);
+
+				result = withHeuristic(grid, options, fallback, weight, landmarks, unit, [&](auto calculateHValue)
+				{
+					return runBidirectional(grid, query.sources[0], query.dest, options, context, calculateHValue, expander, backwardExpander);
+				});
+
+				result.cost /= Moves::scale;
+				return result;
+			}
+
+			// The bucket queue can only hold integral f values: integral
+			// steps and an integral heuristic with an integral weight
+			const HeuristicType heuristic = options.heuristic == HeuristicType::Default ? fallback : options.heuristic;
+			const double hWeight = weight * options.heuristicWeight;
+			const bool integral = (!options.allowDiagonal || Moves::diagonal == std::floor(Moves::diagonal)) && hWeight == std::floor(hWeight) &&
+				(heuristic == HeuristicType::Manhattan || heuristic == HeuristicType::Chebyshev) &&
+				(landmarks == nullptr || (unit == std::floor(unit) && options.heuristicWeight == std::floor(options.heuristicWeight)));
+
+			// Keys on the list at once span about one step and what the
+			// heuristic changes by on it. On expensive terrain that is too
+			// many buckets to sweep, and the heap does better
+			const double largestStep = (options.allowDiagonal ? Moves::diagonal : Moves::straight) * (Moves::terrain ? grid.maxCost() : 1);
+			const bool narrow = largestStep * (1.0 + options.heuristicWeight) <= double(BucketQueue::MaxSpread);
+
+			switch (options.openList)
+			{
+			case OpenListType::Bucket:
+				if (integral && narrow)
+					result = searchWithHeuristic(grid, query, options, context, context.bucketQueue(), expander, fallback, weight, landmarks, unit);
+				else
+					result = searchWithHeuristic(grid, query, options, context, context.heap(), expander, fallback, weight, landmarks, unit);
+				break;
+			case OpenListType::Set:
+				result = searchWithHeuristic(grid, query, options, context, context.setOpenList(), expander, fallback, weight, landmarks, unit);
+				break;
+			case OpenListType::DaryHeap:
+			default:
+				result = searchWithHeuristic(grid, query, options, context, context.heap(), expander, fallback, weight, landmarks, unit);
+				break;
+			}
+
+			// Back from fixed point to steps
+			result.cost /= Moves::scale;
+			return result;
+		}
+
+		SearchResult runQuery(const Grid& grid, const Query& query, const SearchOptions& options, SearchContext& context)
+		{
+			SearchResult result;
+
+			if (options.pathBuffer != nullptr)
+				options.pathBuffer->size = 0;
+
+			const Pair dest = query.dest;
+			size_t valid = 0, unblocked = 0, usable = 0;
+
+			for (size_t i = 0; i < query.sourceCount; i++)
+			{
+				const Pair src = query.sources[i];
+				if (!grid.isValid(src.first, src.second))
+					continue;
+
+				valid++;
+				if (!grid.isUnBlocked(src.first, src.second))
+					continue;
+
+				unblocked++;
+
+				// If the destination cell is the same as source cell
+				if (src == dest)
+				{
+					result.status = SearchStatus::AlreadyAtDestination;
+					result.nearest = i;
+
+					PathWriter writer(options, result);
+					writer.resize(1);
+					writer.write(0, src);
+					return result;
+				}
+
+				usable += usableSource(grid, options, src, dest);
+			}
+
+			// Either the source or the destination is invalid, or
+			// blocked. With several sources, every one of them
+			if (valid == 0 || !grid.isValid(dest.first, dest.second))
+			{
+				result.status = SearchStatus::InvalidEndpoint;
+				return result;
+			}
+
+			if (unblocked == 0 || !grid.isUnBlocked(dest.first, dest.second))
+			{
+				result.status = SearchStatus::BlockedEndpoint;
+				return result;
+			}
+
+			// The two ends are in different regions, nothing to search
+			if (usable == 0)
+			{
+				result.status = SearchStatus::NoPath;
+				return result;
+			}
+
+			context.beginQuery(grid.size());
+
+			if (options.terrainCosts)
+			{
+				if (options.allowDiagonal && options.moveCost == MoveCostType::Octile)
+					return searchWithMoves<TerrainOctileMoves>(grid, query, options, context, HeuristicType::Octile);
+
+				return searchWithMoves<TerrainChebyshevMoves>(grid, query, options, context, options.allowDiagonal ? HeuristicType::Chebyshev : HeuristicType::Manhattan);
+			}
+
+			if (options.mode == SearchMode::JumpPoint)
+			{
+				JumpPointExpander expander(grid, query.dest);
+				return searchWithHeuristic(grid, query, options, context, context.heap(), expander, HeuristicType::Octile);
+			}
+
+			if ((options.mode == SearchMode::ThetaStar || options.mode == SearchMode::LazyThetaStar) && query.single())
+			{
+				// Landmark distances are along grid moves, longer than the
+				// lines an any-angle path takes, so they would overestimate
+				return withHeuristic(grid, options, HeuristicType::Euclidean, 1.0, nullptr, 1.0, [&](auto calculateHValue)
+				{
+					return runAnyAngle(grid, query.sources[0], query.dest, options, context, calculateHValue);
+				});
+			}
+
+			if (options.allowDiagonal && options.moveCost == MoveCostType::Chebyshev)
+				return searchWithMoves<ChebyshevMoves>(grid, query, options, context, HeuristicType::Chebyshev);
+
+			if (options.allowDiagonal)
+				return searchWithMoves<OctileMoves>(grid, query, options, context, HeuristicType::Octile);
+
+			return searchWithMoves<OctileMoves>(grid, query, options, context, HeuristicType::Manhattan);
+		}
+	}
+
+	const char* statusMessage(SearchStatus status)
+	{
+		switch (status)
+		{
+		case SearchStatus::Found:
+			return "The destination cell is found!";
+		case SearchStatus::InvalidEndpoint:
+			return "Source or Destination is invalid.";
+		case SearchStatus::BlockedEndpoint:
+			return "Source or Destination is blocked.";
+		case SearchStatus::AlreadyAtDestination:
+			return "We are already at the destination.";
+		case SearchStatus::Cancelled:
+			return "The search was cancelled.";
+		case SearchStatus::NoPath:
+		default:
+			return "Failed to find the destination cell...";
+		}
+	}
+
+	SearchResult aStarSearch(const Grid& grid, Pair src, Pair dest, const SearchOptions& options)
+	{
+		SearchContext context;
+		return aStarSearch(grid, src, dest, options, context);
+	}
+
+	SearchResult aStarSearch(const Grid& grid, Pair src, Pair dest, const SearchOptions& options, SearchContext& context)
+	{
+		PATHENGINE_STAT(StatsTimer timer);
+		const Query query = { &src, 1, dest, false };
+		SearchResult result = runQuery(grid, query, options, context);
+
+		PATHENGINE_STAT(result.searchMicros = timer.elapsedMicros());
+		recordSearch(src, dest, result);
+		return result;
+	}
+
+	SearchResult aStarSearchToAny(const Grid& grid, Pair src, const Pair* targets, size_t targetCount, const SearchOptions& options, SearchContext& context)
+	{
+		PATHENGINE_STAT(StatsTimer timer);
+		const Query query = { targets, targetCount, src, true };
+		SearchResult result = runQuery(grid, query, options, context);
+
+		PATHENGINE_STAT(result.searchMicros = timer.elapsedMicros());
+		recordSearch(src, result.nearest < targetCount ? targets[result.nearest] : src, result);
+		return result;
+	}
+
+	SearchResult aStarSearchFromAny(const Grid& grid, const Pair* sources, size_t sourceCount, Pair dest, const SearchOptions& options, SearchContext& context)
+	{
+		PATHENGINE_STAT(StatsTimer timer);
+		const Query query = { sources, sourceCount, dest, false };
+		SearchResult result = runQuery(grid, query, options, context);
+
+		PATHENGINE_STAT(result.searchMicros = timer.elapsedMicros());
+		recordSearch(result.nearest < sourceCount ? sources[result.nearest] : dest, dest, result);
+		return result;
+	}
+}
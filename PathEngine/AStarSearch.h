@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Grid.h"
+#include "Heuristics.h"
+#include "OpenList.h"
+#include "SearchContext.h"
+
+namespace PathEngine
+{
+	class ComponentMap;
+	class LandmarkTable;
+
+	// Outcome of a single query
+	enum class SearchStatus
+	{
+		Found,
+		InvalidEndpoint,
+		BlockedEndpoint,
+		AlreadyAtDestination,
+		NoPath,
+
+		// SearchObserver::expanded asked the search to stop
+		Cancelled
+	};
+
+	enum class SearchMode
+	{
+		// Expand every neighbour of a cell
+		AStar,
+
+		// Only expand jump points, see JumpPointSearch.h. Always moves
+		// in 8 directions at octile cost and always uses the d-ary heap
+		JumpPoint,
+
+		// Grow one frontier from the source and one from the destination
+		// until they meet. Each covers about half the distance, so on long
+		// open queries the two explore far less than one frontier would.
+		// Always uses the d-ary heap
+		Bidirectional,
+
+		// Any-angle paths: a cell's parent can be any cell in a straight
+		// line of sight of it (see LineOfSight.h), so paths run straight
+		// across open ground at any angle, not only along the 8 moves, and
+		// need no smoothing afterwards. Close to the shortest such path,
+		// but not always it. Always moves in 8 directions, measures lines
+		// by their length, defaults to the Euclidean heuristic and always
+		// uses the d-ary heap
+		ThetaStar,
+
+		// Theta* with far fewer line of sight checks: one per expanded
+		// cell instead of one per neighbour of it. Paths are about as
+		// short, now and then a little longer
+		LazyThetaStar
+	};
+
+	/*
+	 Follows a search while it runs, for a front-end that animates it.
+	 The calls come from the thread running the search, and from two
+	 threads at once for a parallel Bidirectional search. They should be
+	 cheap: they are made for every cell the search touches.*/
+	class SearchObserver
+	{
+	public:
+		virtual ~SearchObserver() {}
+
+		// A cell was put on the open list for the first time
+		virtual void opened(Pair cell) { (void)cell; }
+
+		// A cell was taken off the open list to be expanded. Returning
+		// false stops the search with SearchStatus::Cancelled, blocking
+		// in here pauses it
+		virtual bool expanded(Pair cell) { (void)cell; return true; }
+	};
+
+	enum class PathFormat
+	{
+		// Every cell the path steps on
+		Cells,
+
+		// Only the source, the cells where the path changes direction
+		// and the destination. The path runs in a straight or diagonal
+		// line from each to the next, so a unit can steer from one to
+		// the next without the cells in between
+		Waypoints
+	};
+
+	/*
+	 Memory of the caller's for the path of a query, see
+	 SearchOptions::pathBuffer. The path is written front to back, so
+	 when it is longer than the buffer the start of it is there, from the
+	 source on, and size tells how long a buffer the whole path needs.*/
+	struct PathBuffer
+	{
+		PathBuffer() {}
+		PathBuffer(Pair* cells, size_t capacity) : cells(cells), capacity(capacity) {}
+
+		Pair* cells = nullptr;
+		size_t capacity = 0;
+
+		// Length of the path of the last query, 0 without one
+		size_t size = 0;
+
+		bool complete() const { return size <= capacity; }
+	};
+
+	struct SearchOptions
+	{
+		SearchMode mode = SearchMode::AStar;
+
+		// Also move diagonally, at a cost given by moveCost. A diagonal
+		// move may not cut the corner of a blocked cell
+		bool allowDiagonal = false;
+		MoveCostType moveCost = MoveCostType::Octile;
+
+		// See Heuristics.h. A weight above 1 trades path length for
+		// speed: the path is at most weight times longer than the best
+		HeuristicType heuristic = HeuristicType::Default;
+		double heuristicWeight = 1.0;
+
+		// Entering a cell costs its value in the grid (1 to 255) times
+		// the length of the step, instead of just the length. Costs are
+		// summed as exact integers, see Heuristics.h. Jump Point Search
+		// and the any-angle searches assume uniform costs, so they run as
+		// plain A* on terrain
+		bool terrainCosts = false;
+
+		// Precomputed landmark distances for the ALT heuristic, see
+		// Landmarks.h. Only used when the table was built for this grid
+		// and these moves, and never by Jump Point Search or the any-angle
+		// searches. On terrain a Bidirectional search can not use it
+		// either
+		const LandmarkTable* landmarks = nullptr;
+
+		// Connected regions of the grid, see Components.h. A query
+		// between two regions is answered with NoPath before searching.
+		// Only used while the map matches the grid
+		const ComponentMap* components = nullptr;
+
+		// Run the backward half of a Bidirectional search on a thread of
+		// its own. Starting it costs some tens of microseconds, and it is
+		// not worth it when queries already run in parallel
+		bool parallelBidirectional = true;
+
+		// Record every cell in the order it was put on the open list,
+		// so that a front-end can visualise the explored area afterwards
+		bool recordOpened = false;
+
+		// Told about every cell as the search goes, see SearchObserver.
+		// Not used by the hierarchical search or D* Lite
+		SearchObserver* observer = nullptr;
+
+		// How the path is given. The any-angle searches only ever give
+		// its corners
+		PathFormat pathFormat = PathFormat::Cells;
+
+		// Write the path here instead of to SearchResult::path. With the
+		// buffer and a SearchContext that has seen a grid of this size a
+		// query allocates nothing. Queries that share options must not
+		// run at once with a buffer, a BatchSearcher ignores it. Not used
+		// by the hierarchical search or D* Lite
+		PathBuffer* pathBuffer = nullptr;
+
+		// The bucket queue needs integral f values. When the moves or
+		// the heuristic are not integral, or one step spans too many
+		// values (costly terrain), the d-ary heap is used instead
+		OpenListType openList = OpenListType::DaryHeap;
+	};
+
+	struct SearchResult
+	{
+		SearchStatus status = SearchStatus::NoPath;
+
+		// Cells from the source to the destination, both included, or
+		// only the waypoints, see SearchOptions::pathFormat. For the
+		// any-angle searches only the corners, the path runs in a straight
+		// line from each to the next. Empty when the path went to
+		// SearchOptions::pathBuffer
+		std::vector<Pair> path;
+		double cost = 0.0;
+
+		// Number of cells taken off the open list / put on the open list
+		size_t expanded = 0;
+		size_t generated = 0;
+
+		// Most entries on the open list at once, stale copies included
+		// for open lists without decrease-key. Both halves added up for
+		// a bidirectional search
+		size_t peakOpen = 0;
+
+		// Cells put on the open list again with a lower g while already
+		// on it: a decrease-key on the d-ary heap, a duplicate entry on
+		// the open lists without one. This and the times below are only
+		// measured when the engine is built with statistics, see
+		// SearchStats.h
+		size_t reinserted = 0;
+
+		// Time taken by the whole query and by tracing the path back
+		double searchMicros = 0.0;
+		double reconstructMicros = 0.0;
+
+		// Number of cells whose search state the query had to initialise
+		size_t touched = 0;
+
+		// Only filled when SearchOptions::recordOpened is set
+		std::vector<Pair> opened;
+
+		// Which of the targets of aStarSearchToAny the path leads to, or
+		// of the sources of aStarSearchFromAny it comes from
+		size_t nearest = 0;
+
+		bool found() const { return status == SearchStatus::Found; }
+	};
+
+	// Human readable description of a search status
+	const char* statusMessage(SearchStatus status);
+
+	// Runs one query with its own temporary SearchContext. This costs
+	// an allocation the size of the grid, use the overload below when
+	// running many queries
+	SearchResult aStarSearch(const Grid& grid, Pair src, Pair dest, const SearchOptions& options = SearchOptions());
+
+	// Runs one query, reusing the memory of context
+	SearchResult aStarSearch(const Grid& grid, Pair src, Pair dest, const SearchOptions& options, SearchContext& context);
+
+	// The path from src to whichever of the targets is cheapest to reach,
+	// such as the closest exit, in one search that starts from all of
+	// them and runs back towards src. Targets that are off the grid,
+	// blocked or in another region (SearchOptions::components) are left
+	// out, the status only reports them when that leaves none. Runs a
+	// Bidirectional or any-angle mode as A*. For the cost of reaching
+	// every cell, see DistanceField.h
+	SearchResult aStarSearchToAny(const Grid& grid, Pair src, const Pair* targets, size_t targetCount, const SearchOptions& options, SearchContext& context);
+
+	// The path to dest from whichever of the sources can reach it
+	// cheapest, such as the nearest of several units. The same as
+	// aStarSearchToAny the other way round, searching forward from all
+	// the sources at once
+	SearchResult aStarSearchFromAny(const Grid& grid, const Pair* sources, size_t sourceCount, Pair dest, const SearchOptions& options, SearchContext& context);
+}
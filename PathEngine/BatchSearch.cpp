@@ -0,0 +1,38 @@
+#include "BatchSearch.h"
+
+namespace PathEngine
+{
+	BatchSearcher::BatchSearcher(unsigned threadCount)
+		: pool(threadCount), contexts(pool.threadCount())
+	{
+	}
+
+	void BatchSearcher::run(const Grid& grid, const PathQuery* queries, size_t count, const SearchOptions& options, SearchResult* results)
+	{
+		// Small ranges so a few long queries can not hold up a whole
+		// thread's share of the batch, large enough to keep stealing rare
+		const size_t grain = count / (size_t(pool.threadCount()) * 16) + 1;
+
+		// Every worker is busy already, a bidirectional query runs both
+		// its halves on the worker's own thread. Every path goes to its
+		// own result, the workers can not share one buffer
+		SearchOptions workerOptions = options;
+		workerOptions.parallelBidirectional = false;
+		workerOptions.pathBuffer = nullptr;
+
+		pool.parallelFor(count, grain, [&](size_t begin, size_t end, unsigned worker)
+		{
+			SearchContext& context = contexts[worker];
+
+			for (size_t i = begin; i < end; i++)
+				results[i] = aStarSearch(grid, queries[i].src, queries[i].dest, workerOptions, context);
+		});
+	}
+
+	std::vector<SearchResult> BatchSearcher::run(const Grid& grid, const std::vector<PathQuery>& queries, const SearchOptions& options)
+	{
+		std::vector<SearchResult> results(queries.size());
+		run(grid, queries.data(), queries.size(), options, results.data());
+		return results;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "AStarSearch.h"
+#include "ThreadPool.h"
+
+namespace PathEngine
+{
+	struct PathQuery
+	{
+		Pair src;
+		Pair dest;
+	};
+
+	/*
+	 Runs many independent queries against one shared grid. The grid is
+	 only read, so all workers search it at once; each worker thread
+	 keeps its own SearchContext between batches so queries do not
+	 allocate search memory. results[i] always belongs to queries[i].*/
+	class BatchSearcher
+	{
+	public:
+		// 0 threads means one per hardware thread
+		explicit BatchSearcher(unsigned threadCount = 0);
+
+		unsigned threadCount() const { return pool.threadCount(); }
+
+		void run(const Grid& grid, const PathQuery* queries, size_t count, const SearchOptions& options, SearchResult* results);
+		std::vector<SearchResult> run(const Grid& grid, const std::vector<PathQuery>& queries, const SearchOptions& options = SearchOptions());
+
+	private:
+		ThreadPool pool;
+		std::vector<SearchContext> contexts;
+	};
+}
@@ -0,0 +1,179 @@
+#include "BitGrid.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PATHENGINE_SSE2
+#endif
+
+namespace PathEngine
+{
+	BitGrid::BitGrid()
+		: numRows(0), numCols(0), stride(0), words(nullptr), wordCount(0)
+	{
+	}
+
+	BitGrid::BitGrid(const BitGrid& other)
+		: numRows(other.numRows), numCols(other.numCols), stride(other.stride),
+		  ownedWords(other.words, other.words + other.wordCount)
+	{
+		words = ownedWords.data();
+		wordCount = ownedWords.size();
+	}
+
+	BitGrid::BitGrid(BitGrid&& other)
+		: numRows(other.numRows), numCols(other.numCols), stride(other.stride),
+		  words(other.words), wordCount(other.wordCount), ownedWords(std::move(other.ownedWords))
+	{
+		other.numRows = other.numCols = 0;
+		other.stride = 0;
+		other.words = nullptr;
+		other.wordCount = 0;
+	}
+
+	BitGrid& BitGrid::operator=(const BitGrid& other)
+	{
+		if (this != &other)
+			*this = BitGrid(other);
+
+		return *this;
+	}
+
+	BitGrid& BitGrid::operator=(BitGrid&& other)
+	{
+		if (this == &other)
+			return *this;
+
+		numRows = other.numRows;
+		numCols = other.numCols;
+		stride = other.stride;
+		words = other.words;
+		wordCount = other.wordCount;
+		ownedWords = std::move(other.ownedWords);
+
+		other.numRows = other.numCols = 0;
+		other.stride = 0;
+		other.words = nullptr;
+		other.wordCount = 0;
+		other.ownedWords.clear();
+		return *this;
+	}
+
+	// Pad word on each side, one spare word so bitsFrom can always
+	// read the next word, rounded up to 4 words
+	size_t BitGrid::strideFor(int cols)
+	{
+		size_t words = (size_t(std::max(cols, 0)) + 63) / 64 + 3;
+		return (words + 3) & ~size_t(3);
+	}
+
+	size_t BitGrid::memoryBytesFor(int rows, int cols)
+	{
+		return (size_t(std::max(rows, 0)) + 2) * strideFor(cols) * sizeof(uint64_t);
+	}
+
+	void BitGrid::resize(int rows, int cols)
+	{
+		numRows = std::max(rows, 0);
+		numCols = std::max(cols, 0);
+		stride = strideFor(numCols);
+
+		ownedWords.assign((size_t(numRows) + 2) * stride, 0);
+		words = ownedWords.data();
+		wordCount = ownedWords.size();
+	}
+
+	void BitGrid::attach(uint64_t* external, int rows, int cols)
+	{
+		numRows = std::max(rows, 0);
+		numCols = std::max(cols, 0);
+		stride = strideFor(numCols);
+
+		ownedWords.clear();
+		ownedWords.shrink_to_fit();
+		words = external;
+		wordCount = (size_t(numRows) + 2) * stride;
+	}
+
+	void BitGrid::fill(bool walkable)
+	{
+		std::fill(words, words + wordCount, uint64_t(0));
+
+		if (!walkable)
+			return;
+
+		for (int row = 0; row < numRows; row++)
+		{
+			uint64_t* w = rowWords(row) + 1;
+			int col = 0;
+
+			for (; col + 64 <= numCols; col += 64)
+				*w++ = ~uint64_t(0);
+
+			if (col < numCols)
+				*w = (uint64_t(1) << (numCols - col)) - 1;
+		}
+	}
+
+	namespace
+	{
+		// 64 cells of a byte row as bits, 1 for every non-zero byte
+		uint64_t packWord(const uint8_t* cells, int count)
+		{
+			uint64_t bits = 0;
+			int i = 0;
+
+#ifdef PATHENGINE_SSE2
+			// 16 cells at a time: compare with zero and gather the sign bits
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + i));
+				uint32_t blocked = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)));
+				bits |= uint64_t(~blocked & 0xFFFF) << i;
+			}
+#endif
+
+			for (; i < count; i++)
+			{
+				if (cells[i] != 0)
+					bits |= uint64_t(1) << i;
+			}
+
+			return bits;
+		}
+	}
+
+	void BitGrid::assign(const uint8_t* cells, int rows, int cols, bool transpose)
+	{
+		if (!transpose)
+		{
+			resize(rows, cols);
+
+			for (int row = 0; row < rows; row++)
+			{
+				const uint8_t* source = cells + size_t(row) * size_t(cols);
+				uint64_t* w = rowWords(row) + 1;
+
+				for (int col = 0; col < cols; col += 64)
+					*w++ = packWord(source + col, std::min(64, cols - col));
+			}
+			return;
+		}
+
+		resize(cols, rows);
+
+		for (int row = 0; row < rows; row++)
+		{
+			const uint8_t* source = cells + size_t(row) * size_t(cols);
+
+			for (int col = 0; col < cols; col++)
+			{
+				if (source[col] != 0)
+					set(col, row, true);
+			}
+		}
+	}
+}
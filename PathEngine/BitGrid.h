@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace PathEngine
+{
+	// Index of the lowest / highest set bit of a non-zero word
+	inline int lowestBit(uint64_t bits)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return int(index);
+#else
+		return __builtin_ctzll(bits);
+#endif
+	}
+
+	inline int highestBit(uint64_t bits)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, bits);
+		return int(index);
+#else
+		return 63 - __builtin_clzll(bits);
+#endif
+	}
+
+	/*
+	 One bit per cell occupancy map, 1 --> walkable, 0 --> blocked.
+	 Every row is stored as 64-bit words with a blocked word on each side
+	 and there is a blocked row above and below the map, so cells up to
+	 one row and 64 columns outside the map can be read without a bounds
+	 check and read as blocked. The row stride is rounded up to 32 bytes.
+	 A 16k x 16k map takes 32 MiB.
+	 The words are normally owned by the grid, but can also be memory it
+	 was attached to, such as a mapped map file.*/
+	class BitGrid
+	{
+	public:
+		BitGrid();
+
+		// A copy always owns its words
+		BitGrid(const BitGrid& other);
+		BitGrid(BitGrid&& other);
+		BitGrid& operator=(const BitGrid& other);
+		BitGrid& operator=(BitGrid&& other);
+
+		// All cells start blocked
+		void resize(int rows, int cols);
+		void fill(bool walkable);
+
+		// Packs a row-major byte map (0 = blocked) into bits, optionally
+		// transposed so that columns become rows
+		void assign(const uint8_t* cells, int rows, int cols, bool transpose);
+
+		// Uses memoryBytesFor(rows, cols) bytes laid out like data() of a
+		// grid of that size in place, without copying them. The memory must
+		// outlive the grid, or its next resize or assign, which go back to
+		// words of its own
+		void attach(uint64_t* external, int rows, int cols);
+
+		int rows() const { return numRows; }
+		int cols() const { return numCols; }
+		size_t memoryBytes() const { return wordCount * sizeof(uint64_t); }
+		const uint64_t* data() const { return words; }
+
+		static size_t memoryBytesFor(int rows, int cols);
+
+		// row in [-1, rows], col in [-64, cols + 63]
+		bool test(int row, int col) const
+		{
+			size_t bit = size_t(col + PadBits);
+			return (rowWords(row)[bit >> 6] >> (bit & 63)) & 1;
+		}
+
+		void set(int row, int col, bool walkable)
+		{
+			size_t bit = size_t(col + PadBits);
+			uint64_t& word = rowWords(row)[bit >> 6];
+			uint64_t mask = uint64_t(1) << (bit & 63);
+			word = walkable ? (word | mask) : (word & ~mask);
+		}
+
+		// The 64 cells starting at col, bit 0 is col.
+		// row in [-1, rows], col in [-64, cols]
+		uint64_t bitsFrom(int row, int col) const
+		{
+			size_t bit = size_t(col + PadBits);
+			const uint64_t* w = rowWords(row) + (bit >> 6);
+			unsigned shift = unsigned(bit & 63);
+			return shift == 0 ? w[0] : (w[0] >> shift) | (w[1] << (64 - shift));
+		}
+
+		// The 64 cells ending at col, bit 63 is col.
+		// row in [-1, rows], col in [-1, cols + 63]
+		uint64_t bitsUpTo(int row, int col) const
+		{
+			return bitsFrom(row, col - 63);
+		}
+
+		// The 3x3 block around (row, col) as 9 bits, bit (dr + 1) * 3 + (dc + 1)
+		// is the cell (row + dr, col + dc)
+		uint32_t neighbourhood(int row, int col) const
+		{
+			return uint32_t(bitsFrom(row - 1, col - 1) & 7)
+				| uint32_t(bitsFrom(row, col - 1) & 7) << 3
+				| uint32_t(bitsFrom(row + 1, col - 1) & 7) << 6;
+		}
+
+	private:
+		static const int PadBits = 64;
+
+		static size_t strideFor(int cols);
+
+		const uint64_t* rowWords(int row) const { return words + size_t(row + 1) * stride; }
+		uint64_t* rowWords(int row) { return words + size_t(row + 1) * stride; }
+
+		int numRows;
+		int numCols;
+		size_t stride;
+
+		// Either ownedWords.data() or attached memory
+		uint64_t* words;
+		size_t wordCount;
+		std::vector<uint64_t> ownedWords;
+	};
+}
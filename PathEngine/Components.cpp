@@ -0,0 +1,493 @@
+#include "Components.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace PathEngine
+{
+	const uint32_t ComponentMap::Blocked;
+
+	namespace
+	{
+		// Union-find over cell indices where the root of a set is its
+		// lowest index. Path halving on the way up
+		uint32_t findRoot(uint32_t* parent, uint32_t cell)
+		{
+			while (parent[cell] != cell)
+			{
+				parent[cell] = parent[parent[cell]];
+				cell = parent[cell];
+			}
+
+			return cell;
+		}
+
+		void unite(uint32_t* parent, uint32_t a, uint32_t b)
+		{
+			a = findRoot(parent, a);
+			b = findRoot(parent, b);
+
+			if (a < b)
+				parent[b] = a;
+			else if (b < a)
+				parent[a] = b;
+		}
+
+		// The 8 cells around a cell in order round it, the 4 beside it
+		// at the even positions
+		const int ringRow[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+		const int ringCol[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	}
+
+	ComponentMap::ComponentMap()
+		: rows(0), cols(0), gridVersion(0), count(0), epoch(0)
+	{
+	}
+
+	void ComponentMap::clear()
+	{
+		rows = cols = 0;
+		gridVersion = 0;
+		labels.clear();
+		sizes.clear();
+		freeLabels.clear();
+		stamps.clear();
+		count = 0;
+	}
+
+	void ComponentMap::build(const Grid& grid, ThreadPool* pool)
+	{
+		rows = grid.rows();
+		cols = grid.cols();
+		gridVersion = grid.version();
+		freeLabels.clear();
+		stamps.clear();
+		epoch = 0;
+
+		const size_t cellCount = grid.size();
+		const uint8_t* cells = grid.data();
+		labels.resize(cellCount);
+
+		// Stripes of rows, a few per thread so an uneven stripe does not
+		// hold the others up
+		const size_t stripeCount = pool != nullptr ? std::min<size_t>(size_t(pool->threadCount()) * 4, size_t(std::max(rows, 1))) : 1;
+		const int stripeRows = int((size_t(rows) + stripeCount - 1) / stripeCount);
+
+		auto forStripes = [&](const std::function<void(size_t)>& task)
+		{
+			if (pool == nullptr)
+			{
+				for (size_t stripe = 0; stripe < stripeCount; stripe++)
+					task(stripe);
+				return;
+			}
+
+			pool->parallelFor(stripeCount, 1, [&](size_t begin, size_t end, unsigned)
+			{
+				for (size_t stripe = begin; stripe < end; stripe++)
+					task(stripe);
+			});
+		};
+
+		auto stripeBegin = [&](size_t stripe) { return size_t(std::min(int(stripe) * stripeRows, rows)) * size_t(cols); };
+		auto stripeEnd = [&](size_t stripe) { return size_t(std::min(int(stripe + 1) * stripeRows, rows)) * size_t(cols); };
+
+		// Each stripe joins every walkable cell to the one left of it and
+		// the one above it, unless that is in the stripe above. Every
+		// root is inside the stripe, so stripes never touch each other
+		std::vector<uint32_t> parent(cellCount);
+		uint32_t* links = parent.data();
+
+		forStripes([&](size_t stripe)
+		{
+			const size_t first = stripeBegin(stripe);
+
+			for (size_t i = first; i < stripeEnd(stripe); i++)
+			{
+				if (cells[i] == 0)
+				{
+					links[i] = Blocked;
+					continue;
+				}
+
+				links[i] = uint32_t(i);
+
+				if (i % size_t(cols) != 0 && links[i - 1] != Blocked)
+					unite(links, uint32_t(i), uint32_t(i - 1));
+
+				if (i >= first + size_t(cols) && links[i - cols] != Blocked)
+					unite(links, uint32_t(i), uint32_t(i - cols));
+			}
+		});
+
+		// Join the stripes along their borders
+		for (size_t stripe = 1; stripe < stripeCount; stripe++)
+		{
+			const size_t first = stripeBegin(stripe);
+			for (size_t i = first; i < std::min(first + size_t(cols), stripeEnd(stripe)); i++)
+			{
+				if (links[i] != Blocked && links[i - cols] != Blocked)
+					unite(links, uint32_t(i), uint32_t(i - cols));
+			}
+		}
+
+		// Every cell to its root, read only now so the stripes can run
+		// at once, then the roots are numbered in row-major order
+		std::vector<size_t> rootsBefore(stripeCount + 1, 0);
+
+		forStripes([&](size_t stripe)
+		{
+			size_t roots = 0;
+
+			for (size_t i = stripeBegin(stripe); i < stripeEnd(stripe); i++)
+			{
+				uint32_t root = links[i];
+				if (root != Blocked)
+				{
+					while (links[root] != root)
+						root = links[root];
+				}
+
+				labels[i] = root;
+				roots += root == uint32_t(i);
+			}
+
+			rootsBefore[stripe + 1] = roots;
+		});
+
+		for (size_t stripe = 0; stripe < stripeCount; stripe++)
+			rootsBefore[stripe + 1] += rootsBefore[stripe];
+
+		forStripes([&](size_t stripe)
+		{
+			uint32_t next = uint32_t(rootsBefore[stripe]);
+
+			for (size_t i = stripeBegin(stripe); i < stripeEnd(stripe); i++)
+			{
+				if (labels[i] == uint32_t(i))
+					links[i] = next++;
+			}
+		});
+
+		forStripes([&](size_t stripe)
+		{
+			for (size_t i = stripeBegin(stripe); i < stripeEnd(stripe); i++)
+			{
+				if (labels[i] != Blocked)
+					labels[i] = links[labels[i]];
+			}
+		});
+
+		count = rootsBefore[stripeCount];
+		sizes.assign(count, 0);
+
+		for (uint32_t label : labels)
+		{
+			if (label != Blocked)
+				sizes[label]++;
+		}
+	}
+
+	template <class Visit>
+	void ComponentMap::forNeighbours(uint32_t cell, const Visit& visit) const
+	{
+		const uint32_t component = labels[cell];
+		const uint32_t col = cell % uint32_t(cols);
+
+		if (cell >= uint32_t(cols) && labels[cell - cols] == component)
+			visit(cell - uint32_t(cols));
+		if (size_t(cell) + size_t(cols) < labels.size() && labels[cell + cols] == component)
+			visit(cell + uint32_t(cols));
+		if (col > 0 && labels[cell - 1] == component)
+			visit(cell - 1);
+		if (col + 1 < uint32_t(cols) && labels[cell + 1] == component)
+			visit(cell + 1);
+	}
+
+	uint32_t ComponentMap::newLabel()
+	{
+		count++;
+
+		if (!freeLabels.empty())
+		{
+			const uint32_t component = freeLabels.back();
+			freeLabels.pop_back();
+			return component;
+		}
+
+		sizes.push_back(0);
+		return uint32_t(sizes.size() - 1);
+	}
+
+	void ComponentMap::releaseLabel(uint32_t component)
+	{
+		count--;
+		sizes[component] = 0;
+		freeLabels.push_back(component);
+	}
+
+	void ComponentMap::update(const Grid& grid, int row, int col)
+	{
+		if (gridVersion == grid.previousVersion())
+			gridVersion = grid.version();
+
+		const uint32_t cell = uint32_t(size_t(row) * size_t(cols) + size_t(col));
+		const uint32_t component = labels[cell];
+		const bool walkable = grid.isUnBlocked(row, col);
+
+		// Only the cost changed
+		if (walkable == (component != Blocked))
+			return;
+
+		if (walkable)
+			open(cell);
+		else
+			close(cell, component);
+	}
+
+	// The cell joins the largest region beside it, the other regions
+	// beside it are relabelled into that one
+	void ComponentMap::open(uint32_t cell)
+	{
+		uint32_t beside[4];
+		uint32_t besideCell[4];
+		int besideCount = 0;
+
+		const int row = int(cell / uint32_t(cols)), col = int(cell % uint32_t(cols));
+
+		for (int i = 0; i < 8; i += 2)
+		{
+			const int r = row + ringRow[i], c = col + ringCol[i];
+			if (r < 0 || r >= rows || c < 0 || c >= cols)
+				continue;
+
+			const uint32_t next = uint32_t(size_t(r) * size_t(cols) + size_t(c));
+			const uint32_t component = labels[next];
+
+			if (component != Blocked && std::find(beside, beside + besideCount, component) == beside + besideCount)
+			{
+				beside[besideCount] = component;
+				besideCell[besideCount] = next;
+				besideCount++;
+			}
+		}
+
+		if (besideCount == 0)
+		{
+			labels[cell] = newLabel();
+			sizes[labels[cell]] = 1;
+			return;
+		}
+
+		int largest = 0;
+		for (int i = 1; i < besideCount; i++)
+		{
+			if (sizes[beside[i]] > sizes[beside[largest]])
+				largest = i;
+		}
+
+		const uint32_t target = beside[largest];
+		labels[cell] = target;
+		sizes[target]++;
+
+		std::vector<uint32_t>& queue = searches[0].cells;
+
+		for (int i = 0; i < besideCount; i++)
+		{
+			if (i == largest)
+				continue;
+
+			const uint32_t merged = beside[i];
+			queue.assign(1, besideCell[i]);
+			labels[besideCell[i]] = target;
+
+			// Relabelled cells no longer match merged, so none is queued twice
+			for (size_t head = 0; head < queue.size(); head++)
+			{
+				const uint32_t current = queue[head];
+				const uint32_t col = current % uint32_t(cols);
+
+				auto relabel = [&](uint32_t next)
+				{
+					if (labels[next] == merged)
+					{
+						labels[next] = target;
+						queue.push_back(next);
+					}
+				};
+
+				if (current >= uint32_t(cols)) relabel(current - uint32_t(cols));
+				if (size_t(current) + size_t(cols) < labels.size()) relabel(current + uint32_t(cols));
+				if (col > 0) relabel(current - 1);
+				if (col + 1 < uint32_t(cols)) relabel(current + 1);
+			}
+
+			sizes[target] += sizes[merged];
+			releaseLabel(merged);
+		}
+	}
+
+	void ComponentMap::close(uint32_t cell, uint32_t component)
+	{
+		labels[cell] = Blocked;
+		sizes[component]--;
+
+		const int row = int(cell / uint32_t(cols)), col = int(cell % uint32_t(cols));
+
+		// Which of the 8 cells around are in the region
+		bool ring[8];
+		int besideCount = 0;
+
+		for (int i = 0; i < 8; i++)
+		{
+			const int r = row + ringRow[i], c = col + ringCol[i];
+			ring[i] = r >= 0 && r < rows && c >= 0 && c < cols && labels[size_t(r) * size_t(cols) + size_t(c)] == component;
+			besideCount += (i % 2 == 0) && ring[i];
+		}
+
+		if (besideCount == 0)
+		{
+			releaseLabel(component);
+			return;
+		}
+
+		// The cells beside it still reach each other round the ring: walk
+		// it from a gap and count the runs that hold a cell beside it
+		int start = 0;
+		while (start < 8 && ring[start])
+			start++;
+
+		if (start == 8)
+			return;
+
+		int runs = 0;
+		bool inRun = false, runCounted = false;
+
+		for (int step = 1; step <= 8; step++)
+		{
+			const int i = (start + step) % 8;
+
+			if (!ring[i])
+			{
+				inRun = false;
+				continue;
+			}
+
+			if (!inRun)
+			{
+				inRun = true;
+				runCounted = false;
+			}
+
+			if (i % 2 == 0 && !runCounted)
+			{
+				runs++;
+				runCounted = true;
+			}
+		}
+
+		if (runs <= 1)
+			return;
+
+		// A search from each cell beside it, one cell each in turn. Two
+		// searches that meet are in one group; a group that runs out of
+		// cells while another group is left is a region of its own. Once a
+		// single group is left it keeps the old label
+		if (stamps.size() != labels.size() || epoch > 0xFFFFFFFF - 8)
+		{
+			stamps.assign(labels.size(), 0);
+			epoch = 0;
+		}
+
+		epoch += 4;
+
+		int searchCount = 0;
+		for (int i = 0; i < 8; i += 2)
+		{
+			if (!ring[i])
+				continue;
+
+			const uint32_t next = uint32_t(size_t(row + ringRow[i]) * size_t(cols) + size_t(col + ringCol[i]));
+
+			Search& search = searches[searchCount];
+			search.cells.assign(1, next);
+			search.head = 0;
+			search.group = searchCount;
+			search.finished = false;
+			stamps[next] = epoch + uint32_t(searchCount);
+			searchCount++;
+		}
+
+		auto groupOf = [&](int s)
+		{
+			while (searches[s].group != s)
+				s = searches[s].group;
+			return s;
+		};
+
+		int groupsLeft = searchCount;
+
+		while (groupsLeft > 1)
+		{
+			for (int s = 0; s < searchCount; s++)
+			{
+				Search& search = searches[s];
+				if (search.finished || search.head == search.cells.size())
+					continue;
+
+				forNeighbours(search.cells[search.head++], [&](uint32_t next)
+				{
+					const uint32_t stamp = stamps[next];
+
+					if (stamp >= epoch && stamp < epoch + 4)
+					{
+						const int mine = groupOf(s), theirs = groupOf(int(stamp - epoch));
+						if (mine != theirs)
+						{
+							searches[std::max(mine, theirs)].group = std::min(mine, theirs);
+							groupsLeft--;
+						}
+						return;
+					}
+
+					stamps[next] = epoch + uint32_t(s);
+					search.cells.push_back(next);
+				});
+			}
+
+			// Groups that ran out of cells come off as regions of their own
+			for (int g = 0; g < searchCount && groupsLeft > 1; g++)
+			{
+				if (groupOf(g) != g || searches[g].finished)
+					continue;
+
+				bool exhausted = true;
+				for (int s = 0; s < searchCount; s++)
+				{
+					if (groupOf(s) == g && searches[s].head < searches[s].cells.size())
+						exhausted = false;
+				}
+
+				if (!exhausted)
+					continue;
+
+				const uint32_t split = newLabel();
+
+				for (int s = 0; s < searchCount; s++)
+				{
+					if (groupOf(s) != g)
+						continue;
+
+					searches[s].finished = true;
+					for (uint32_t reached : searches[s].cells)
+						labels[reached] = split;
+
+					sizes[split] += uint32_t(searches[s].cells.size());
+				}
+
+				sizes[component] -= sizes[split];
+				groupsLeft--;
+			}
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Grid.h"
+#include "ThreadPool.h"
+
+namespace PathEngine
+{
+	/*
+	 The connected region of every walkable cell, so that a query between
+	 two regions is known to have no path without searching, see
+	 SearchOptions::components.
+	 Regions are 4-connected. A diagonal move may not cut a corner, so
+	 it never joins cells that 4-connected moves can not, and one map
+	 serves every kind of move and search. Costs do not matter.
+	 build labels rows in stripes, each with a union-find of its own on
+	 a thread of its own, joins the stripes along their borders and
+	 numbers the regions. update keeps the map current as cells change:
+	 opening a cell merges the regions beside it into the largest one,
+	 relabelling the others. Blocking one first looks at the 8 cells
+	 around it, which settles most cases; otherwise a search runs out of
+	 each neighbour at once and the parts that come off are relabelled,
+	 so the cost is the size of the smaller parts, not of the region.*/
+	class ComponentMap
+	{
+	public:
+		// The label of a blocked cell
+		static const uint32_t Blocked = 0xFFFFFFFF;
+
+		ComponentMap();
+
+		// Labels the whole grid, on the threads of pool when one is given
+		void build(const Grid& grid, ThreadPool* pool = nullptr);
+
+		// Call after every grid.set, with the cell that was set, to keep
+		// the map current
+		void update(const Grid& grid, int row, int col);
+
+		void clear();
+		bool empty() const { return labels.empty(); }
+
+		// Built for this grid and told about every change since. A map
+		// that does not match is out of date and must not be used
+		bool matches(const Grid& grid) const
+		{
+			return rows == grid.rows() && cols == grid.cols() && gridVersion == grid.version() && labels.size() == grid.size();
+		}
+
+		uint32_t label(int row, int col) const { return labels[size_t(row) * size_t(cols) + size_t(col)]; }
+
+		// Both cells walkable and in the same region
+		bool connected(Pair a, Pair b) const
+		{
+			const uint32_t first = label(a.first, a.second);
+			return first != Blocked && first == label(b.first, b.second);
+		}
+
+		size_t componentCount() const { return count; }
+
+		// Number of cells with the label
+		size_t componentSize(uint32_t component) const { return component < sizes.size() ? sizes[component] : 0; }
+
+	private:
+		uint32_t newLabel();
+		void releaseLabel(uint32_t component);
+
+		void open(uint32_t cell);
+		void close(uint32_t cell, uint32_t component);
+
+		// Cells that can be stepped to from cell, in the same region
+		template <class Visit>
+		void forNeighbours(uint32_t cell, const Visit& visit) const;
+
+		int rows;
+		int cols;
+		uint64_t gridVersion;
+
+		std::vector<uint32_t> labels;
+
+		// Cells per label, 0 for labels not in use, which are reused
+		std::vector<uint32_t> sizes;
+		std::vector<uint32_t> freeLabels;
+		size_t count;
+
+		// Scratch memory of update. A cell reached by search s of the
+		// current update has stamp epoch + s
+		struct Search
+		{
+			std::vector<uint32_t> cells;
+			size_t head;
+			int group;
+			bool finished;
+		};
+
+		Search searches[4];
+		std::vector<uint32_t> stamps;
+		uint32_t epoch;
+	};
+}
@@ -0,0 +1,356 @@
+#include "DStarLite.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+
+namespace PathEngine
+{
+	namespace
+	{
+		const double diagonalCost = 1.4142135623730951;
+
+		struct Direction
+		{
+			int di, dj;
+		};
+
+		const Direction directions[] =
+		{
+			{ -1,  0 },	// North
+			{  1,  0 },	// South
+			{  0,  1 },	// East
+			{  0, -1 },	// West
+			{ -1,  1 },	// North-East
+			{ -1, -1 },	// North-West
+			{  1,  1 },	// South-East
+			{  1, -1 },	// South-West
+		};
+
+		uint32_t bit(int di, int dj) { return 1u << ((di + 1) * 3 + (dj + 1)); }
+
+		// Calls visit(next, cost) for every move out of a cell, under the
+		// same rules as the A* search: nothing leaves a blocked cell and a
+		// diagonal move may not cut the corner of a blocked cell. Moves are
+		// symmetric, so these are also the moves into the cell
+		template <class Visit>
+		void forEachMove(const Grid& grid, bool diagonal, uint32_t index, Visit visit)
+		{
+			const Pair pos = grid.position(index);
+			const uint32_t around = grid.bits().neighbourhood(pos.first, pos.second);
+
+			if (!(around & bit(0, 0)))
+				return;
+
+			const int count = diagonal ? 8 : 4;
+			for (int i = 0; i < count; i++)
+			{
+				const Direction& d = directions[i];
+				const uint32_t needed = i < 4 ? bit(d.di, d.dj) : bit(d.di, d.dj) | bit(d.di, 0) | bit(0, d.dj);
+
+				if ((around & needed) == needed)
+					visit(grid.index(pos.first + d.di, pos.second + d.dj), i < 4 ? 1.0 : diagonalCost);
+			}
+		}
+	}
+
+	DStarLite::DStarLite(bool allowDiagonal)
+		: diagonal(allowDiagonal), rows(0), cols(0), start(0), goal(0), planned(false), km(0.0), generation(0), touched(0), generated(0)
+	{
+	}
+
+	void DStarLite::reset()
+	{
+		planned = false;
+	}
+
+	DStarLite::Cell& DStarLite::cell(uint32_t index)
+	{
+		Cell& c = cells[index];
+		if (c.stamp != generation)
+		{
+			c.g = DBL_MAX;
+			c.rhs = DBL_MAX;
+			c.stamp = generation;
+			touched++;
+		}
+		return c;
+	}
+
+	// Manhattan distance, or octile distance with diagonal moves. Both are
+	// exact on an empty grid, so never more than the true distance
+	double DStarLite::heuristic(uint32_t from, uint32_t to) const
+	{
+		const int di = std::abs(int(from / uint32_t(cols)) - int(to / uint32_t(cols)));
+		const int dj = std::abs(int(from % uint32_t(cols)) - int(to % uint32_t(cols)));
+
+		if (!diagonal)
+			return double(di + dj);
+
+		// Sums of sqrt(2) round differently depending on the order they
+		// are added in, and an h a hair above g would let the search stop
+		// one cell too early. Shrinking h keeps it safely below the sum
+		const double octile = double(std::max(di, dj)) + (diagonalCost - 1.0) * double(std::min(di, dj));
+		return octile * (1.0 - 1e-9);
+	}
+
+	DStarLite::Key DStarLite::calculateKey(uint32_t index)
+	{
+		const Cell& c = cell(index);
+		const double best = std::min(c.g, c.rhs);
+
+		if (best == DBL_MAX)
+			return Key{ DBL_MAX, DBL_MAX };
+
+		return Key{ best + heuristic(start, index) + km, best };
+	}
+
+	void DStarLite::updateVertex(const Grid& grid, uint32_t index)
+	{
+		Cell& c = cell(index);
+
+		if (index != goal)
+		{
+			double rhs = DBL_MAX;
+			forEachMove(grid, diagonal, index, [&](uint32_t next, double cost)
+			{
+				const double g = cell(next).g;
+				if (g != DBL_MAX)
+					rhs = std::min(rhs, g + cost);
+			});
+			c.rhs = rhs;
+		}
+
+		queueVertex(index);
+	}
+
+	void DStarLite::queueVertex(uint32_t index)
+	{
+		const Cell& c = cell(index);
+		const bool queued = openList.contains(index);
+
+		if (c.g != c.rhs)
+		{
+			if (queued)
+			{
+				openList.update(index, calculateKey(index));
+			}
+			else
+			{
+				openList.push(index, calculateKey(index));
+				generated++;
+			}
+		}
+		else if (queued)
+		{
+			openList.remove(index);
+		}
+	}
+
+	void DStarLite::computeShortestPath(const Grid& grid, SearchResult& result)
+	{
+		while (!openList.empty())
+		{
+			// Done once the source is consistent and nothing left on the
+			// open list can still lower its distance
+			const Cell& source = cell(start);
+			if (!(openList.topKey() < calculateKey(start)) && source.g == source.rhs)
+				break;
+
+			const uint32_t current = openList.top();
+			const Key oldKey = openList.topKey();
+			const Key newKey = calculateKey(current);
+
+			// Queued before the source moved, its key is out of date
+			if (oldKey < newKey)
+			{
+				openList.update(current, newKey);
+				continue;
+			}
+
+			result.expanded++;
+			Cell& c = cell(current);
+
+			if (c.g > c.rhs)
+			{
+				// Overconsistent: its distance went down, settle it and
+				// offer the new distance to the neighbours
+				c.g = c.rhs;
+				openList.remove(current);
+
+				forEachMove(grid, diagonal, current, [&](uint32_t next, double cost)
+				{
+					if (next == goal)
+						return;
+
+					Cell& n = cell(next);
+					if (c.g + cost < n.rhs)
+					{
+						n.rhs = c.g + cost;
+						queueVertex(next);
+					}
+				});
+			}
+			else
+			{
+				// Underconsistent: its distance went up, so everything that
+				// leaned on it has to look for another way
+				c.g = DBL_MAX;
+				updateVertex(grid, current);
+
+				forEachMove(grid, diagonal, current, [&](uint32_t next, double)
+				{
+					updateVertex(grid, next);
+				});
+			}
+		}
+	}
+
+	// Follows the cheapest move out of each cell from the source down
+	// to the destination
+	void DStarLite::tracePath(const Grid& grid, SearchResult& result)
+	{
+		uint32_t current = start;
+		result.path.push_back(grid.position(current));
+
+		while (current != goal)
+		{
+			double best = DBL_MAX;
+			uint32_t bestNext = current;
+
+			forEachMove(grid, diagonal, current, [&](uint32_t next, double cost)
+			{
+				const double g = cell(next).g;
+				if (g != DBL_MAX && g + cost < best)
+				{
+					best = g + cost;
+					bestNext = next;
+				}
+			});
+
+			// Cannot happen with a consistent source, but a broken path
+			// must never turn into an endless loop
+			if (best == DBL_MAX || result.path.size() > grid.size())
+			{
+				result.status = SearchStatus::NoPath;
+				result.path.clear();
+				return;
+			}
+
+			current = bestNext;
+			result.path.push_back(grid.position(current));
+		}
+
+		result.status = SearchStatus::Found;
+	}
+
+	SearchResult DStarLite::plan(const Grid& grid, Pair src, Pair dest)
+	{
+		SearchResult result;
+
+		// Either the source or the destination is invalid
+		if (!grid.isValid(src.first, src.second) || !grid.isValid(dest.first, dest.second))
+		{
+			result.status = SearchStatus::InvalidEndpoint;
+			return result;
+		}
+
+		// Either the source or the destination is blocked
+		if (!grid.isUnBlocked(src.first, src.second) || !grid.isUnBlocked(dest.first, dest.second))
+		{
+			result.status = SearchStatus::BlockedEndpoint;
+			return result;
+		}
+
+		// If the destination cell is the same as source cell
+		if (src == dest)
+		{
+			result.status = SearchStatus::AlreadyAtDestination;
+			result.path.push_back(src);
+			return result;
+		}
+
+		const uint32_t srcIndex = grid.index(src.first, src.second);
+		const uint32_t destIndex = grid.index(dest.first, dest.second);
+
+		if (!planned || rows != grid.rows() || cols != grid.cols() || goal != destIndex)
+		{
+			// A new destination invalidates every distance. Like a
+			// SearchContext the cells are reset lazily through a new
+			// generation, so this does not cost a pass over the map
+			rows = grid.rows();
+			cols = grid.cols();
+
+			if (cells.size() < grid.size())
+				cells.resize(grid.size(), Cell{ DBL_MAX, DBL_MAX, 0 });
+
+			if (++generation == 0)
+			{
+				for (Cell& c : cells)
+					c.stamp = 0;
+				generation = 1;
+			}
+
+			openList.clear();
+			openList.reserve(grid.size());
+			km = 0.0;
+			start = srcIndex;
+			goal = destIndex;
+			planned = true;
+
+			cell(goal).rhs = 0.0;
+			openList.push(goal, calculateKey(goal));
+			generated++;
+		}
+		else if (srcIndex != start)
+		{
+			km += heuristic(start, srcIndex);
+			start = srcIndex;
+		}
+
+		computeShortestPath(grid, result);
+
+		if (cell(start).g == DBL_MAX)
+			result.status = SearchStatus::NoPath;
+		else
+		{
+			result.cost = cell(start).g;
+			tracePath(grid, result);
+		}
+
+		result.generated = generated;
+		result.touched = touched;
+		generated = 0;
+		touched = 0;
+		return result;
+	}
+
+	void DStarLite::update(const Grid& grid, const std::vector<Pair>& changedCells)
+	{
+		// plan starts over on a grid of another size anyway
+		if (!planned || rows != grid.rows() || cols != grid.cols())
+			return;
+
+		const int count = diagonal ? 8 : 4;
+
+		for (const Pair& p : changedCells)
+		{
+			if (!grid.isValid(p.first, p.second))
+				continue;
+
+			// The moves that changed all start or end at the cell itself,
+			// or (diagonally) pass its corner, so the cell and its
+			// neighbours are the only ones whose rhs can be different
+			updateVertex(grid, grid.index(p.first, p.second));
+
+			for (int i = 0; i < count; i++)
+			{
+				const int ni = p.first + directions[i].di;
+				const int nj = p.second + directions[i].dj;
+
+				if (grid.isValid(ni, nj))
+					updateVertex(grid, grid.index(ni, nj));
+			}
+		}
+	}
+}
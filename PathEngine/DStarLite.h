@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AStarSearch.h"
+
+namespace PathEngine
+{
+	/*
+	 Incremental replanning with D* Lite (Koenig and Likhachev).
+	 The search runs backwards from the destination and keeps its state
+	 between calls: for every cell it touched it remembers g, the distance
+	 to the destination it last settled on, and rhs, the distance its
+	 neighbours currently vouch for. When cells change only the cells
+	 around them become inconsistent (g != rhs), and the next plan only
+	 repairs those and whatever depends on them, so the cost of a replan
+	 follows the size of the change rather than the size of the map.
+	 The source may move between calls (an agent walking its path), the
+	 state is only thrown away when the destination or the grid size
+	 changes.
+
+	 Typical use:
+	   DStarLite planner;
+	   planner.plan(grid, agent, goal);
+	   ... grid.set(row, col, 0) for some cells ...
+	   planner.update(grid, changedCells);
+	   planner.plan(grid, agent, goal);    // repairs instead of searching again*/
+	class DStarLite
+	{
+	public:
+		explicit DStarLite(bool allowDiagonal = false);
+
+		// Shortest path from src to dest on grid. Reuses the state of the
+		// previous call when dest and the grid size are the same.
+		// expanded and touched only count the work done by this call
+		SearchResult plan(const Grid& grid, Pair src, Pair dest);
+
+		// Tells the planner the listed cells of grid have changed since
+		// the last plan. Cheap: the repair itself happens in the next plan
+		void update(const Grid& grid, const std::vector<Pair>& changedCells);
+
+		// Forgets everything, the next plan starts from scratch
+		void reset();
+
+	private:
+		// D* Lite orders cells on [min(g, rhs) + h + km, min(g, rhs)]
+		struct Key
+		{
+			double first, second;
+
+			bool operator<(const Key& other) const
+			{
+				return first < other.first || (first == other.first && second < other.second);
+			}
+		};
+
+		// g and rhs of a cell, reset lazily like the nodes of a SearchContext
+		struct Cell
+		{
+			double g;
+			double rhs;
+			uint32_t stamp;
+		};
+
+		Cell& cell(uint32_t index);
+		double heuristic(uint32_t from, uint32_t to) const;
+		Key calculateKey(uint32_t index);
+
+		// Recomputes rhs from the neighbours and queues the cell
+		void updateVertex(const Grid& grid, uint32_t index);
+
+		// Puts the cell on or takes it off the open list depending on
+		// whether it is consistent
+		void queueVertex(uint32_t index);
+
+		void computeShortestPath(const Grid& grid, SearchResult& result);
+		void tracePath(const Grid& grid, SearchResult& result);
+
+		bool diagonal;
+
+		int rows;
+		int cols;
+		uint32_t start;
+		uint32_t goal;
+		bool planned;
+
+		// Added to every key when the source moves, so the keys already on
+		// the open list stay valid lower bounds without re-keying them
+		double km;
+
+		std::vector<Cell> cells;
+		uint32_t generation;
+
+		// Work done since the last plan returned
+		size_t touched;
+		size_t generated;
+
+		IndexedDaryHeap<4, Key> openList;
+	};
+}
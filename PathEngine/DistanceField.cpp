@@ -0,0 +1,351 @@
+#include "DistanceField.h"
+
+#include <algorithm>
+
+namespace PathEngine
+{
+	namespace
+	{
+		struct Direction
+		{
+			int di, dj;
+		};
+
+		const Direction moves[] =
+		{
+			{ -1,  0 },	// North
+			{  1,  0 },	// South
+			{  0,  1 },	// East
+			{  0, -1 },	// West
+			{ -1,  1 },	// North-East
+			{ -1, -1 },	// North-West
+			{  1,  1 },	// South-East
+			{  1, -1 },	// South-West
+		};
+
+		uint32_t bit(int di, int dj) { return 1u << ((di + 1) * 3 + (dj + 1)); }
+
+		// Whether the move in direction i can be made from a cell with the
+		// 3x3 neighbourhood around. A diagonal move may not cut a corner,
+		// so a move can be made one way exactly when it can the other way
+		bool canMove(uint32_t around, int i)
+		{
+			const Direction& d = moves[i];
+			const uint32_t needed = i < 4 ? bit(d.di, d.dj) : bit(d.di, d.dj) | bit(d.di, 0) | bit(0, d.dj);
+			return (around & needed) == needed;
+		}
+
+		// Buckets narrower than this are expanded on the calling thread,
+		// waking the pool would cost more than it saves
+		const size_t parallelBucket = 4096;
+		const size_t bucketGrain = 1024;
+	}
+
+	const uint32_t DistanceField::Unreachable;
+	const uint8_t DistanceField::NoDirection;
+
+	DistanceField::DistanceField()
+		: rows(0), cols(0), gridVersion(0), unitScale(1), cellCount(0),
+		  moveCount(4), terrain(false), straightLength(1), diagonalLength(1)
+	{
+	}
+
+	void DistanceField::clear()
+	{
+		rows = cols = 0;
+		gridVersion = 0;
+		unitScale = 1;
+		cellCount = 0;
+		distances.reset();
+		directions.clear();
+		targetCells.clear();
+		directions.shrink_to_fit();
+	}
+
+	void DistanceField::build(const Grid& grid, const Pair* targets, size_t targetCount, const SearchOptions& options, ThreadPool* pool)
+	{
+		// The memory of the last field is reused for a grid of the same size
+		if (grid.size() != cellCount)
+		{
+			cellCount = grid.size();
+			distances.reset(new std::atomic<uint32_t>[cellCount]);
+		}
+
+		rows = grid.rows();
+		cols = grid.cols();
+		gridVersion = grid.version();
+
+		const bool diagonal = options.allowDiagonal;
+		const bool octile = diagonal && options.moveCost == MoveCostType::Octile;
+
+		moveCount = diagonal ? 8 : 4;
+		terrain = options.terrainCosts;
+		unitScale = octile ? 1024 : 1;
+		straightLength = unitScale;
+		diagonalLength = !octile ? 1 : terrain ? uint32_t(TerrainOctileMoves::diagonal) : 1448;
+
+		for (size_t i = 0; i < cellCount; i++)
+			distances[i].store(Unreachable, std::memory_order_relaxed);
+
+		// Every move costs at least a bucket, so a cell is never lowered
+		// into the bucket being expanded, and at most span buckets
+		const uint64_t width = uint64_t(straightLength) * (terrain ? grid.minCost() : 1);
+		const uint64_t longest = uint64_t(diagonal ? diagonalLength : straightLength) * (terrain ? 255 : 1);
+		const size_t span = size_t(longest / width) + 2;
+
+		// Cells waiting in each bucket, kept apart by the worker that
+		// lowered them, in a ring of span buckets
+		const unsigned workers = pool != nullptr ? pool->threadCount() : 1;
+		std::vector<std::vector<std::vector<uint32_t>>> waiting(workers, std::vector<std::vector<uint32_t>>(span));
+		std::vector<size_t> added(workers, 0);
+		size_t queued = 0;
+
+		targetCells.clear();
+		for (size_t i = 0; i < targetCount; i++)
+		{
+			const Pair target = targets[i];
+			if (!grid.isValid(target.first, target.second))
+				continue;
+
+			// Kept, to notice when a blocked one opens
+			targetCells.push_back(target);
+			if (!grid.isUnBlocked(target.first, target.second))
+				continue;
+
+			const uint32_t cell = grid.index(target.first, target.second);
+			if (distances[cell].exchange(0, std::memory_order_relaxed) != 0)
+			{
+				waiting[0][0].push_back(cell);
+				queued++;
+			}
+		}
+
+		std::vector<uint32_t> bucket;
+
+		auto expand = [&](uint64_t number, size_t begin, size_t end, unsigned worker)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const uint32_t cell = bucket[i];
+				const uint32_t g = distances[cell].load(std::memory_order_relaxed);
+
+				// Lowered into an earlier bucket since, and expanded there
+				if (g / width != number)
+					continue;
+
+				const Pair pos = grid.position(cell);
+				const uint32_t around = grid.bits().neighbourhood(pos.first, pos.second);
+
+				// The cells a move onto this one can be made from. On
+				// terrain the move costs this cell, the one it enters
+				const uint64_t cost = terrain ? grid.get(pos.first, pos.second) : 1;
+
+				for (int m = 0; m < moveCount; m++)
+				{
+					if (!canMove(around, m))
+						continue;
+
+					const uint64_t lowered = g + (m < 4 ? straightLength : diagonalLength) * cost;
+					if (lowered >= Unreachable)
+						continue;
+
+					const uint32_t next = grid.index(pos.first + moves[m].di, pos.second + moves[m].dj);
+					uint32_t seen = distances[next].load(std::memory_order_relaxed);
+
+					while (lowered < seen && !distances[next].compare_exchange_weak(seen, uint32_t(lowered), std::memory_order_relaxed))
+					{
+					}
+
+					if (lowered < seen)
+					{
+						waiting[worker][size_t((lowered / width) % span)].push_back(next);
+						added[worker]++;
+					}
+				}
+			}
+		};
+
+		for (uint64_t number = 0; queued > 0; number++)
+		{
+			const size_t slot = size_t(number % span);
+
+			bucket.clear();
+			for (unsigned w = 0; w < workers; w++)
+			{
+				bucket.insert(bucket.end(), waiting[w][slot].begin(), waiting[w][slot].end());
+				waiting[w][slot].clear();
+			}
+
+			queued -= bucket.size();
+			if (bucket.empty())
+				continue;
+
+			if (pool != nullptr && bucket.size() >= parallelBucket)
+			{
+				pool->parallelFor(bucket.size(), bucketGrain, [&](size_t begin, size_t end, unsigned worker)
+				{
+					expand(number, begin, end, worker);
+				});
+			}
+			else
+			{
+				expand(number, 0, bucket.size(), 0);
+			}
+
+			for (unsigned w = 0; w < workers; w++)
+			{
+				queued += added[w];
+				added[w] = 0;
+			}
+		}
+
+		findDirections(grid, pool);
+	}
+
+	// Every reachable cell that is not a target has a neighbour whose
+	// distance plus the move onto it is its own. The first of them in
+	// the order of moves is the way to go, straight moves first
+	void DistanceField::findDirections(const Grid& grid, ThreadPool* pool)
+	{
+		directions.assign(cellCount, NoDirection);
+
+		auto findRows = [&](size_t begin, size_t end, unsigned)
+		{
+			for (int row = int(begin); row < int(end); row++)
+			{
+				for (int col = 0; col < cols; col++)
+				{
+					const size_t cell = index(row, col);
+					const uint32_t g = distances[cell].load(std::memory_order_relaxed);
+
+					if (g == 0 || g == Unreachable)
+						continue;
+
+					const uint32_t around = grid.bits().neighbourhood(row, col);
+
+					for (int m = 0; m < moveCount; m++)
+					{
+						if (canMove(around, m) && through(grid, row, col, m) == g)
+						{
+							directions[cell] = uint8_t(m);
+							break;
+						}
+					}
+				}
+			}
+		};
+
+		if (pool != nullptr && cellCount >= parallelBucket)
+			pool->parallelFor(size_t(rows), 16, findRows);
+		else
+			findRows(0, size_t(rows), 0);
+	}
+
+	uint64_t DistanceField::through(const Grid& grid, int row, int col, int m) const
+	{
+		const int ni = row + moves[m].di;
+		const int nj = col + moves[m].dj;
+
+		const uint64_t there = distances[index(ni, nj)].load(std::memory_order_relaxed);
+		if (there == Unreachable)
+			return Unreachable;
+
+		return there + uint64_t(m < 4 ? straightLength : diagonalLength) * (terrain ? grid.get(ni, nj) : 1);
+	}
+
+	// A field is right when every walkable cell that is not a target is
+	// one move more than the best of its neighbours, and its direction
+	// is such a move. A cell only takes part in the moves of the 3x3
+	// block around it, so the changed cell is measured again from its
+	// neighbours, and the field is kept when that leaves the neighbours
+	// right as they are
+	bool DistanceField::update(const Grid& grid, int row, int col)
+	{
+		if (empty() || rows != grid.rows() || cols != grid.cols() || gridVersion != grid.previousVersion())
+			return false;
+
+		uint64_t changed = Unreachable;
+		uint8_t changedDirection = NoDirection;
+
+		// The distance through move m from (i, j), with the changed cell
+		// at its new distance
+		auto reach = [&](int i, int j, int m) -> uint64_t
+		{
+			const int ni = i + moves[m].di;
+			const int nj = j + moves[m].dj;
+
+			const uint64_t there = ni == row && nj == col ? changed : distance(ni, nj);
+			if (there == Unreachable)
+				return Unreachable;
+
+			return there + uint64_t(m < 4 ? straightLength : diagonalLength) * (terrain ? grid.get(ni, nj) : 1);
+		};
+
+		// The best distance of (i, j) and the first move that gives it
+		auto measure = [&](int i, int j, uint8_t& direction) -> uint64_t
+		{
+			const uint32_t around = grid.bits().neighbourhood(i, j);
+			uint64_t best = Unreachable;
+			direction = NoDirection;
+
+			for (int m = 0; m < moveCount; m++)
+			{
+				if (!canMove(around, m))
+					continue;
+
+				const uint64_t there = reach(i, j, m);
+				if (there < best)
+				{
+					best = there;
+					direction = uint8_t(m);
+				}
+			}
+
+			return best;
+		};
+
+		if (grid.isUnBlocked(row, col))
+		{
+			if (std::find(targetCells.begin(), targetCells.end(), Pair(row, col)) != targetCells.end())
+				changed = 0;
+			else
+				changed = measure(row, col, changedDirection);
+		}
+
+		for (int i = row - 1; i <= row + 1; i++)
+		{
+			for (int j = col - 1; j <= col + 1; j++)
+			{
+				if ((i == row && j == col) || !grid.isValid(i, j) || !grid.isUnBlocked(i, j))
+					continue;
+
+				const uint32_t g = distance(i, j);
+				if (g == 0)
+					continue;
+
+				uint8_t best = NoDirection;
+				if (measure(i, j, best) != g)
+					return false;
+
+				const uint8_t direction = directions[index(i, j)];
+				if (g != Unreachable && (direction == NoDirection || !canMove(grid.bits().neighbourhood(i, j), direction) || reach(i, j, direction) != g))
+					return false;
+			}
+		}
+
+		distances[index(row, col)].store(uint32_t(changed), std::memory_order_relaxed);
+		directions[index(row, col)] = changedDirection;
+
+		gridVersion = grid.version();
+		return true;
+	}
+
+	Pair DistanceField::next(int row, int col) const
+	{
+		const uint8_t direction = directions[index(row, col)];
+		if (direction == NoDirection)
+			return Pair(row, col);
+
+		return Pair(row + moves[direction].di, col + moves[direction].dj);
+	}
+}
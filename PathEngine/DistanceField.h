@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "AStarSearch.h"
+#include "ThreadPool.h"
+
+namespace PathEngine
+{
+	/*
+	 The cost of getting from every cell to the nearest of a set of
+	 targets, and the first move of the way there: a flow field. Built
+	 once, it lets any number of agents find their way by following next
+	 from wherever they are, one lookup per step instead of a search per
+	 agent. After build the field is only read, by as many threads at
+	 once as wanted.
+	 Distances are exact integers in the units of LandmarkTable: steps,
+	 or 1/1024th of a step with octile diagonals, which count 1448, or
+	 the 1449 of the terrain search. On terrain a move costs the cell it
+	 enters, as it does in the search.
+	 build is Dijkstra from all the targets at once, run as a wavefront
+	 over buckets of distances. No move costs less than a straight step
+	 onto the cheapest cell, so with buckets that wide every cell in the
+	 lowest bucket is final, and the whole bucket is expanded at once, on
+	 the threads of the pool when it is wide enough to be worth it. The
+	 distances do not depend on the order the cells were expanded in, so
+	 the field is the same on any number of threads.*/
+	class DistanceField
+	{
+	public:
+		// Distance of a cell that can not reach a target, or too far to count
+		static const uint32_t Unreachable = 0xFFFFFFFFu;
+
+		DistanceField();
+
+		// Measures every cell with the moves (allowDiagonal, moveCost,
+		// terrainCosts) of options. Targets that are off the grid or
+		// blocked are left out
+		void build(const Grid& grid, const Pair* targets, size_t targetCount, const SearchOptions& options, ThreadPool* pool = nullptr);
+
+		// Call after a grid.set, with the cell that was set. Keeps the
+		// field, measuring the cell again, when the change leaves every
+		// other distance and move as it was, which is the case unless a
+		// way through the cell opened, closed or changed in cost, and
+		// returns whether it did. A field that is not kept is out of
+		// date, build it again. No other thread may read the field
+		// meanwhile
+		bool update(const Grid& grid, int row, int col);
+
+		void clear();
+		bool empty() const { return cellCount == 0; }
+
+		// Memory the field takes
+		size_t bytes() const { return cellCount * (sizeof(uint32_t) + sizeof(uint8_t)); }
+
+		// The grid version the field is right for
+		uint64_t version() const { return gridVersion; }
+
+		// Built for this grid and told about every change since. A field
+		// that does not match is out of date, build it again
+		bool matches(const Grid& grid) const
+		{
+			return rows == grid.rows() && cols == grid.cols() && gridVersion == grid.version();
+		}
+
+		// Units per step, 1024 with octile diagonals, else 1
+		uint32_t scale() const { return unitScale; }
+
+		uint32_t distance(int row, int col) const { return distances[index(row, col)].load(std::memory_order_relaxed); }
+		bool reachable(int row, int col) const { return distance(row, col) != Unreachable; }
+
+		// The cell to move to from (row, col) on a cheapest way to the
+		// nearest target. The cell itself on a target, and where no
+		// target can be reached
+		Pair next(int row, int col) const;
+
+	private:
+		static const uint8_t NoDirection = 0xFF;
+
+		size_t index(int row, int col) const { return size_t(row) * size_t(cols) + size_t(col); }
+
+		void findDirections(const Grid& grid, ThreadPool* pool);
+
+		// The distance of (row, col) through the move m, Unreachable when
+		// the cell moved to can not reach a target
+		uint64_t through(const Grid& grid, int row, int col, int m) const;
+
+		int rows;
+		int cols;
+		uint64_t gridVersion;
+		uint32_t unitScale;
+		size_t cellCount;
+
+		// The targets on the grid, blocked or not
+		std::vector<Pair> targetCells;
+
+		// The moves of the options the field was built with
+		int moveCount;
+		bool terrain;
+		uint32_t straightLength;
+		uint32_t diagonalLength;
+
+		// Atomic while build lowers them from several threads
+		std::unique_ptr<std::atomic<uint32_t>[]> distances;
+
+		// The first move towards the nearest target, an index into the
+		// moves of DistanceField.cpp, or NoDirection
+		std::vector<uint8_t> directions;
+	};
+}
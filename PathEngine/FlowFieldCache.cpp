@@ -0,0 +1,246 @@
+#include "FlowFieldCache.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace PathEngine
+{
+	// An entry is taken for a new field by clearing its key and then
+	// finding no pins; a lease pins it and then finds the key still set.
+	// Both sides write before they read, all sequentially consistent, so
+	// at most one of them can succeed
+	struct FlowFieldCache::Entry
+	{
+		std::atomic<uint64_t> key{ NoKey };
+		std::atomic<uint32_t> pins{ 0 };
+		std::atomic<uint64_t> lastUsed{ 0 };
+
+		// Only written by the thread holding writeLock, and only while
+		// the key is cleared or no lease can read it
+		DistanceField field;
+	};
+
+	const uint64_t FlowFieldCache::NoKey;
+
+	FlowFieldCache::Lease::Lease(Lease&& other)
+		: entry(other.entry), field(other.field), ownField(std::move(other.ownField))
+	{
+		other.entry = nullptr;
+		other.field = nullptr;
+	}
+
+	FlowFieldCache::Lease& FlowFieldCache::Lease::operator=(Lease&& other)
+	{
+		if (this != &other)
+		{
+			release();
+
+			entry = other.entry;
+			field = other.field;
+			ownField = std::move(other.ownField);
+
+			other.entry = nullptr;
+			other.field = nullptr;
+		}
+
+		return *this;
+	}
+
+	FlowFieldCache::Lease::~Lease()
+	{
+		release();
+	}
+
+	void FlowFieldCache::Lease::release()
+	{
+		if (entry != nullptr)
+			entry->pins.fetch_sub(1);
+
+		entry = nullptr;
+		field = nullptr;
+		ownField.reset();
+	}
+
+	FlowFieldCache::FlowFieldCache(const SearchOptions& options, size_t capacity, ThreadPool* pool)
+		: options(options), pool(pool), entries(new Entry[capacity]), entryCount(capacity), clock(0),
+		  heldFields(0), heldBytes(0), hitCount(0), buildCount(0), keptCount(0), invalidatedCount(0)
+	{
+	}
+
+	FlowFieldCache::~FlowFieldCache()
+	{
+	}
+
+	bool FlowFieldCache::tryPin(Entry& entry, uint64_t wanted, const Grid& grid)
+	{
+		if (entry.key.load() != wanted)
+			return false;
+
+		entry.pins.fetch_add(1);
+		if (entry.key.load() == wanted && entry.field.matches(grid))
+			return true;
+
+		entry.pins.fetch_sub(1);
+		return false;
+	}
+
+	bool FlowFieldCache::tryClaim(Entry& entry)
+	{
+		const uint64_t held = entry.key.load();
+		entry.key.store(NoKey);
+
+		if (entry.pins.load() == 0)
+			return true;
+
+		entry.key.store(held);
+		return false;
+	}
+
+	FlowFieldCache::Lease FlowFieldCache::lease(Entry& entry)
+	{
+		// Stamped with the clock of the last build only, every entry used
+		// since then is as recent as any other when the next one is dropped
+		const uint64_t now = clock.load(std::memory_order_relaxed);
+		if (entry.lastUsed.load(std::memory_order_relaxed) != now)
+			entry.lastUsed.store(now, std::memory_order_relaxed);
+
+		Lease lease;
+		lease.entry = &entry;
+		lease.field = &entry.field;
+		return lease;
+	}
+
+	FlowFieldCache::Lease FlowFieldCache::get(const Grid& grid, Pair dest)
+	{
+		if (!grid.isValid(dest.first, dest.second) || !grid.isUnBlocked(dest.first, dest.second))
+			return Lease();
+
+		const uint64_t wanted = key(dest);
+
+		for (size_t i = 0; i < entryCount; i++)
+		{
+			if (tryPin(entries[i], wanted, grid))
+			{
+				hitCount.fetch_add(1, std::memory_order_relaxed);
+				return lease(entries[i]);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(writeLock);
+
+		// Built by another thread while this one waited
+		for (size_t i = 0; i < entryCount; i++)
+		{
+			if (tryPin(entries[i], wanted, grid))
+			{
+				hitCount.fetch_add(1, std::memory_order_relaxed);
+				return lease(entries[i]);
+			}
+		}
+
+		// Empty entries first, then ones out of date, then the one used
+		// least recently
+		std::vector<std::pair<uint64_t, Entry*>> candidates;
+		candidates.reserve(entryCount);
+
+		for (size_t i = 0; i < entryCount; i++)
+		{
+			Entry& entry = entries[i];
+			const uint64_t rank = entry.field.empty() ? 0 : !entry.field.matches(grid) ? 1 : 2 + entry.lastUsed.load(std::memory_order_relaxed);
+			candidates.push_back(std::make_pair(rank, &entry));
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const std::pair<uint64_t, Entry*>& a, const std::pair<uint64_t, Entry*>& b)
+		{
+			return a.first < b.first;
+		});
+
+		Entry* victim = nullptr;
+		for (const auto& candidate : candidates)
+		{
+			if (tryClaim(*candidate.second))
+			{
+				victim = candidate.second;
+				break;
+			}
+		}
+
+		clock.fetch_add(1, std::memory_order_relaxed);
+		buildCount.fetch_add(1, std::memory_order_relaxed);
+
+		if (victim == nullptr)
+		{
+			Lease lease;
+			lease.ownField.reset(new DistanceField);
+			lease.ownField->build(grid, &dest, 1, options, pool);
+			lease.field = lease.ownField.get();
+			return lease;
+		}
+
+		if (!victim->field.empty())
+		{
+			heldFields.fetch_sub(1, std::memory_order_relaxed);
+			heldBytes.fetch_sub(victim->field.bytes(), std::memory_order_relaxed);
+		}
+
+		victim->field.build(grid, &dest, 1, options, pool);
+
+		heldFields.fetch_add(1, std::memory_order_relaxed);
+		heldBytes.fetch_add(victim->field.bytes(), std::memory_order_relaxed);
+
+		// Pinned for the caller before anyone else can find it
+		victim->pins.fetch_add(1);
+		victim->key.store(wanted);
+
+		return lease(*victim);
+	}
+
+	void FlowFieldCache::update(const Grid& grid, int row, int col)
+	{
+		std::lock_guard<std::mutex> lock(writeLock);
+
+		for (size_t i = 0; i < entryCount; i++)
+		{
+			Entry& entry = entries[i];
+			DistanceField& field = entry.field;
+			if (field.empty())
+				continue;
+
+			// Fields already out of date stay that way
+			const bool current = field.version() == grid.previousVersion();
+
+			// A field a lease holds is left as it is. It no longer matches
+			// the grid and is built again once the last lease on it goes
+			const uint64_t held = entry.key.load();
+			if (!tryClaim(entry))
+			{
+				if (current)
+					invalidatedCount.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			if (field.update(grid, row, col))
+				keptCount.fetch_add(1, std::memory_order_relaxed);
+			else if (current)
+				invalidatedCount.fetch_add(1, std::memory_order_relaxed);
+
+			entry.key.store(held);
+		}
+	}
+
+	void FlowFieldCache::clear()
+	{
+		std::lock_guard<std::mutex> lock(writeLock);
+
+		for (size_t i = 0; i < entryCount; i++)
+		{
+			Entry& entry = entries[i];
+			if (entry.field.empty() || !tryClaim(entry))
+				continue;
+
+			heldFields.fetch_sub(1, std::memory_order_relaxed);
+			heldBytes.fetch_sub(entry.field.bytes(), std::memory_order_relaxed);
+			entry.field.clear();
+		}
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "AStarSearch.h"
+#include "DistanceField.h"
+#include "ThreadPool.h"
+
+namespace PathEngine
+{
+	/*
+	 Flow fields towards single destinations, built when first asked for
+	 and shared by every agent heading there, for crowds where thousands
+	 of agents go to a handful of places. A cache serves one grid with
+	 the moves of one SearchOptions and holds at most capacity fields,
+	 dropping the one used least recently to make room.
+	 A field handed out is pinned by its Lease and is neither rebuilt
+	 nor dropped until the last lease on it goes, so it never changes
+	 under an agent following it. Finding a field that is already built
+	 takes no lock, only a look over the entries and an atomic count up
+	 and down, so any number of threads can get fields at once. Building
+	 one takes a lock, one build at a time, on the threads of the pool
+	 when one is given.
+	 update keeps every field that a change to the grid leaves as it was
+	 and marks the others out of date; they are only rebuilt when next
+	 asked for. Fields a lease holds are not patched either, they go out
+	 of date with the grid and are rebuilt once free. The grid must not
+	 change while another thread gets a field, as for any reader of it.*/
+	class FlowFieldCache
+	{
+		struct Entry;
+
+	public:
+		// A field from the cache, kept as it is while the lease lasts
+		class Lease
+		{
+		public:
+			Lease() : entry(nullptr), field(nullptr) {}
+			Lease(Lease&& other);
+			Lease& operator=(Lease&& other);
+			~Lease();
+
+			Lease(const Lease&) = delete;
+			Lease& operator=(const Lease&) = delete;
+
+			// False for a destination off the grid or blocked
+			explicit operator bool() const { return field != nullptr; }
+
+			const DistanceField& operator*() const { return *field; }
+			const DistanceField* operator->() const { return field; }
+
+		private:
+			friend class FlowFieldCache;
+
+			void release();
+
+			Entry* entry;
+			const DistanceField* field;
+
+			// A field of the lease's own, when every entry was pinned
+			std::unique_ptr<DistanceField> ownField;
+		};
+
+		// Holds capacity fields at most, each taking DistanceField::bytes.
+		// Fields are built on the threads of pool, or on the calling thread
+		// alone when get is called from a task of pool itself, as a crowd
+		// updated with pool->parallelFor does
+		FlowFieldCache(const SearchOptions& options, size_t capacity, ThreadPool* pool = nullptr);
+		~FlowFieldCache();
+
+		FlowFieldCache(const FlowFieldCache&) = delete;
+		FlowFieldCache& operator=(const FlowFieldCache&) = delete;
+
+		// The field towards dest, built first when the cache has none for
+		// the grid as it is now. When every entry is pinned by a lease the
+		// field is built for this lease alone, outside the cache: memory is
+		// then no longer bounded by capacity but grows with every such call
+		// until those leases go
+		Lease get(const Grid& grid, Pair dest);
+
+		// Call after every grid.set, with the cell that was set
+		void update(const Grid& grid, int row, int col);
+
+		// Drops every field no lease holds
+		void clear();
+
+		size_t capacity() const { return entryCount; }
+
+		// Fields held and the memory they take
+		size_t size() const { return heldFields.load(std::memory_order_relaxed); }
+		size_t bytes() const { return heldBytes.load(std::memory_order_relaxed); }
+
+		// Fields found built / built on get, and fields kept / marked out
+		// of date by update
+		size_t hits() const { return hitCount.load(std::memory_order_relaxed); }
+		size_t builds() const { return buildCount.load(std::memory_order_relaxed); }
+		size_t kept() const { return keptCount.load(std::memory_order_relaxed); }
+		size_t invalidated() const { return invalidatedCount.load(std::memory_order_relaxed); }
+
+	private:
+		// The key of an entry without a field
+		static const uint64_t NoKey = ~uint64_t(0);
+
+		static uint64_t key(Pair dest) { return uint64_t(uint32_t(dest.first)) << 32 | uint32_t(dest.second); }
+
+		// Pins the entry when it holds a field for dest that matches grid
+		bool tryPin(Entry& entry, uint64_t wanted, const Grid& grid);
+
+		// Takes an entry no lease holds for a new field, false when a
+		// lease got to it first
+		bool tryClaim(Entry& entry);
+
+		Lease lease(Entry& entry);
+
+		SearchOptions options;
+		ThreadPool* pool;
+
+		std::unique_ptr<Entry[]> entries;
+		size_t entryCount;
+
+		// Builds and update one at a time
+		std::mutex writeLock;
+
+		// Goes up at every build. An entry stamped with it on every use
+		// is dropped when its stamp is the oldest
+		std::atomic<uint64_t> clock;
+
+		std::atomic<size_t> heldFields;
+		std::atomic<size_t> heldBytes;
+		std::atomic<size_t> hitCount;
+		std::atomic<size_t> buildCount;
+		std::atomic<size_t> keptCount;
+		std::atomic<size_t> invalidatedCount;
+	};
+}
@@ -0,0 +1,343 @@
+#include "Grid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace PathEngine
+{
+	namespace
+	{
+		const char mapMagic[8] = { 'P', 'E', 'M', 'A', 'P', '\0', '\0', '\0' };
+		const uint32_t mapVersion = 1;
+
+		// Every part of the file starts on a cache line
+		const uint64_t mapAlignment = 64;
+
+		/*
+		 A map file is this header followed by the parts it points at:
+		 the cost bytes (Costs layout only), then the walkable bits and
+		 the transposed walkable bits exactly as BitGrid holds them,
+		 padding included. The value histogram is stored as well, so that
+		 nothing has to be counted when the file is loaded.
+		 Numbers are saved in the byte order of the machine that wrote the
+		 file; read on the other byte order the version does not match.*/
+		struct MapHeader
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t layout;
+			int32_t rows;
+			int32_t cols;
+			uint64_t cellsOffset;
+			uint64_t bitsOffset;
+			uint64_t transposedOffset;
+			uint64_t fileSize;
+			uint64_t valueCounts[256];
+		};
+
+		static_assert(sizeof(MapHeader) == 2104, "MapHeader must not be padded");
+
+		uint64_t alignUp(uint64_t offset)
+		{
+			return (offset + mapAlignment - 1) & ~(mapAlignment - 1);
+		}
+
+		// Whether bytes at offset lie inside a file of size bytes and on
+		// a cache line
+		bool fits(uint64_t offset, uint64_t bytes, uint64_t size)
+		{
+			return offset % mapAlignment == 0 && offset <= size && bytes <= size - offset;
+		}
+	}
+
+	uint64_t Grid::nextVersion()
+	{
+		// 0 is never handed out, it is the version of tables not built
+		static std::atomic<uint64_t> counter(0);
+		return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	Grid::Grid()
+		: numRows(0), numCols(0), cells(nullptr), cellCount(0)
+	{
+		renewVersion();
+		std::fill(valueCounts, valueCounts + 256, size_t(0));
+	}
+
+	Grid::Grid(int rows, int cols, uint8_t value)
+		: numRows(0), numCols(0), cells(nullptr), cellCount(0)
+	{
+		resize(rows, cols, value);
+	}
+
+	Grid::Grid(const Grid& other)
+		: numRows(other.numRows), numCols(other.numCols), ownedCells(other.cells, other.cells + other.cellCount),
+		  occupancy(other.occupancy), transposedOccupancy(other.transposedOccupancy)
+	{
+		renewVersion();
+		cells = ownedCells.data();
+		cellCount = ownedCells.size();
+		std::copy(other.valueCounts, other.valueCounts + 256, valueCounts);
+	}
+
+	Grid::Grid(Grid&& other)
+		: numRows(other.numRows), numCols(other.numCols), cells(other.cells), cellCount(other.cellCount),
+		  ownedCells(std::move(other.ownedCells)), file(std::move(other.file)),
+		  versionNumber(other.versionNumber), previousNumber(other.previousNumber), occupancy(std::move(other.occupancy)), transposedOccupancy(std::move(other.transposedOccupancy))
+	{
+		std::copy(other.valueCounts, other.valueCounts + 256, valueCounts);
+
+		other.numRows = other.numCols = 0;
+		other.cells = nullptr;
+		other.cellCount = 0;
+		other.renewVersion();
+		std::fill(other.valueCounts, other.valueCounts + 256, size_t(0));
+	}
+
+	Grid& Grid::operator=(const Grid& other)
+	{
+		if (this != &other)
+			*this = Grid(other);
+
+		return *this;
+	}
+
+	Grid& Grid::operator=(Grid&& other)
+	{
+		if (this == &other)
+			return *this;
+
+		numRows = other.numRows;
+		numCols = other.numCols;
+		cells = other.cells;
+		cellCount = other.cellCount;
+		ownedCells = std::move(other.ownedCells);
+		std::copy(other.valueCounts, other.valueCounts + 256, valueCounts);
+		occupancy = std::move(other.occupancy);
+		transposedOccupancy = std::move(other.transposedOccupancy);
+		file = std::move(other.file);
+		versionNumber = other.versionNumber;
+		previousNumber = other.previousNumber;
+
+		other.numRows = other.numCols = 0;
+		other.cells = nullptr;
+		other.cellCount = 0;
+		other.renewVersion();
+		other.ownedCells.clear();
+		std::fill(other.valueCounts, other.valueCounts + 256, size_t(0));
+		return *this;
+	}
+
+	void Grid::resize(int rows, int cols, uint8_t value)
+	{
+		numRows = std::max(rows, 0);
+		numCols = std::max(cols, 0);
+		ownedCells.assign(size_t(numRows) * size_t(numCols), value);
+		cells = ownedCells.data();
+		cellCount = ownedCells.size();
+
+		std::fill(valueCounts, valueCounts + 256, size_t(0));
+		valueCounts[value] = cellCount;
+
+		occupancy.resize(numRows, numCols);
+		occupancy.fill(value != 0);
+		transposedOccupancy.resize(numCols, numRows);
+		transposedOccupancy.fill(value != 0);
+		file.reset();
+		renewVersion();
+	}
+
+	void Grid::assign(const uint8_t* values, int rows, int cols)
+	{
+		numRows = std::max(rows, 0);
+		numCols = std::max(cols, 0);
+		ownedCells.assign(values, values + size_t(numRows) * size_t(numCols));
+		cells = ownedCells.data();
+		cellCount = ownedCells.size();
+
+		std::fill(valueCounts, valueCounts + 256, size_t(0));
+		for (uint8_t v : ownedCells)
+			valueCounts[v]++;
+
+		occupancy.assign(cells, numRows, numCols, false);
+		transposedOccupancy.assign(cells, numRows, numCols, true);
+
+		// values may have pointed into the mapped file
+		file.reset();
+		renewVersion();
+	}
+
+	void Grid::fill(uint8_t value)
+	{
+		std::fill(cells, cells + cellCount, value);
+
+		std::fill(valueCounts, valueCounts + 256, size_t(0));
+		valueCounts[value] = cellCount;
+		occupancy.fill(value != 0);
+		transposedOccupancy.fill(value != 0);
+		renewVersion();
+	}
+
+	uint8_t Grid::minCost() const
+	{
+		for (int value = 1; value < 256; value++)
+		{
+			if (valueCounts[value] != 0)
+				return uint8_t(value);
+		}
+
+		return 1;
+	}
+
+	uint8_t Grid::maxCost() const
+	{
+		for (int value = 255; value > 1; value--)
+		{
+			if (valueCounts[value] != 0)
+				return uint8_t(value);
+		}
+
+		return 1;
+	}
+
+	bool Grid::save(const std::string& path, MapLayout layout) const
+	{
+		if (layout == MapLayout::Bits)
+		{
+			for (int value = 2; value < 256; value++)
+			{
+				if (valueCounts[value] != 0)
+					return false;
+			}
+		}
+
+		MapHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, mapMagic, sizeof(mapMagic));
+		header.version = mapVersion;
+		header.layout = uint32_t(layout);
+		header.rows = numRows;
+		header.cols = numCols;
+
+		uint64_t offset = alignUp(sizeof(MapHeader));
+		if (layout == MapLayout::Costs)
+		{
+			header.cellsOffset = offset;
+			offset = alignUp(offset + cellCount);
+		}
+
+		header.bitsOffset = offset;
+		offset = alignUp(offset + occupancy.memoryBytes());
+		header.transposedOffset = offset;
+		header.fileSize = offset + transposedOccupancy.memoryBytes();
+
+		for (int value = 0; value < 256; value++)
+			header.valueCounts[value] = valueCounts[value];
+
+		FILE* out = std::fopen(path.c_str(), "wb");
+		if (out == nullptr)
+			return false;
+
+		// Pads with zeros up to offset, then writes the part
+		uint64_t position = 0;
+		auto write = [&](uint64_t at, const void* bytes, size_t count)
+		{
+			static const uint8_t zeros[mapAlignment] = {};
+			bool written = true;
+
+			while (written && position < at)
+			{
+				const size_t padding = size_t(std::min(at - position, mapAlignment));
+				written = std::fwrite(zeros, 1, padding, out) == padding;
+				position += padding;
+			}
+
+			position += count;
+			return written && std::fwrite(bytes, 1, count, out) == count;
+		};
+
+		bool written = write(0, &header, sizeof(header));
+		if (layout == MapLayout::Costs)
+			written = written && write(header.cellsOffset, cells, cellCount);
+
+		written = written && write(header.bitsOffset, occupancy.data(), occupancy.memoryBytes());
+		written = written && write(header.transposedOffset, transposedOccupancy.data(), transposedOccupancy.memoryBytes());
+
+		return std::fclose(out) == 0 && written;
+	}
+
+	bool Grid::load(const std::string& path)
+	{
+		std::unique_ptr<MappedFile> mapped(new MappedFile());
+		if (!mapped->open(path, true) || mapped->size() < sizeof(MapHeader))
+			return false;
+
+		MapHeader header;
+		std::memcpy(&header, mapped->data(), sizeof(header));
+
+		if (std::memcmp(header.magic, mapMagic, sizeof(mapMagic)) != 0 || header.version != mapVersion || header.fileSize != mapped->size() ||
+			header.rows < 0 || header.cols < 0 || header.layout > uint32_t(MapLayout::Bits))
+			return false;
+
+		const MapLayout layout = MapLayout(header.layout);
+		const uint64_t count = uint64_t(header.rows) * uint64_t(header.cols);
+		const uint64_t size = mapped->size();
+
+		if ((layout == MapLayout::Costs && !fits(header.cellsOffset, count, size)) ||
+			!fits(header.bitsOffset, BitGrid::memoryBytesFor(header.rows, header.cols), size) ||
+			!fits(header.transposedOffset, BitGrid::memoryBytesFor(header.cols, header.rows), size))
+			return false;
+
+		uint64_t counted = 0;
+		for (int value = 0; value < 256; value++)
+			counted += header.valueCounts[value];
+
+		if (counted != count)
+			return false;
+
+		uint8_t* bytes = mapped->writableData();
+
+		numRows = header.rows;
+		numCols = header.cols;
+		cellCount = size_t(count);
+		renewVersion();
+
+		for (int value = 0; value < 256; value++)
+			valueCounts[value] = size_t(header.valueCounts[value]);
+
+		occupancy.attach(reinterpret_cast<uint64_t*>(bytes + header.bitsOffset), numRows, numCols);
+		transposedOccupancy.attach(reinterpret_cast<uint64_t*>(bytes + header.transposedOffset), numCols, numRows);
+
+		if (layout == MapLayout::Costs)
+		{
+			ownedCells.clear();
+			ownedCells.shrink_to_fit();
+			cells = bytes + header.cellsOffset;
+		}
+		else
+		{
+			// Every walkable cell costs 1, unpack the bits 64 at a time
+			ownedCells.assign(cellCount, 0);
+			cells = ownedCells.data();
+
+			for (int row = 0; row < numRows; row++)
+			{
+				uint8_t* target = cells + size_t(row) * size_t(numCols);
+
+				for (int col = 0; col < numCols; col += 64)
+				{
+					const uint64_t bits = occupancy.bitsFrom(row, col);
+					const int end = std::min(64, numCols - col);
+
+					for (int k = 0; k < end; k++)
+						target[col + k] = uint8_t((bits >> k) & 1);
+				}
+			}
+		}
+
+		file = std::move(mapped);
+		return true;
+	}
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BitGrid.h"
+#include "MappedFile.h"
+
+namespace PathEngine
+{
+	// Creating a shortcut for int, int pair type
+	typedef std::pair<int, int> Pair;
+
+	// How a map file stores the cells, see Grid::save
+	enum class MapLayout
+	{
+		// A cost byte per cell and the walkable bits, as the grid holds
+		// them in memory. Loading maps the file and uses it in place
+		Costs,
+
+		// Only the walkable bits, a fifth of the size. For maps where
+		// every walkable cell costs 1; loading rebuilds the cost bytes
+		Bits
+	};
+
+	/* Description of the Grid-
+	 1--> The cell is not blocked
+	 0--> The cell is blocked
+	 Values above 1 are walkable too. With SearchOptions::terrainCosts
+	 they are the cost of entering the cell (mud, slopes), otherwise
+	 every walkable cell costs the same.
+	 The cells are stored as one contiguous row-major buffer, so a cell
+	 is addressed by the flat index row * cols + col.
+	 Next to the bytes the grid keeps a bit-packed copy of which cells
+	 are walkable, once as is and once transposed, which is what the
+	 searches read in their inner loops.
+	 A grid loaded from a map file works on a copy-on-write mapping of
+	 the file, so loading takes no time whatever the size and cells are
+	 only read from disk when a search touches them */
+	class Grid
+	{
+	public:
+		Grid();
+		Grid(int rows, int cols, uint8_t value = 1);
+
+		// A copy always holds its cells in memory of its own
+		Grid(const Grid& other);
+		Grid(Grid&& other);
+		Grid& operator=(const Grid& other);
+		Grid& operator=(Grid&& other);
+
+		void resize(int rows, int cols, uint8_t value = 1);
+
+		// Replaces the whole grid with a row-major buffer of rows * cols cells
+		void assign(const uint8_t* values, int rows, int cols);
+		void fill(uint8_t value);
+
+		// Writes the grid as a map file, false on an I/O error or when
+		// the Bits layout would lose cell costs
+		bool save(const std::string& path, MapLayout layout = MapLayout::Costs) const;
+
+		// Replaces the grid with a map file written by save. Changes made
+		// afterwards stay in memory, the file is never written. Fails,
+		// leaving the grid as it was, when the file is missing, damaged or
+		// of another version
+		bool load(const std::string& path);
+
+		int rows() const { return numRows; }
+		int cols() const { return numCols; }
+		size_t size() const { return cellCount; }
+
+		// A Utility Function to check whether given cell (row, col)
+		// is a valid cell or not
+		bool isValid(int row, int col) const
+		{
+			return (row >= 0) && (row < numRows) && (col >= 0) && (col < numCols);
+		}
+
+		// A Utility Function to check whether the given cell is
+		// blocked or not
+		bool isUnBlocked(int row, int col) const
+		{
+			return cells[index(row, col)] != 0;
+		}
+
+		// Valid and not blocked, cells outside the grid count as walls
+		bool isWalkable(int row, int col) const
+		{
+			return isValid(row, col) && occupancy.test(row, col);
+		}
+
+		uint8_t get(int row, int col) const { return cells[index(row, col)]; }
+
+		void set(int row, int col, uint8_t value)
+		{
+			uint8_t& cell = cells[index(row, col)];
+			valueCounts[cell]--;
+			valueCounts[value]++;
+			cell = value;
+
+			occupancy.set(row, col, value != 0);
+			transposedOccupancy.set(col, row, value != 0);
+
+			previousNumber = versionNumber;
+			versionNumber = nextVersion();
+		}
+
+		// Changes whenever a cell may have changed: set, fill, resize,
+		// assign and load. Versions come from one counter for the whole
+		// process, so no two grids ever have the same one, and a copy
+		// gets a version of its own. Tables built from the grid keep the
+		// version they were built for, to notice when they are out of date
+		uint64_t version() const { return versionNumber; }
+
+		// The version before the last set. A table told about single
+		// changes (update) was current before this one when it has it.
+		// No table has it after any other change
+		uint64_t previousVersion() const { return previousNumber; }
+
+		// The lowest cost of any walkable cell, what a heuristic has to
+		// assume every step costs to stay a lower bound. 1 when the grid
+		// has no walkable cells
+		uint8_t minCost() const;
+
+		// The highest cost of any walkable cell, 1 when it has none
+		uint8_t maxCost() const;
+
+		uint32_t index(int row, int col) const { return uint32_t(row) * uint32_t(numCols) + uint32_t(col); }
+		Pair position(uint32_t index) const { return Pair(int(index / uint32_t(numCols)), int(index % uint32_t(numCols))); }
+
+		const uint8_t* data() const { return cells; }
+
+		// Walkable bits by row, and by column (row and col swapped)
+		const BitGrid& bits() const { return occupancy; }
+		const BitGrid& transposedBits() const { return transposedOccupancy; }
+
+	private:
+		int numRows;
+		int numCols;
+
+		// Either ownedCells.data() or part of a mapped file
+		uint8_t* cells;
+		size_t cellCount;
+		std::vector<uint8_t> ownedCells;
+		std::unique_ptr<MappedFile> file;
+
+		static uint64_t nextVersion();
+
+		// A fresh version after a change that is not a single set
+		void renewVersion() { versionNumber = previousNumber = nextVersion(); }
+
+		uint64_t versionNumber;
+		uint64_t previousNumber;
+
+		// How many cells hold each value
+		size_t valueCounts[256];
+
+		BitGrid occupancy;
+		BitGrid transposedOccupancy;
+	};
+}
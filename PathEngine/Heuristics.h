@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+
+#include "Grid.h"
+
+namespace PathEngine
+{
+	/*
+	 Heuristic and movement cost policies. The search takes them as
+	 template parameters, so the inner loop is compiled once per
+	 combination with the distance formula inlined and no virtual calls.
+	 A heuristic is a function object double(row, col, dest). It is
+	 admissible (never more than the true distance, so A* stays optimal)
+	 when it does not overestimate the moves it is used with:
+	   Manhattan   4-connected moves
+	   Octile      diagonal moves costing sqrt(2), exact on an empty grid
+	   Chebyshev   diagonal moves costing 1, exact on an empty grid
+	   Euclidean   4-connected or octile moves, but weaker than both and
+	               needs a sqrt
+	 Only Euclidean calls sqrt, the others are a few integer operations.*/
+	enum class HeuristicType
+	{
+		// The tightest admissible heuristic for the moves: Manhattan
+		// without diagonals, else Octile or Chebyshev to match the cost
+		Default,
+		Manhattan,
+		Octile,
+		Chebyshev,
+		Euclidean
+	};
+
+	// What a diagonal move costs, straight moves always cost 1. With
+	// terrain costs both are multiplied by the cost of the cell entered
+	enum class MoveCostType
+	{
+		// sqrt(2), the true length of the step
+		Octile,
+
+		// 1, a king's move on a chess board
+		Chebyshev
+	};
+
+	constexpr double sqrt2 = 1.4142135623730951;
+
+	struct ManhattanHValue
+	{
+		double operator()(int row, int col, Pair dest) const
+		{
+			return double(std::abs(row - dest.first) + std::abs(col - dest.second));
+		}
+	};
+
+	struct OctileHValue
+	{
+		double operator()(int row, int col, Pair dest) const
+		{
+			const int di = std::abs(row - dest.first);
+			const int dj = std::abs(col - dest.second);
+			return di < dj ? dj + (sqrt2 - 1.0) * di : di + (sqrt2 - 1.0) * dj;
+		}
+	};
+
+	struct ChebyshevHValue
+	{
+		double operator()(int row, int col, Pair dest) const
+		{
+			const int di = std::abs(row - dest.first);
+			const int dj = std::abs(col - dest.second);
+			return double(di < dj ? dj : di);
+		}
+	};
+
+	// A Utility Function to calculate the 'h' heuristics
+	struct EuclideanHValue
+	{
+		double operator()(int row, int col, Pair dest) const
+		{
+			// Return using the distance formula
+			return std::sqrt(double((row - dest.first) * (row - dest.first) + (col - dest.second) * (col - dest.second)));
+		}
+	};
+
+	// Weighted A*: h scaled by a weight above 1 makes the search greedier.
+	// It expands fewer cells but the path can be up to weight times longer
+	template <class HValue>
+	struct WeightedHValue
+	{
+		explicit WeightedHValue(double weight) : weight(weight) {}
+
+		double operator()(int row, int col, Pair dest) const
+		{
+			return weight * base(row, col, dest);
+		}
+
+		HValue base;
+		double weight;
+	};
+
+	// Cost of one step in each direction, in units of 1 / scale. With
+	// terrain the step cost is also multiplied by the value of the cell
+	// it enters
+	struct OctileMoves
+	{
+		static constexpr double straight = 1.0;
+		static constexpr double diagonal = sqrt2;
+		static constexpr double scale = 1.0;
+		static constexpr bool terrain = false;
+	};
+
+	struct ChebyshevMoves
+	{
+		static constexpr double straight = 1.0;
+		static constexpr double diagonal = 1.0;
+		static constexpr double scale = 1.0;
+		static constexpr bool terrain = false;
+	};
+
+	/*
+	 Terrain moves keep g integral: doubles hold integers exactly up to
+	 2^53, so sums of step costs never round, two paths of equal cost
+	 compare equal whatever order they were added in, and f fits the
+	 bucket queue. Octile diagonals are fixed point in 1/1024ths of a
+	 step, rounded up (1449) so the octile heuristic stays a lower bound.*/
+	struct TerrainChebyshevMoves
+	{
+		static constexpr double straight = 1.0;
+		static constexpr double diagonal = 1.0;
+		static constexpr double scale = 1.0;
+		static constexpr bool terrain = true;
+	};
+
+	struct TerrainOctileMoves
+	{
+		static constexpr double straight = 1024.0;
+		static constexpr double diagonal = 1449.0;
+		static constexpr double scale = 1024.0;
+		static constexpr bool terrain = true;
+	};
+}
@@ -0,0 +1,1476 @@
+#include "HierarchicalGraph.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+#include <set>
+#include <utility>
+
+namespace PathEngine
+{
+	namespace
+	{
+		const double diagonalCost = 1.4142135623730951;
+
+		// Runs shorter than this get a single transition in their middle
+		const int longEntrance = 6;
+
+		// The first level above the cells groups 2 x 2 clusters, which
+		// keeps the lowest-level search around either end small, and every
+		// level after that levelFactor x levelFactor of the one below. More
+		// levels than this are never needed
+		const int firstFactor = 2;
+		const int levelFactor = 4;
+		const int maxLevels = 8;
+
+		// About how many transitions a border keeps above the lowest level
+		const int upperEntrances = 8;
+
+		const uint32_t NoNode = UINT32_MAX;
+
+		// Weighted A* over the abstract graph. It keeps only some of the
+		// transitions, so its paths are a few percent longer than the best
+		// anyway, and the cost is measured again on the refined path; h
+		// scaled by 1.1 adds little to that but expands a third of the
+		// nodes. It also breaks ties between paths of equal cost towards
+		// the deepest
+		const double heuristicWeight = 1.1;
+
+		// The cell each neighbourhood bit stands for
+		const int stepRow[9] = { -1, -1, -1, 0, 0, 0, 1, 1, 1 };
+		const int stepCol[9] = { -1, 0, 1, -1, 0, 1, -1, 0, 1 };
+
+		bool isDiagonalBit(int bit) { return bit == 0 || bit == 2 || bit == 6 || bit == 8; }
+
+		// The bits of the top and bottom row and the left and right column
+		// of the 3x3 block
+		const uint32_t topRow = 0x007, bottomRow = 0x1c0, leftColumn = 0x049, rightColumn = 0x124;
+
+		// Lower bound on the grid distance: Manhattan on a 4-connected
+		// grid, octile when diagonal steps are allowed
+		double gridDistance(Pair a, Pair b, bool diagonal)
+		{
+			int dr = std::abs(a.first - b.first);
+			int dc = std::abs(a.second - b.second);
+
+			if (!diagonal)
+				return double(dr + dc);
+
+			return double(std::max(dr, dc)) + (diagonalCost - 1.0) * double(std::min(dr, dc));
+		}
+
+		// Where the moves between slots a and b of an n-node lowest-level
+		// cluster are kept. Only a < b is stored, b to a walks it backwards
+		size_t pairIndex(size_t a, size_t b, size_t n)
+		{
+			return a * n - a * (a + 1) / 2 + (b - a - 1);
+		}
+
+		// The move of bit, reversed
+		int oppositeBit(int bit) { return 8 - bit; }
+
+		uint32_t findRoot(std::vector<uint32_t>& parent, uint32_t i)
+		{
+			while (parent[i] != i)
+			{
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+			return i;
+		}
+	}
+
+	struct HierarchicalGraph::Scratch
+	{
+		// The lowest level, per cell of a cluster
+		std::vector<uint32_t> around;
+		std::vector<double> distance;
+		std::vector<uint8_t> target;
+		std::vector<uint32_t> fifo;
+		std::vector<std::pair<double, uint32_t>> heap;
+
+		// The move into every cell on the shortest path from a node, and
+		// the moves of one route backwards
+		std::vector<uint8_t> step;
+		std::vector<uint8_t> route;
+
+		// Higher levels, per node of the level below inside a cluster.
+		// They are numbered one cluster below after the other, subBase
+		// and subCluster hold the first number and the id of each of the
+		// factor x factor clusters below (NoNode past the grid)
+		std::vector<uint32_t> local;
+		std::vector<uint32_t> localSub;
+		std::vector<uint32_t> subBase;
+		std::vector<uint32_t> subCluster;
+		std::vector<uint32_t> targetSlot;
+		std::vector<float> cost;
+		std::vector<uint32_t> parent;
+		IndexedDaryHeap<4, float> open;
+		std::vector<uint32_t> hops;
+
+		// The transitions across one border that could be kept
+		struct Candidate
+		{
+			uint32_t firstPart, secondPart;
+			uint32_t order;
+			const Transition* transition;
+		};
+
+		std::vector<Candidate> candidates;
+	};
+
+	// A query searches the nodes it scans on the lowest level under their
+	// own ids, those on a level above under levelBases[level] plus their
+	// number on that level, and the cells of the source's and the
+	// destination's clusters under srcBase and destBase plus their index
+	// in the cluster. The two are the same when both ends are in one
+	// cluster
+	struct HierarchicalGraph::Query
+	{
+		Pair src, dest;
+		uint32_t srcCluster, destCluster;
+		Bounds srcBounds, destBounds;
+		uint32_t levelBases[maxLevels];
+		uint32_t srcBase, destBase;
+
+		// Highest level the search may use, and the clusters holding the
+		// source and the destination on every level
+		int topLevel;
+		uint32_t srcClusters[maxLevels];
+		uint32_t destClusters[maxLevels];
+	};
+
+	HierarchicalGraph::HierarchicalGraph(int clusterSize, bool allowDiagonal)
+		: size(std::max(clusterSize, 2)), diagonal(allowDiagonal), rows(0), cols(0), lastRebuilt(0)
+	{
+	}
+
+	HierarchicalGraph::Bounds HierarchicalGraph::clusterBounds(int level, uint32_t cluster) const
+	{
+		const Level& l = levels[size_t(level)];
+		int cr = int(cluster) / l.clusterCols;
+		int cc = int(cluster) % l.clusterCols;
+
+		Bounds bounds;
+		bounds.top = cr * l.span;
+		bounds.left = cc * l.span;
+		bounds.bottom = std::min(bounds.top + l.span, rows);
+		bounds.right = std::min(bounds.left + l.span, cols);
+		return bounds;
+	}
+
+	size_t HierarchicalGraph::edgeCount() const
+	{
+		size_t count = 0;
+
+		for (const Level& level : levels)
+		{
+			for (const Cluster& cluster : level.clusters)
+			{
+				for (float d : cluster.distances)
+					count += (d > 0.0f && d < FLT_MAX) ? 1 : 0;
+			}
+		}
+
+		for (const AbstractNode& node : nodes)
+		{
+			if (node.cluster != NoNode)
+				count += size_t(node.partners[0] != NoNode) + size_t(node.partners[1] != NoNode);
+		}
+
+		return count;
+	}
+
+	int HierarchicalGraph::partnerLevel(uint32_t node, uint32_t partner) const
+	{
+		const AbstractNode& n = nodes[node];
+		return n.partners[0] == partner ? n.partnerLevels[0] : n.partners[1] == partner ? n.partnerLevels[1] : 0;
+	}
+
+	void HierarchicalGraph::setPartnerLevel(uint32_t node, uint32_t partner, int levelCount)
+	{
+		AbstractNode& n = nodes[node];
+		for (int k = 0; k < 2; k++)
+		{
+			if (n.partners[k] == partner)
+				n.partnerLevels[k] = uint8_t(levelCount);
+		}
+	}
+
+	// A new transition is only kept on the lowest level until the
+	// levels above pick theirs again
+	void HierarchicalGraph::addPartner(uint32_t node, uint32_t partner)
+	{
+		AbstractNode& n = nodes[node];
+		if (n.partners[0] == partner || n.partners[1] == partner)
+			return;
+
+		const int k = n.partners[0] == NoNode ? 0 : 1;
+		n.partners[k] = partner;
+		n.partnerLevels[k] = 1;
+	}
+
+	void HierarchicalGraph::removePartner(uint32_t node, uint32_t partner)
+	{
+		AbstractNode& n = nodes[node];
+		for (int k = 0; k < 2; k++)
+		{
+			if (n.partners[k] == partner)
+			{
+				n.partners[k] = NoNode;
+				n.partnerLevels[k] = 0;
+			}
+		}
+	}
+
+	uint32_t HierarchicalGraph::nodeAt(uint32_t cluster, uint32_t cell) const
+	{
+		for (uint32_t node : levels[0].clusters[cluster].nodes)
+		{
+			if (nodes[node].cell == cell)
+				return node;
+		}
+		return NoNode;
+	}
+
+	// Without the diagonals that are not allowed or would cut the
+	// corner of a blocked cell
+	uint32_t HierarchicalGraph::moves(const Grid& grid, int row, int col) const
+	{
+		uint32_t around = grid.bits().neighbourhood(row, col) & ~(1u << 4);
+
+		const uint32_t up = 1u << 1, left = 1u << 3, right = 1u << 5, down = 1u << 7;
+		if (!diagonal)
+			return around & (up | left | right | down);
+
+		if (!(around & up) || !(around & left))
+			around &= ~(1u << 0);
+		if (!(around & up) || !(around & right))
+			around &= ~(1u << 2);
+		if (!(around & down) || !(around & left))
+			around &= ~(1u << 6);
+		if (!(around & down) || !(around & right))
+			around &= ~(1u << 8);
+
+		return around;
+	}
+
+	void HierarchicalGraph::build(const Grid& grid, ThreadPool* pool)
+	{
+		rows = grid.rows();
+		cols = grid.cols();
+
+		auto addLevel = [&](int span, int factor)
+		{
+			Level level;
+			level.span = span;
+			level.factor = factor;
+			level.clusterRows = (rows + span - 1) / span;
+			level.clusterCols = (cols + span - 1) / span;
+			level.clusters.assign(size_t(level.clusterRows) * size_t(level.clusterCols), Cluster());
+			levels.push_back(std::move(level));
+		};
+
+		levels.clear();
+		addLevel(size, 1);
+		while (int(levels.size()) < maxLevels && (levels.back().clusterRows > levelFactor || levels.back().clusterCols > levelFactor))
+		{
+			const int factor = levels.size() == 1 ? firstFactor : levelFactor;
+			addLevel(levels.back().span * factor, factor);
+		}
+
+		const uint32_t count = uint32_t(levels[0].clusters.size());
+		belowBorders.assign(count, std::vector<Transition>());
+		rightBorders.assign(count, std::vector<Transition>());
+		nodes.clear();
+		freeNodes.clear();
+
+		auto borders = [&](size_t begin, size_t end, unsigned)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				buildBorder(grid, uint32_t(i), true);
+				buildBorder(grid, uint32_t(i), false);
+			}
+		};
+
+		if (pool)
+			pool->parallelFor(count, 64, borders);
+		else
+			borders(0, count, 0);
+
+		std::vector<uint32_t> all(count);
+		std::iota(all.begin(), all.end(), 0u);
+
+		for (uint32_t id : all)
+			collectNodes(id);
+		for (uint32_t id : all)
+			linkNodes(id);
+
+		rebuildLevels(grid, all, pool);
+	}
+
+	void HierarchicalGraph::update(const Grid& grid, const std::vector<Pair>& changedCells, ThreadPool* pool)
+	{
+		if (levels.empty() || grid.rows() != rows || grid.cols() != cols)
+		{
+			build(grid, pool);
+			return;
+		}
+
+		const Level& base = levels[0];
+		std::set<uint32_t> dirty, dirtyBelow, dirtyRight;
+
+		for (const Pair& cell : changedCells)
+		{
+			if (!grid.isValid(cell.first, cell.second))
+				continue;
+
+			const uint32_t id = clusterAt(0, cell.first, cell.second);
+			const int cr = int(id) / base.clusterCols;
+			const int cc = int(id) % base.clusterCols;
+			const Bounds bounds = clusterBounds(0, id);
+			dirty.insert(id);
+
+			// A cell on the edge of its cluster can open or close an entrance
+			if (cell.first == bounds.bottom - 1 && cr < base.clusterRows - 1)
+				dirtyBelow.insert(id);
+			if (cell.first == bounds.top && cr > 0)
+				dirtyBelow.insert(id - uint32_t(base.clusterCols));
+			if (cell.second == bounds.right - 1 && cc < base.clusterCols - 1)
+				dirtyRight.insert(id);
+			if (cell.second == bounds.left && cc > 0)
+				dirtyRight.insert(id - 1);
+		}
+
+		for (uint32_t id : dirtyBelow)
+		{
+			buildBorder(grid, id, true);
+			dirty.insert(id);
+			dirty.insert(id + uint32_t(base.clusterCols));
+		}
+
+		for (uint32_t id : dirtyRight)
+		{
+			buildBorder(grid, id, false);
+			dirty.insert(id);
+			dirty.insert(id + 1);
+		}
+
+		// The nodes of a dirty cluster get new ids, so the transitions to
+		// them are cut first. Remember how many levels kept each, a
+		// transition that is still there keeps that
+		std::vector<std::pair<std::pair<uint32_t, uint32_t>, int>> kept;
+		for (uint32_t id : dirty)
+		{
+			for (uint32_t node : base.clusters[id].nodes)
+			{
+				for (int k = 0; k < 2; k++)
+				{
+					const uint32_t partner = nodes[node].partners[k];
+					if (partner == NoNode)
+						continue;
+
+					kept.push_back(std::make_pair(std::make_pair(nodes[node].cell, nodes[partner].cell), int(nodes[node].partnerLevels[k])));
+					removePartner(partner, node);
+				}
+			}
+		}
+
+		for (uint32_t id : dirty)
+			collectNodes(id);
+		for (uint32_t id : dirty)
+			linkNodes(id);
+
+		for (const auto& transition : kept)
+		{
+			const Pair a = grid.position(transition.first.first);
+			const Pair b = grid.position(transition.first.second);
+			const uint32_t from = nodeAt(clusterAt(0, a.first, a.second), transition.first.first);
+			const uint32_t to = nodeAt(clusterAt(0, b.first, b.second), transition.first.second);
+
+			if (from != NoNode && to != NoNode)
+			{
+				setPartnerLevel(from, to, transition.second);
+				setPartnerLevel(to, from, transition.second);
+			}
+		}
+
+		rebuildLevels(grid, std::vector<uint32_t>(dirty.begin(), dirty.end()), pool);
+	}
+
+	// Finds the entrances across the bottom (or right) border of a cluster
+	void HierarchicalGraph::buildBorder(const Grid& grid, uint32_t cluster, bool below)
+	{
+		std::vector<Transition>& transitions = below ? belowBorders[cluster] : rightBorders[cluster];
+		transitions.clear();
+
+		const Level& base = levels[0];
+		const int cr = int(cluster) / base.clusterCols;
+		const int cc = int(cluster) % base.clusterCols;
+		if ((below && cr == base.clusterRows - 1) || (!below && cc == base.clusterCols - 1))
+			return;
+
+		const Bounds bounds = clusterBounds(0, cluster);
+		const int length = below ? bounds.width() : bounds.bottom - bounds.top;
+
+		auto cellsAt = [&](int i)
+		{
+			return below
+				? Transition{ grid.index(bounds.bottom - 1, bounds.left + i), grid.index(bounds.bottom, bounds.left + i), NoNode, NoNode }
+				: Transition{ grid.index(bounds.top + i, bounds.right - 1), grid.index(bounds.top + i, bounds.right), NoNode, NoNode };
+		};
+
+		auto isOpen = [&](int i)
+		{
+			return below
+				? grid.isWalkable(bounds.bottom - 1, bounds.left + i) && grid.isWalkable(bounds.bottom, bounds.left + i)
+				: grid.isWalkable(bounds.top + i, bounds.right - 1) && grid.isWalkable(bounds.top + i, bounds.right);
+		};
+
+		int start = -1;
+		for (int i = 0; i <= length; i++)
+		{
+			bool open = i < length && isOpen(i);
+
+			if (open && start < 0)
+				start = i;
+
+			if (!open && start >= 0)
+			{
+				int run = i - start;
+				if (run < longEntrance)
+				{
+					transitions.push_back(cellsAt(start + run / 2));
+				}
+				else
+				{
+					transitions.push_back(cellsAt(start));
+					transitions.push_back(cellsAt(i - 1));
+				}
+				start = -1;
+			}
+		}
+	}
+
+	// Gives the entrance cells on the four borders of a lowest-level
+	// cluster new node ids, freeing the old ones
+	void HierarchicalGraph::collectNodes(uint32_t id)
+	{
+		Level& base = levels[0];
+		Cluster& cluster = base.clusters[id];
+
+		for (uint32_t node : cluster.nodes)
+		{
+			nodes[node].cluster = NoNode;
+			freeNodes.push_back(node);
+		}
+		cluster.nodes.clear();
+
+		auto addNode = [&](uint32_t cell)
+		{
+			for (uint32_t node : cluster.nodes)
+			{
+				if (nodes[node].cell == cell)
+					return;
+			}
+
+			uint32_t node;
+			if (!freeNodes.empty())
+			{
+				node = freeNodes.back();
+				freeNodes.pop_back();
+			}
+			else
+			{
+				node = uint32_t(nodes.size());
+				nodes.push_back(AbstractNode());
+				for (Level& level : levels)
+				{
+					level.slots.push_back(NoNode);
+					level.components.push_back(NoNode);
+				}
+			}
+
+			AbstractNode& n = nodes[node];
+			n.cell = cell;
+			n.row = int(cell / uint32_t(cols));
+			n.col = int(cell % uint32_t(cols));
+			n.cluster = id;
+			n.partners[0] = n.partners[1] = NoNode;
+			n.partnerLevels[0] = n.partnerLevels[1] = 0;
+
+			base.slots[node] = uint32_t(cluster.nodes.size());
+			cluster.nodes.push_back(node);
+		};
+
+		const int cr = int(id) / base.clusterCols;
+		const int cc = int(id) % base.clusterCols;
+
+		if (cr > 0)
+		{
+			for (const Transition& t : belowBorders[id - uint32_t(base.clusterCols)])
+				addNode(t.second);
+		}
+		if (cr < base.clusterRows - 1)
+		{
+			for (const Transition& t : belowBorders[id])
+				addNode(t.first);
+		}
+		if (cc > 0)
+		{
+			for (const Transition& t : rightBorders[id - 1])
+				addNode(t.second);
+		}
+		if (cc < base.clusterCols - 1)
+		{
+			for (const Transition& t : rightBorders[id])
+				addNode(t.first);
+		}
+	}
+
+	// Joins the nodes of a lowest-level cluster to the nodes across its
+	// borders
+	void HierarchicalGraph::linkNodes(uint32_t id)
+	{
+		const Level& base = levels[0];
+		const uint32_t clusterCols = uint32_t(base.clusterCols);
+		const int cr = int(id) / base.clusterCols;
+		const int cc = int(id) % base.clusterCols;
+
+		auto link = [&](Transition& t, uint32_t upper, uint32_t lower)
+		{
+			t.firstNode = nodeAt(upper, t.first);
+			t.secondNode = nodeAt(lower, t.second);
+			addPartner(t.firstNode, t.secondNode);
+			addPartner(t.secondNode, t.firstNode);
+		};
+
+		if (cr > 0)
+		{
+			for (Transition& t : belowBorders[id - clusterCols])
+				link(t, id - clusterCols, id);
+		}
+		if (cr < base.clusterRows - 1)
+		{
+			for (Transition& t : belowBorders[id])
+				link(t, id, id + clusterCols);
+		}
+		if (cc > 0)
+		{
+			for (Transition& t : rightBorders[id - 1])
+				link(t, id - 1, id);
+		}
+		if (cc < base.clusterCols - 1)
+		{
+			for (Transition& t : rightBorders[id])
+				link(t, id, id + 1);
+		}
+	}
+
+	// Joins the nodes of a lowest-level cluster by their distances inside
+	// it, one Dijkstra from each node that stops once it has reached them
+	// all, and keeps the moves of those paths
+	void HierarchicalGraph::buildBaseCluster(const Grid& grid, uint32_t id, Scratch& scratch)
+	{
+		typedef std::pair<double, uint32_t> Entry;
+
+		Cluster& cluster = levels[0].clusters[id];
+		const Bounds bounds = clusterBounds(0, id);
+		const int width = bounds.width();
+		const size_t cells = size_t(bounds.cellCount());
+
+		// The moves out of every cell that stay inside the cluster
+		scratch.around.assign(cells, 0);
+		for (int r = bounds.top; r < bounds.bottom; r++)
+		{
+			for (int c = bounds.left; c < bounds.right; c++)
+			{
+				if (!grid.isWalkable(r, c))
+					continue;
+
+				uint32_t around = moves(grid, r, c);
+				if (r == bounds.top)
+					around &= ~topRow;
+				if (r == bounds.bottom - 1)
+					around &= ~bottomRow;
+				if (c == bounds.left)
+					around &= ~leftColumn;
+				if (c == bounds.right - 1)
+					around &= ~rightColumn;
+
+				scratch.around[bounds.local(r, c)] = around;
+			}
+		}
+
+		const size_t n = cluster.nodes.size();
+		cluster.distances.assign(n * n, FLT_MAX);
+		cluster.routeStarts.assign(1, 0);
+		cluster.routes.clear();
+		cluster.steps.clear();
+		uint32_t stepCount = 0;
+		scratch.step.resize(cells);
+
+		scratch.target.assign(cells, 0);
+		for (uint32_t node : cluster.nodes)
+			scratch.target[bounds.local(nodes[node].row, nodes[node].col)] = 1;
+
+		std::vector<double>& distance = scratch.distance;
+		std::vector<std::pair<double, uint32_t>>& heap = scratch.heap;
+		std::vector<uint32_t>& fifo = scratch.fifo;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			const AbstractNode& from = nodes[cluster.nodes[i]];
+			const uint32_t startLocal = bounds.local(from.row, from.col);
+			distance.assign(cells, DBL_MAX);
+			distance[startLocal] = 0.0;
+
+			// Every step costs 1 on a 4-connected grid, so a breadth-first
+			// queue pops cells in distance order just like a heap would
+			size_t head = 0;
+			fifo.clear();
+			heap.clear();
+
+			if (diagonal)
+				heap.push_back(Entry(0.0, startLocal));
+			else
+				fifo.push_back(startLocal);
+
+			size_t remaining = n;
+
+			while (diagonal ? !heap.empty() : head < fifo.size())
+			{
+				uint32_t current;
+				if (diagonal)
+				{
+					std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+					Entry top = heap.back();
+					heap.pop_back();
+					if (top.first > distance[top.second])
+						continue;
+					current = top.second;
+				}
+				else
+				{
+					current = fifo[head++];
+				}
+
+				if (scratch.target[current] && --remaining == 0)
+					break;
+
+				const uint32_t around = scratch.around[current];
+				for (int bit = 0; bit < 9; bit++)
+				{
+					if (!(around & (1u << bit)))
+						continue;
+
+					const uint32_t next = uint32_t(int(current) + stepRow[bit] * width + stepCol[bit]);
+					const double d = distance[current] + (isDiagonalBit(bit) ? diagonalCost : 1.0);
+					if (d < distance[next])
+					{
+						distance[next] = d;
+						scratch.step[next] = uint8_t(bit);
+						if (diagonal)
+						{
+							heap.push_back(Entry(d, next));
+							std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+						}
+						else
+						{
+							fifo.push_back(next);
+						}
+					}
+				}
+			}
+
+			for (size_t j = 0; j < n; j++)
+			{
+				const AbstractNode& to = nodes[cluster.nodes[j]];
+				const double d = distance[bounds.local(to.row, to.col)];
+				cluster.distances[i * n + j] = d < DBL_MAX ? float(d) : FLT_MAX;
+
+				// Keep the moves to every later node, so a query replays
+				// them instead of searching the cluster again
+				if (j <= i)
+					continue;
+
+				scratch.route.clear();
+				for (uint32_t cell = bounds.local(to.row, to.col); d < DBL_MAX && cell != startLocal; )
+				{
+					const int bit = scratch.step[cell];
+					scratch.route.push_back(uint8_t(bit));
+					cell = uint32_t(int(cell) - stepRow[bit] * width - stepCol[bit]);
+				}
+
+				for (size_t k = scratch.route.size(); k-- > 0; stepCount++)
+				{
+					if (stepCount % 2 == 0)
+						cluster.steps.push_back(scratch.route[k]);
+					else
+						cluster.steps.back() |= uint8_t(scratch.route[k] << 4);
+				}
+				cluster.routeStarts.push_back(stepCount);
+			}
+		}
+	}
+
+	void HierarchicalGraph::rebuildLevels(const Grid& grid, const std::vector<uint32_t>& dirty, ThreadPool* pool)
+	{
+		std::vector<Scratch> scratch(pool ? std::max(pool->threadCount(), 1u) : 1u);
+
+		auto forEach = [&](const std::vector<uint32_t>& ids, size_t grain, const std::function<void(uint32_t, Scratch&)>& work)
+		{
+			auto range = [&](size_t begin, size_t end, unsigned worker)
+			{
+				for (size_t i = begin; i < end; i++)
+					work(ids[i], scratch[worker]);
+			};
+
+			if (pool && ids.size() > 1)
+				pool->parallelFor(ids.size(), grain, range);
+			else
+				range(0, ids.size(), 0);
+		};
+
+		forEach(dirty, 16, [&](uint32_t id, Scratch& s) { buildBaseCluster(grid, id, s); });
+		lastRebuilt = dirty.size();
+
+		std::vector<uint32_t> changed = dirty;
+		for (int level = 1; level < int(levels.size()); level++)
+		{
+			const Level& below = levels[size_t(level) - 1];
+			const Level& here = levels[size_t(level)];
+			const uint32_t clusterCols = uint32_t(here.clusterCols);
+
+			std::set<uint32_t> above;
+			for (uint32_t id : changed)
+			{
+				const int r = (int(id) / below.clusterCols) / here.factor;
+				const int c = (int(id) % below.clusterCols) / here.factor;
+				above.insert(uint32_t(r * here.clusterCols + c));
+			}
+
+			const std::vector<uint32_t> parents(above.begin(), above.end());
+			forEach(parents, 1, [&](uint32_t id, Scratch& s) { findComponents(level, id, s); });
+
+			// Pick the transitions kept across every border of these
+			// clusters again. A cluster next to them whose side of a border
+			// changed has to be rebuilt as well
+			std::set<std::pair<uint32_t, bool>> borders;
+			for (uint32_t id : parents)
+			{
+				borders.insert(std::make_pair(id, true));
+				borders.insert(std::make_pair(id, false));
+				if (id >= clusterCols)
+					borders.insert(std::make_pair(id - clusterCols, true));
+				if (id % clusterCols > 0)
+					borders.insert(std::make_pair(id - 1, false));
+			}
+
+			for (const auto& border : borders)
+			{
+				if (selectBorder(level, border.first, border.second, scratch[0]))
+				{
+					above.insert(border.first);
+					above.insert(border.second ? border.first + clusterCols : border.first + 1);
+				}
+			}
+
+			changed.assign(above.begin(), above.end());
+			forEach(changed, 1, [&](uint32_t id, Scratch& s) { buildUpperCluster(level, id, s); });
+			lastRebuilt += changed.size();
+
+			numberLevel(level);
+		}
+	}
+
+	void HierarchicalGraph::numberLevel(int level)
+	{
+		Level& here = levels[size_t(level)];
+		here.firstIds.assign(1, 0);
+		here.order.clear();
+		here.cells.clear();
+
+		for (const Cluster& cluster : here.clusters)
+		{
+			for (uint32_t node : cluster.nodes)
+			{
+				here.order.push_back(node);
+				here.cells.push_back(Pair(nodes[node].row, nodes[node].col));
+			}
+			here.firstIds.push_back(uint32_t(here.order.size()));
+		}
+	}
+
+	void HierarchicalGraph::gatherNodes(int level, uint32_t id, Scratch& scratch) const
+	{
+		const Level& below = levels[size_t(level) - 1];
+		const Level& here = levels[size_t(level)];
+		const int factor = here.factor;
+		const int top = (int(id) / here.clusterCols) * factor;
+		const int left = (int(id) % here.clusterCols) * factor;
+
+		scratch.local.clear();
+		scratch.localSub.clear();
+		scratch.subBase.assign(size_t(factor * factor), 0);
+		scratch.subCluster.assign(size_t(factor * factor), NoNode);
+
+		for (int k = 0; k < factor * factor; k++)
+		{
+			const int r = top + k / factor;
+			const int c = left + k % factor;
+			if (r >= below.clusterRows || c >= below.clusterCols)
+				continue;
+
+			const uint32_t sub = uint32_t(r * below.clusterCols + c);
+			scratch.subCluster[size_t(k)] = sub;
+			scratch.subBase[size_t(k)] = uint32_t(scratch.local.size());
+
+			for (uint32_t node : below.clusters[sub].nodes)
+			{
+				scratch.local.push_back(node);
+				scratch.localSub.push_back(uint32_t(k));
+			}
+		}
+	}
+
+	// Number of a node of the level below after gatherNodes, NoNode when
+	// it is outside the cluster
+	uint32_t HierarchicalGraph::localIndex(int level, uint32_t id, uint32_t node, const Scratch& scratch) const
+	{
+		const Level& below = levels[size_t(level) - 1];
+		const Level& here = levels[size_t(level)];
+		const int r = nodes[node].row / below.span - (int(id) / here.clusterCols) * here.factor;
+		const int c = nodes[node].col / below.span - (int(id) % here.clusterCols) * here.factor;
+
+		if (r < 0 || r >= here.factor || c < 0 || c >= here.factor)
+			return NoNode;
+
+		return scratch.subBase[size_t(r * here.factor + c)] + below.slots[node];
+	}
+
+	// Splits the nodes of the level below inside a cluster into the parts
+	// that can reach each other over that level without leaving it
+	void HierarchicalGraph::findComponents(int level, uint32_t id, Scratch& scratch)
+	{
+		gatherNodes(level, id, scratch);
+
+		const Level& below = levels[size_t(level) - 1];
+		Level& here = levels[size_t(level)];
+		std::vector<uint32_t>& root = scratch.parent;
+		root.resize(scratch.local.size());
+		std::iota(root.begin(), root.end(), 0u);
+
+		for (size_t k = 0; k < scratch.subCluster.size(); k++)
+		{
+			if (scratch.subCluster[k] == NoNode)
+				continue;
+
+			const Cluster& sub = below.clusters[scratch.subCluster[k]];
+			const size_t n = sub.nodes.size();
+			const uint32_t first = scratch.subBase[k];
+
+			for (size_t a = 0; a < n; a++)
+			{
+				for (size_t b = a + 1; b < n; b++)
+				{
+					if (sub.distances[a * n + b] < FLT_MAX)
+						root[findRoot(root, first + uint32_t(a))] = findRoot(root, first + uint32_t(b));
+				}
+			}
+		}
+
+		for (size_t u = 0; u < scratch.local.size(); u++)
+		{
+			const AbstractNode& node = nodes[scratch.local[u]];
+			for (int k = 0; k < 2; k++)
+			{
+				if (node.partners[k] == NoNode || node.partnerLevels[k] < level)
+					continue;
+
+				const uint32_t v = localIndex(level, id, node.partners[k], scratch);
+				if (v != NoNode)
+					root[findRoot(root, uint32_t(u))] = findRoot(root, v);
+			}
+		}
+
+		for (size_t u = 0; u < scratch.local.size(); u++)
+			here.components[scratch.local[u]] = findRoot(root, uint32_t(u));
+	}
+
+	// Picks which of the transitions across the bottom (or right) border
+	// of a cluster, of those kept on the level below, are kept on this
+	// level: all of them when there are few, otherwise about
+	// upperEntrances spread along the border, but at least one between
+	// every two parts of the clusters that touch there. Returns whether
+	// that changed which ones are kept
+	bool HierarchicalGraph::selectBorder(int level, uint32_t id, bool below, Scratch& scratch)
+	{
+		const Level& base = levels[0];
+		const Level& here = levels[size_t(level)];
+		const int cr = int(id) / here.clusterCols;
+		const int cc = int(id) % here.clusterCols;
+		if ((below && cr == here.clusterRows - 1) || (!below && cc == here.clusterCols - 1))
+			return false;
+
+		// The lowest-level borders along this one, in order
+		const int ratio = here.span / size;
+		const int first = (below ? cc : cr) * ratio;
+		const int last = std::min(first + ratio, below ? base.clusterCols : base.clusterRows);
+
+		std::vector<Scratch::Candidate>& candidates = scratch.candidates;
+		candidates.clear();
+
+		for (int i = first; i < last; i++)
+		{
+			const uint32_t segment = below
+				? uint32_t(((cr + 1) * ratio - 1) * base.clusterCols + i)
+				: uint32_t(i * base.clusterCols + (cc + 1) * ratio - 1);
+
+			for (const Transition& t : (below ? belowBorders : rightBorders)[segment])
+			{
+				if (partnerLevel(t.firstNode, t.secondNode) >= level)
+					candidates.push_back(Scratch::Candidate{ here.components[t.firstNode], here.components[t.secondNode], uint32_t(candidates.size()), &t });
+			}
+		}
+
+		bool changed = false;
+		auto keep = [&](const Transition& t, bool kept)
+		{
+			const int old = partnerLevel(t.firstNode, t.secondNode);
+			const int levelCount = kept ? std::max(old, level + 1) : level;
+			changed = changed || (old > level) != kept;
+			setPartnerLevel(t.firstNode, t.secondNode, levelCount);
+			setPartnerLevel(t.secondNode, t.firstNode, levelCount);
+		};
+
+		const size_t total = candidates.size();
+		if (total <= size_t(upperEntrances))
+		{
+			for (const Scratch::Candidate& candidate : candidates)
+				keep(*candidate.transition, true);
+			return changed;
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Scratch::Candidate& a, const Scratch::Candidate& b)
+		{
+			if (a.firstPart != b.firstPart)
+				return a.firstPart < b.firstPart;
+			if (a.secondPart != b.secondPart)
+				return a.secondPart < b.secondPart;
+			return a.order < b.order;
+		});
+
+		// Each pair of parts gets its share, evenly spaced along its run
+		for (size_t begin = 0, end; begin < total; begin = end)
+		{
+			end = begin + 1;
+			while (end < total && candidates[end].firstPart == candidates[begin].firstPart && candidates[end].secondPart == candidates[begin].secondPart)
+				end++;
+
+			const size_t count = end - begin;
+			const size_t quota = std::max<size_t>(1, (size_t(upperEntrances) * count + total / 2) / total);
+			size_t picked = 0;
+
+			for (size_t j = 0; j < count; j++)
+			{
+				const bool kept = picked < quota && j == (2 * picked + 1) * count / (2 * quota);
+				picked += kept ? 1 : 0;
+				keep(*candidates[begin + j].transition, kept);
+			}
+		}
+
+		return changed;
+	}
+
+	// Joins the nodes of a cluster above the lowest level by their
+	// shortest distances over the level below inside it, and stores the
+	// lowest-level nodes each of those paths runs through
+	void HierarchicalGraph::buildUpperCluster(int level, uint32_t id, Scratch& scratch)
+	{
+		gatherNodes(level, id, scratch);
+
+		const Level& below = levels[size_t(level) - 1];
+		Level& here = levels[size_t(level)];
+		Cluster& cluster = here.clusters[id];
+		const size_t count = scratch.local.size();
+
+		cluster.nodes.clear();
+		scratch.targetSlot.assign(count, NoNode);
+		for (size_t u = 0; u < count; u++)
+		{
+			const uint32_t node = scratch.local[u];
+			if (height(node) > level)
+			{
+				scratch.targetSlot[u] = uint32_t(cluster.nodes.size());
+				here.slots[node] = uint32_t(cluster.nodes.size());
+				cluster.nodes.push_back(node);
+			}
+		}
+
+		const size_t n = cluster.nodes.size();
+		cluster.distances.assign(n * n, FLT_MAX);
+		cluster.routeStarts.assign(n * n + 1, 0);
+		cluster.routes.clear();
+
+		std::vector<float>& cost = scratch.cost;
+		std::vector<uint32_t>& parent = scratch.parent;
+		IndexedDaryHeap<4, float>& open = scratch.open;
+		cost.resize(count);
+		parent.resize(count);
+		open.reserve(count);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			const uint32_t start = localIndex(level, id, cluster.nodes[i], scratch);
+			std::fill(cost.begin(), cost.end(), FLT_MAX);
+			open.clear();
+
+			cost[start] = 0.0f;
+			parent[start] = start;
+			open.push(start, 0.0f);
+			size_t remaining = n;
+
+			auto relax = [&](uint32_t next, float d, uint32_t from)
+			{
+				if (d < cost[next])
+				{
+					cost[next] = d;
+					parent[next] = from;
+					open.push(next, d);
+				}
+			};
+
+			while (!open.empty())
+			{
+				const uint32_t u = open.pop();
+				if (scratch.targetSlot[u] != NoNode && --remaining == 0)
+					break;
+
+				const uint32_t node = scratch.local[u];
+				const uint32_t k = scratch.localSub[u];
+				const Cluster& sub = below.clusters[scratch.subCluster[k]];
+				const size_t m = sub.nodes.size();
+				const size_t a = below.slots[node];
+
+				for (size_t b = 0; b < m; b++)
+				{
+					const float d = sub.distances[a * m + b];
+					if (b != a && d < FLT_MAX)
+						relax(scratch.subBase[k] + uint32_t(b), cost[u] + d, u);
+				}
+
+				for (int p = 0; p < 2; p++)
+				{
+					if (nodes[node].partners[p] == NoNode || nodes[node].partnerLevels[p] < level)
+						continue;
+
+					const uint32_t v = localIndex(level, id, nodes[node].partners[p], scratch);
+					if (v != NoNode)
+						relax(v, cost[u] + 1.0f, u);
+				}
+			}
+
+			for (size_t j = 0; j < n; j++)
+			{
+				const uint32_t goal = localIndex(level, id, cluster.nodes[j], scratch);
+				cluster.distances[i * n + j] = cost[goal];
+
+				if (j != i && cost[goal] < FLT_MAX)
+				{
+					scratch.hops.clear();
+					for (uint32_t u = goal; u != start; u = parent[u])
+						scratch.hops.push_back(u);
+
+					// A step inside a cluster below is a route of its own
+					// there, unless that is already the lowest level
+					uint32_t from = start;
+					for (auto hop = scratch.hops.rbegin(); hop != scratch.hops.rend(); ++hop)
+					{
+						const uint32_t to = *hop;
+						if (level == 1 || scratch.localSub[from] != scratch.localSub[to])
+						{
+							cluster.routes.push_back(scratch.local[to]);
+						}
+						else
+						{
+							const Cluster& sub = below.clusters[scratch.subCluster[scratch.localSub[from]]];
+							const size_t pair = below.slots[scratch.local[from]] * sub.nodes.size() + below.slots[scratch.local[to]];
+							cluster.routes.insert(cluster.routes.end(), sub.routes.begin() + sub.routeStarts[pair], sub.routes.begin() + sub.routeStarts[pair + 1]);
+						}
+						from = to;
+					}
+				}
+
+				cluster.routeStarts[i * n + j + 1] = uint32_t(cluster.routes.size());
+			}
+		}
+	}
+
+	// NoNode for a node the level it would be searched on left out
+	uint32_t HierarchicalGraph::searchId(const Query& query, uint32_t node) const
+	{
+		const AbstractNode& n = nodes[node];
+		if (n.cluster == query.destCluster)
+			return query.destBase + query.destBounds.local(n.row, n.col);
+		if (n.cluster == query.srcCluster)
+			return query.srcBase + query.srcBounds.local(n.row, n.col);
+
+		const int level = scanLevel(query, node);
+		if (height(node) <= level)
+			return NoNode;
+		if (level == 0)
+			return node;
+
+		const Level& here = levels[size_t(level)];
+		return query.levelBases[level] + here.firstIds[clusterAt(level, n.row, n.col)] + here.slots[node];
+	}
+
+	// The level a search id below srcBase is searched on
+	int HierarchicalGraph::idLevel(const Query& query, uint32_t id) const
+	{
+		int level = query.topLevel;
+		while (level > 0 && id < query.levelBases[level])
+			level--;
+		return level;
+	}
+
+	uint32_t HierarchicalGraph::idNode(const Query& query, uint32_t id, int level) const
+	{
+		return level == 0 ? id : levels[size_t(level)].order[id - query.levelBases[level]];
+	}
+
+	// The cell of a node id, or of the search id of a cell of the
+	// source's or the destination's cluster
+	Pair HierarchicalGraph::position(const Query& query, uint32_t id) const
+	{
+		if (id < query.srcBase)
+			return Pair(nodes[id].row, nodes[id].col);
+
+		const Bounds& bounds = id >= query.destBase ? query.destBounds : query.srcBounds;
+		const int local = int(id - (id >= query.destBase ? query.destBase : query.srcBase));
+		return Pair(bounds.top + local / bounds.width(), bounds.left + local % bounds.width());
+	}
+
+	// The level a node outside the clusters of the source and the
+	// destination is searched on: the highest one whose cluster of the
+	// node holds neither
+	int HierarchicalGraph::scanLevel(const Query& query, uint32_t node) const
+	{
+		const AbstractNode& n = nodes[node];
+		int level = query.topLevel;
+
+		for (; level > 0; level--)
+		{
+			const uint32_t cluster = clusterAt(level, n.row, n.col);
+			if (cluster != query.srcClusters[level] && cluster != query.destClusters[level])
+				break;
+		}
+
+		return level;
+	}
+
+	bool HierarchicalGraph::search(const Grid& grid, const Query& query, SearchContext& context, SearchResult& result, std::vector<uint32_t>& abstractPath) const
+	{
+		const uint32_t start = query.srcBase + query.srcBounds.local(query.src.first, query.src.second);
+		const uint32_t goal = query.destBase + query.destBounds.local(query.dest.first, query.dest.second);
+
+		context.beginQuery(size_t(query.destBase) + size_t(size) * size_t(size));
+		IndexedDaryHeap<4>& openList = context.heap();
+
+		Node& first = context.node(start);
+		first.g = 0.0;
+		first.parent = start;
+		SearchContext::setState(first, Open);
+		openList.push(start, gridDistance(query.src, query.dest, diagonal) * heuristicWeight);
+		result.generated++;
+
+		bool found = false;
+
+		while (!openList.empty())
+		{
+			result.peakOpen = std::max(result.peakOpen, openList.size());
+
+			const uint32_t current = openList.pop();
+			Node& parent = context.node(current);
+			SearchContext::setState(parent, Closed);
+			result.expanded++;
+
+			if (current == goal)
+			{
+				found = true;
+				break;
+			}
+
+			// cellOf is only asked for the cell of next when it improves
+			auto relax = [&](uint32_t next, double cost, auto cellOf)
+			{
+				Node& node = context.node(next);
+				if (SearchContext::state(node) == Closed)
+					return;
+
+				double gNew = parent.g + cost;
+				if (gNew < node.g)
+				{
+					node.g = gNew;
+					node.parent = current;
+					SearchContext::setState(node, Open);
+					openList.push(next, gNew + gridDistance(cellOf(), query.dest, diagonal) * heuristicWeight);
+					result.generated++;
+				}
+			};
+
+			// A step across a border may only land on a node of the level
+			// it is searched on. One that level left out would go on
+			// searching the level below, far from the ends
+			auto step = [&](uint32_t partner)
+			{
+				const uint32_t next = searchId(query, partner);
+				if (next != NoNode)
+					relax(next, 1.0, [&]() { return Pair(nodes[partner].row, nodes[partner].col); });
+			};
+
+			if (current >= query.srcBase)
+			{
+				// A cell of the source's or the destination's cluster: its
+				// moves to cells of either, and if it is an entrance the
+				// steps across the border
+				const Pair cell = position(query, current);
+				const uint32_t around = moves(grid, cell.first, cell.second);
+
+				for (int bit = 0; bit < 9; bit++)
+				{
+					if (!(around & (1u << bit)))
+						continue;
+
+					const int nr = cell.first + stepRow[bit];
+					const int nc = cell.second + stepCol[bit];
+					const double cost = isDiagonalBit(bit) ? diagonalCost : 1.0;
+
+					auto cellOf = [&]() { return Pair(nr, nc); };
+
+					if (query.destBounds.contains(nr, nc))
+						relax(query.destBase + query.destBounds.local(nr, nc), cost, cellOf);
+					else if (query.srcBounds.contains(nr, nc))
+						relax(query.srcBase + query.srcBounds.local(nr, nc), cost, cellOf);
+				}
+
+				const uint32_t cluster = clusterAt(0, cell.first, cell.second);
+				const Bounds& bounds = cluster == query.destCluster ? query.destBounds : query.srcBounds;
+				if (cell.first == bounds.top || cell.first == bounds.bottom - 1 || cell.second == bounds.left || cell.second == bounds.right - 1)
+				{
+					const uint32_t node = nodeAt(cluster, grid.index(cell.first, cell.second));
+					for (int k = 0; node != NoNode && k < 2; k++)
+					{
+						if (nodes[node].partners[k] != NoNode)
+							step(nodes[node].partners[k]);
+					}
+				}
+				continue;
+			}
+
+			// Every node its cluster joins it to is searched on the same
+			// level, under the numbers next to its own
+			const int level = idLevel(query, current);
+			const uint32_t id = idNode(query, current, level);
+			const AbstractNode& node = nodes[id];
+			const Level& here = levels[size_t(level)];
+			const uint32_t clusterId = level == 0 ? node.cluster : clusterAt(level, node.row, node.col);
+			const Cluster& cluster = here.clusters[clusterId];
+			const uint32_t slot = here.slots[id];
+
+			const size_t n = cluster.nodes.size();
+			const float* distances = cluster.distances.data() + slot * n;
+
+			if (level == 0)
+			{
+				for (size_t j = 0; j < n; j++)
+				{
+					const uint32_t next = cluster.nodes[j];
+					if (j != slot && distances[j] < FLT_MAX)
+						relax(next, double(distances[j]), [&]() { return Pair(nodes[next].row, nodes[next].col); });
+				}
+			}
+			else
+			{
+				const uint32_t first = here.firstIds[clusterId];
+				for (size_t j = 0; j < n; j++)
+				{
+					const uint32_t number = first + uint32_t(j);
+					if (j != slot && distances[j] < FLT_MAX)
+						relax(query.levelBases[level] + number, double(distances[j]), [&]() { return here.cells[number]; });
+				}
+			}
+
+			for (int k = 0; k < 2; k++)
+			{
+				if (node.partners[k] != NoNode && node.partnerLevels[k] > level)
+					step(node.partners[k]);
+			}
+		}
+
+		result.touched += context.touchedCount();
+
+		if (!found)
+			return false;
+
+		// As node ids, and cells under their search ids
+		abstractPath.clear();
+		for (uint32_t id = goal; ; id = context.at(id).parent)
+		{
+			abstractPath.push_back(id < query.srcBase ? idNode(query, id, idLevel(query, id)) : id);
+			if (context.at(id).parent == id)
+				break;
+		}
+		std::reverse(abstractPath.begin(), abstractPath.end());
+
+		return true;
+	}
+
+	void HierarchicalGraph::clusterPath(uint32_t from, uint32_t to, std::vector<Pair>& path) const
+	{
+		const Cluster& cluster = levels[0].clusters[nodes[from].cluster];
+		const size_t a = levels[0].slots[from];
+		const size_t b = levels[0].slots[to];
+		const size_t pair = pairIndex(std::min(a, b), std::max(a, b), cluster.nodes.size());
+		const uint32_t begin = cluster.routeStarts[pair];
+		const uint32_t end = cluster.routeStarts[pair + 1];
+
+		Pair cell(nodes[from].row, nodes[from].col);
+		for (uint32_t k = begin; k < end; k++)
+		{
+			// Forwards from the lower slot, backwards from the higher
+			const uint32_t at = a < b ? k : begin + end - 1 - k;
+			const int stored = (cluster.steps[at / 2] >> (at % 2 * 4)) & 0xf;
+			const int bit = a < b ? stored : oppositeBit(stored);
+
+			cell.first += stepRow[bit];
+			cell.second += stepCol[bit];
+			path.push_back(cell);
+		}
+	}
+
+	SearchResult HierarchicalGraph::findPath(const Grid& grid, Pair src, Pair dest, SearchContext& context) const
+	{
+		SearchResult result;
+
+		if (!grid.isValid(src.first, src.second) || !grid.isValid(dest.first, dest.second))
+		{
+			result.status = SearchStatus::InvalidEndpoint;
+			return result;
+		}
+
+		if (!grid.isUnBlocked(src.first, src.second) || !grid.isUnBlocked(dest.first, dest.second))
+		{
+			result.status = SearchStatus::BlockedEndpoint;
+			return result;
+		}
+
+		if (src == dest)
+		{
+			result.status = SearchStatus::AlreadyAtDestination;
+			result.path.push_back(src);
+			return result;
+		}
+
+		Query query;
+		query.src = src;
+		query.dest = dest;
+		query.srcCluster = clusterAt(0, src.first, src.second);
+		query.destCluster = clusterAt(0, dest.first, dest.second);
+		query.srcBounds = clusterBounds(0, query.srcCluster);
+		query.destBounds = clusterBounds(0, query.destCluster);
+		query.levelBases[0] = 0;
+		query.srcBase = uint32_t(nodes.size());
+		for (size_t level = 1; level < levels.size(); level++)
+		{
+			query.levelBases[level] = query.srcBase;
+			query.srcBase += uint32_t(levels[level].order.size());
+		}
+		query.destBase = query.srcCluster == query.destCluster ? query.srcBase : query.srcBase + uint32_t(size * size);
+		query.topLevel = int(levels.size()) - 1;
+
+		for (int level = 0; level < int(levels.size()); level++)
+		{
+			query.srcClusters[level] = clusterAt(level, src.first, src.second);
+			query.destClusters[level] = clusterAt(level, dest.first, dest.second);
+		}
+
+		std::vector<uint32_t> abstractPath;
+		bool found = search(grid, query, context, result, abstractPath);
+
+		// The levels above keep only some of the transitions, which can
+		// cut off a way the lowest level still has
+		if (!found && query.topLevel > 0)
+		{
+			query.topLevel = 0;
+			found = search(grid, query, context, result, abstractPath);
+		}
+
+		if (!found)
+		{
+			result.status = SearchStatus::NoPath;
+			return result;
+		}
+
+		result.status = SearchStatus::Found;
+
+		// Refine every abstract edge: a move between cells of the end
+		// clusters, a step across a border, the kept moves between two
+		// nodes of one cluster, or on a level above the route it stands for
+		result.path.push_back(src);
+
+		for (size_t i = 1; i < abstractPath.size(); i++)
+		{
+			const uint32_t from = abstractPath[i - 1];
+			const uint32_t to = abstractPath[i];
+
+			if (from >= query.srcBase || to >= query.srcBase)
+			{
+				result.path.push_back(position(query, to));
+				continue;
+			}
+
+			const int level = scanLevel(query, from);
+			if (partnerLevel(from, to) > level)
+			{
+				result.path.push_back(position(query, to));
+				continue;
+			}
+
+			if (level == 0)
+			{
+				clusterPath(from, to, result.path);
+				continue;
+			}
+
+			const Level& here = levels[size_t(level)];
+			const Cluster& cluster = here.clusters[clusterAt(level, nodes[from].row, nodes[from].col)];
+			const size_t pair = here.slots[from] * cluster.nodes.size() + here.slots[to];
+
+			uint32_t previous = from;
+			for (uint32_t r = cluster.routeStarts[pair]; r < cluster.routeStarts[pair + 1]; r++)
+			{
+				const uint32_t next = cluster.routes[r];
+
+				if (nodes[next].cluster == nodes[previous].cluster)
+					clusterPath(previous, next, result.path);
+				else
+					result.path.push_back(Pair(nodes[next].row, nodes[next].col));
+
+				previous = next;
+			}
+		}
+
+		for (size_t i = 1; i < result.path.size(); i++)
+		{
+			const bool straight = result.path[i].first == result.path[i - 1].first || result.path[i].second == result.path[i - 1].second;
+			result.cost += straight ? 1.0 : diagonalCost;
+		}
+
+		return result;
+	}
+}
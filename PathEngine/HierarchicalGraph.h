@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AStarSearch.h"
+#include "ThreadPool.h"
+
+namespace PathEngine
+{
+	/*
+	 Multi-level HPA* style abstraction of a grid for long-distance queries.
+	 The grid is cut into square clusters. Along every border between two
+	 clusters each run of cells that is open on both sides becomes an
+	 entrance: short runs get one transition in the middle, long runs one
+	 at each end. The cells at either side of a transition are abstract
+	 nodes, joined by a step across the border, and the abstract nodes of
+	 a cluster are joined by their shortest distance inside the cluster,
+	 keeping the moves of that path.
+	 The first level above groups 2x2 clusters, each level after that 4x4
+	 of the one below. Across each of its borders a level keeps only a few
+	 of the transitions of the level below, spread along the border but at
+	 least one between every two parts of the clusters that touch there,
+	 and joins the nodes of a cluster by their shortest distance over the
+	 level below, remembering which nodes of the lowest level that runs
+	 through. Levels are added until the top one is at most 4 clusters
+	 across.
+	 A query walks the cells of the clusters of the source and the
+	 destination, and everywhere else the highest level whose cluster
+	 holds neither, so the nodes a query expands grow with the number of
+	 levels rather than with the distance. Every edge of the abstract path
+	 is then refined back into cells by replaying the kept moves, without
+	 searching again. Paths are usually within a few percent of optimal.
+	 When cells change only the clusters (and borders) holding them, and
+	 the clusters above those, are rebuilt.*/
+	class HierarchicalGraph
+	{
+	public:
+		explicit HierarchicalGraph(int clusterSize = 32, bool allowDiagonal = false);
+
+		// Builds the whole hierarchy, optionally spreading the clusters
+		// over the threads of pool
+		void build(const Grid& grid, ThreadPool* pool = nullptr);
+
+		// Brings the hierarchy up to date after the listed cells of grid
+		// have changed. Rebuilds everything if the grid size changed
+		void update(const Grid& grid, const std::vector<Pair>& changedCells, ThreadPool* pool = nullptr);
+
+		// Safe to call from several threads at once, each with its own
+		// context. The context only needs room for the abstract nodes and
+		// two clusters, not for the grid
+		SearchResult findPath(const Grid& grid, Pair src, Pair dest, SearchContext& context) const;
+
+		int clusterSize() const { return size; }
+		int levelCount() const { return int(levels.size()); }
+
+		// Clusters, nodes and edges of the lowest level, edges of every
+		// level in edgeCount
+		size_t clusterCount() const { return levels.empty() ? 0 : levels[0].clusters.size(); }
+		size_t nodeCount() const { return nodes.size() - freeNodes.size(); }
+		size_t edgeCount() const;
+
+		// Number of clusters, on all levels, the last build or update had
+		// to recompute
+		size_t lastRebuildCount() const { return lastRebuilt; }
+
+	private:
+		struct Bounds
+		{
+			int top, left, bottom, right;
+
+			bool contains(int row, int col) const { return row >= top && row < bottom && col >= left && col < right; }
+			int width() const { return right - left; }
+			int cellCount() const { return (bottom - top) * (right - left); }
+			uint32_t local(int row, int col) const { return uint32_t((row - top) * width() + (col - left)); }
+		};
+
+		// The two cells of a transition and their nodes, first is in the
+		// upper / left cluster
+		struct Transition
+		{
+			uint32_t first, second;
+			uint32_t firstNode, secondNode;
+		};
+
+		// An entrance cell. It is a node of the lowest level, and of every
+		// level above that keeps one of its transitions
+		struct AbstractNode
+		{
+			uint32_t cell;
+			int row, col;
+
+			// The lowest-level cluster holding the cell, NoNode while the
+			// id is free
+			uint32_t cluster;
+
+			// The nodes across the borders it touches (at most two, one
+			// above or below and one to the side) and how many levels each
+			// transition is kept on, 0 for none
+			uint32_t partners[2];
+			uint8_t partnerLevels[2];
+		};
+
+		struct Cluster
+		{
+			// Node ids, in slot order
+			std::vector<uint32_t> nodes;
+
+			// nodes.size() x nodes.size() shortest distances inside the
+			// cluster, FLT_MAX between nodes that can not reach each other
+			std::vector<float> distances;
+
+			// Above the lowest level, the lowest-level nodes the shortest
+			// path from slot a to slot b runs through, after a and up to b:
+			// routes[routeStarts[a * n + b]] up to routes[routeStarts[a * n + b + 1]]
+			// On the lowest level, the moves (BitGrid::neighbourhood bits,
+			// two to a byte) of the shortest path from slot a to a later
+			// slot b, one pair after the other: steps from routeStarts[pair]
+			// up to routeStarts[pair + 1], see pairIndex in
+			// HierarchicalGraph.cpp
+			std::vector<uint32_t> routeStarts;
+			std::vector<uint32_t> routes;
+			std::vector<uint8_t> steps;
+		};
+
+		struct Level
+		{
+			// Cells along the side of a cluster, and clusters of the level
+			// below (1 on the lowest)
+			int span;
+			int factor;
+			int clusterRows;
+			int clusterCols;
+			std::vector<Cluster> clusters;
+
+			// Indexed by node id: the slot of a node in its cluster on this
+			// level, and above the lowest level which part of its cluster
+			// here the node of the level below is in
+			std::vector<uint32_t> slots;
+			std::vector<uint32_t> components;
+
+			// Above the lowest level a query searches the nodes of this
+			// level under numbers of its own, cluster after cluster, so the
+			// nodes a cluster joins sit next to each other in the memory of
+			// the search: where the numbers of each cluster start (and one
+			// past the last), and the node and cell behind every number
+			std::vector<uint32_t> firstIds;
+			std::vector<uint32_t> order;
+			std::vector<Pair> cells;
+		};
+
+		// Per-thread memory for building clusters, and where the ids of a
+		// query's search point, see HierarchicalGraph.cpp
+		struct Scratch;
+		struct Query;
+
+		Bounds clusterBounds(int level, uint32_t cluster) const;
+		uint32_t clusterAt(int level, int row, int col) const
+		{
+			const Level& l = levels[size_t(level)];
+			return uint32_t((row / l.span) * l.clusterCols + col / l.span);
+		}
+
+		int height(uint32_t node) const { return std::max(nodes[node].partnerLevels[0], nodes[node].partnerLevels[1]); }
+		int partnerLevel(uint32_t node, uint32_t partner) const;
+		void setPartnerLevel(uint32_t node, uint32_t partner, int levelCount);
+		void addPartner(uint32_t node, uint32_t partner);
+		void removePartner(uint32_t node, uint32_t partner);
+		uint32_t nodeAt(uint32_t cluster, uint32_t cell) const;
+
+		// The moves out of a cell as BitGrid::neighbourhood bits
+		uint32_t moves(const Grid& grid, int row, int col) const;
+
+		void buildBorder(const Grid& grid, uint32_t cluster, bool below);
+		void collectNodes(uint32_t cluster);
+		void linkNodes(uint32_t cluster);
+		void buildBaseCluster(const Grid& grid, uint32_t cluster, Scratch& scratch);
+		void rebuildLevels(const Grid& grid, const std::vector<uint32_t>& dirty, ThreadPool* pool);
+
+		// Above the lowest level
+		void gatherNodes(int level, uint32_t cluster, Scratch& scratch) const;
+		uint32_t localIndex(int level, uint32_t cluster, uint32_t node, const Scratch& scratch) const;
+		void findComponents(int level, uint32_t cluster, Scratch& scratch);
+		bool selectBorder(int level, uint32_t cluster, bool below, Scratch& scratch);
+		void buildUpperCluster(int level, uint32_t cluster, Scratch& scratch);
+		void numberLevel(int level);
+
+		uint32_t searchId(const Query& query, uint32_t node) const;
+		int idLevel(const Query& query, uint32_t id) const;
+		uint32_t idNode(const Query& query, uint32_t id, int level) const;
+		Pair position(const Query& query, uint32_t id) const;
+		int scanLevel(const Query& query, uint32_t node) const;
+		bool search(const Grid& grid, const Query& query, SearchContext& context, SearchResult& result, std::vector<uint32_t>& abstractPath) const;
+
+		// Appends the cells of the shortest path between two nodes of one
+		// lowest-level cluster, after from and up to to
+		void clusterPath(uint32_t from, uint32_t to, std::vector<Pair>& path) const;
+
+		int size;
+		bool diagonal;
+
+		int rows;
+		int cols;
+
+		std::vector<Level> levels;
+
+		// Transitions across the bottom / right border of each lowest-level cluster
+		std::vector<std::vector<Transition>> belowBorders;
+		std::vector<std::vector<Transition>> rightBorders;
+
+		std::vector<AbstractNode> nodes;
+		std::vector<uint32_t> freeNodes;
+
+		size_t lastRebuilt;
+	};
+}
@@ -0,0 +1,114 @@
+#include "JumpPointSearch.h"
+
+namespace PathEngine
+{
+	const double JumpPointExpander::diagonalCost = 1.4142135623730951;
+
+	namespace
+	{
+		/*
+		 Walks along a row of bits from col in direction dir (+1 or -1),
+		 64 cells per step, until it reaches the target column, a cell
+		 with a forced neighbour (an open cell beside the row whose cell
+		 behind it is blocked), or a blocked cell. Only the first two
+		 are jump points. Vertical moves run the same scan over the
+		 transposed bits.*/
+		bool scanRow(const BitGrid& bits, int row, int col, int dir, int targetRow, int targetCol, int& found)
+		{
+			const bool targetOnRow = row == targetRow;
+
+			if (dir > 0)
+			{
+				for (;;)
+				{
+					uint64_t open = bits.bitsFrom(row, col);
+					uint64_t above = bits.bitsFrom(row - 1, col) & ~bits.bitsFrom(row - 1, col - 1);
+					uint64_t below = bits.bitsFrom(row + 1, col) & ~bits.bitsFrom(row + 1, col - 1);
+					uint64_t stop = ~open | above | below;
+
+					if (targetOnRow && targetCol >= col && targetCol - col < 64)
+						stop |= uint64_t(1) << (targetCol - col);
+
+					if (stop != 0)
+					{
+						int at = lowestBit(stop);
+						found = col + at;
+						return (open >> at) & 1;
+					}
+
+					col += 64;
+				}
+			}
+
+			for (;;)
+			{
+				uint64_t open = bits.bitsUpTo(row, col);
+				uint64_t above = bits.bitsUpTo(row - 1, col) & ~bits.bitsUpTo(row - 1, col + 1);
+				uint64_t below = bits.bitsUpTo(row + 1, col) & ~bits.bitsUpTo(row + 1, col + 1);
+				uint64_t stop = ~open | above | below;
+
+				if (targetOnRow && targetCol <= col && col - targetCol < 64)
+					stop |= uint64_t(1) << (63 - (col - targetCol));
+
+				if (stop != 0)
+				{
+					int at = highestBit(stop);
+					found = col - (63 - at);
+					return (open >> at) & 1;
+				}
+
+				col -= 64;
+			}
+		}
+	}
+
+	// Walks from (r, c) in a straight direction until it reaches the
+	// destination, a cell with a forced neighbour, or a wall
+	bool JumpPointExpander::jumpStraight(int r, int c, int dr, int dc, Pair& found) const
+	{
+		int at;
+
+		if (dc != 0)
+		{
+			if (!scanRow(grid.bits(), r, c, dc, dest.first, dest.second, at))
+				return false;
+
+			found = Pair(r, at);
+			return true;
+		}
+
+		if (!scanRow(grid.transposedBits(), c, r, dr, dest.second, dest.first, at))
+			return false;
+
+		found = Pair(at, c);
+		return true;
+	}
+
+	// Walks from (r, c) diagonally, stopping at the destination or at a
+	// cell from which one of the two straight directions finds a jump point
+	bool JumpPointExpander::jumpDiagonal(int r, int c, int dr, int dc, Pair& found) const
+	{
+		for (;;)
+		{
+			if (!grid.isWalkable(r, c))
+				return false;
+
+			if (r == dest.first && c == dest.second)
+				break;
+
+			Pair ignored;
+			if (jumpStraight(r + dr, c, dr, 0, ignored) || jumpStraight(r, c + dc, 0, dc, ignored))
+				break;
+
+			// Moving on diagonally must not cut a corner
+			if (!(grid.isWalkable(r + dr, c) && grid.isWalkable(r, c + dc)))
+				return false;
+
+			r += dr;
+			c += dc;
+		}
+
+		found = Pair(r, c);
+		return true;
+	}
+}
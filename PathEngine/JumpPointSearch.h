@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdlib>
+
+#include "Grid.h"
+
+namespace PathEngine
+{
+	/*
+	 Successor generator for Jump Point Search on an 8-connected grid
+	 where every step costs 1 (straight) or sqrt(2) (diagonal) and a
+	 diagonal step may not cut the corner of a blocked cell.
+	 Instead of its direct neighbours, a cell's successors are the next
+	 jump points along each direction that is not pruned: cells that
+	 are the destination or that have a neighbour which can only be
+	 reached optimally through them (a forced neighbour). Every path
+	 between two jump points is a straight or diagonal line, so A* over
+	 jump points finds the same optimal cost as A* over all cells while
+	 putting far fewer cells on the open list.*/
+	class JumpPointExpander
+	{
+	public:
+		JumpPointExpander(const Grid& grid, Pair dest) : grid(grid), dest(dest) {}
+
+		// Calls visit(row, col, cost) for every jump point reachable from
+		// pos, when pos was reached from parent. The start cell is its
+		// own parent and gets all of its neighbours as directions
+		template <class Visit>
+		void operator()(Pair pos, Pair parent, Visit visit) const
+		{
+			const int r = pos.first;
+			const int c = pos.second;
+
+			if (pos == parent)
+			{
+				for (int dr = -1; dr <= 1; dr++)
+				{
+					for (int dc = -1; dc <= 1; dc++)
+					{
+						if (dr != 0 || dc != 0)
+							jumpFrom(r, c, dr, dc, visit);
+					}
+				}
+				return;
+			}
+
+			const int dr = sign(r - parent.first);
+			const int dc = sign(c - parent.second);
+
+			if (dr != 0 && dc != 0)
+			{
+				// Diagonal: keep going straight along both components,
+				// and diagonally if neither corner is blocked
+				bool vertical = grid.isWalkable(r + dr, c);
+				bool horizontal = grid.isWalkable(r, c + dc);
+
+				if (vertical)
+					jumpFrom(r, c, dr, 0, visit);
+				if (horizontal)
+					jumpFrom(r, c, 0, dc, visit);
+				if (vertical && horizontal)
+					jumpFrom(r, c, dr, dc, visit);
+			}
+			else if (dc != 0)
+			{
+				// Horizontal: keep going, and turn towards an open side
+				// both straight and diagonally
+				bool ahead = grid.isWalkable(r, c + dc);
+				bool up = grid.isWalkable(r - 1, c);
+				bool down = grid.isWalkable(r + 1, c);
+
+				if (ahead)
+				{
+					jumpFrom(r, c, 0, dc, visit);
+					if (up)
+						jumpFrom(r, c, -1, dc, visit);
+					if (down)
+						jumpFrom(r, c, 1, dc, visit);
+				}
+				if (up)
+					jumpFrom(r, c, -1, 0, visit);
+				if (down)
+					jumpFrom(r, c, 1, 0, visit);
+			}
+			else
+			{
+				// Vertical, the same as horizontal turned a quarter
+				bool ahead = grid.isWalkable(r + dr, c);
+				bool left = grid.isWalkable(r, c - 1);
+				bool right = grid.isWalkable(r, c + 1);
+
+				if (ahead)
+				{
+					jumpFrom(r, c, dr, 0, visit);
+					if (left)
+						jumpFrom(r, c, dr, -1, visit);
+					if (right)
+						jumpFrom(r, c, dr, 1, visit);
+				}
+				if (left)
+					jumpFrom(r, c, 0, -1, visit);
+				if (right)
+					jumpFrom(r, c, 0, 1, visit);
+			}
+		}
+
+	private:
+		static int sign(int value) { return (value > 0) - (value < 0); }
+
+		template <class Visit>
+		void jumpFrom(int r, int c, int dr, int dc, Visit& visit) const
+		{
+			// A diagonal first step may not cut a corner either
+			if (dr != 0 && dc != 0 && !(grid.isWalkable(r + dr, c) && grid.isWalkable(r, c + dc)))
+				return;
+
+			Pair found;
+			bool reached = (dr != 0 && dc != 0)
+				? jumpDiagonal(r + dr, c + dc, dr, dc, found)
+				: jumpStraight(r + dr, c + dc, dr, dc, found);
+
+			if (!reached)
+				return;
+
+			int steps = std::abs(found.first - r) > std::abs(found.second - c) ? std::abs(found.first - r) : std::abs(found.second - c);
+			visit(found.first, found.second, (dr != 0 && dc != 0) ? steps * diagonalCost : double(steps));
+		}
+
+		bool jumpStraight(int r, int c, int dr, int dc, Pair& found) const;
+		bool jumpDiagonal(int r, int c, int dr, int dc, Pair& found) const;
+
+		static const double diagonalCost;
+
+		const Grid& grid;
+		Pair dest;
+	};
+}
@@ -0,0 +1,338 @@
+#include "Landmarks.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace PathEngine
+{
+	namespace
+	{
+		const char fileMagic[8] = { 'P', 'E', 'L', 'M', 'A', 'R', 'K', '\0' };
+		const uint32_t fileVersion = 1;
+
+		// The layout on disk: the header, count landmark cells, then
+		// rows * cols * count distances
+		struct FileHeader
+		{
+			char magic[8];
+			uint32_t version;
+			int32_t rows;
+			int32_t cols;
+			uint32_t count;
+			uint32_t flags;
+			uint32_t scale;
+			uint64_t gridHash;
+		};
+
+		static_assert(sizeof(FileHeader) == 40, "FileHeader must not be padded");
+
+		// Step lengths in table units
+		struct Steps
+		{
+			bool diagonal;
+			bool terrain;
+			uint64_t straight;
+			uint64_t diagonalLength;
+		};
+
+		struct Direction
+		{
+			int di, dj;
+		};
+
+		const Direction directions[] =
+		{
+			{ -1,  0 },	// North
+			{  1,  0 },	// South
+			{  0,  1 },	// East
+			{  0, -1 },	// West
+			{ -1,  1 },	// North-East
+			{ -1, -1 },	// North-West
+			{  1,  1 },	// South-East
+			{  1, -1 },	// South-West
+		};
+
+		uint32_t bit(int di, int dj) { return 1u << ((di + 1) * 3 + (dj + 1)); }
+
+		// Dijkstra from one cell over the moves of the A* search. On
+		// terrain a move costs the cell it enters, so these are the
+		// distances from the cell, not to it
+		void measure(const Grid& grid, const Steps& steps, uint32_t from, std::vector<uint64_t>& distance, IndexedDaryHeap<4, uint64_t>& openList)
+		{
+			std::fill(distance.begin(), distance.end(), UINT64_MAX);
+			distance[from] = 0;
+			openList.clear();
+			openList.push(from, 0);
+
+			const int count = steps.diagonal ? 8 : 4;
+
+			while (!openList.empty())
+			{
+				const uint64_t g = openList.topKey();
+				const uint32_t current = openList.pop();
+				const Pair pos = grid.position(current);
+				const uint32_t around = grid.bits().neighbourhood(pos.first, pos.second);
+
+				for (int i = 0; i < count; i++)
+				{
+					const Direction& d = directions[i];
+					const uint32_t needed = i < 4 ? bit(d.di, d.dj) : bit(d.di, d.dj) | bit(d.di, 0) | bit(0, d.dj);
+
+					if ((around & needed) != needed)
+						continue;
+
+					const int ni = pos.first + d.di;
+					const int nj = pos.second + d.dj;
+					const uint32_t next = grid.index(ni, nj);
+
+					uint64_t cost = i < 4 ? steps.straight : steps.diagonalLength;
+					if (steps.terrain)
+						cost *= grid.get(ni, nj);
+
+					if (g + cost < distance[next])
+					{
+						// Lowers the key when the cell is already queued
+						openList.push(next, g + cost);
+						distance[next] = g + cost;
+					}
+				}
+			}
+		}
+
+		// Distances past what the table can hold count as unreachable,
+		// which only loses a bound, never makes one wrong
+		uint32_t tableDistance(uint64_t distance)
+		{
+			return distance < LandmarkTable::Unreachable ? uint32_t(distance) : LandmarkTable::Unreachable;
+		}
+	}
+
+	const uint32_t LandmarkTable::Unreachable;
+
+	LandmarkTable::LandmarkTable()
+		: rows(0), cols(0), count(0), flags(0), unitScale(1), gridHash(0), gridVersion(0), table(nullptr)
+	{
+	}
+
+	void LandmarkTable::clear()
+	{
+		rows = cols = 0;
+		count = 0;
+		flags = 0;
+		unitScale = 1;
+		gridHash = 0;
+		gridVersion = 0;
+		table = nullptr;
+		landmarks.clear();
+		owned.clear();
+		owned.shrink_to_fit();
+		file.close();
+	}
+
+	uint32_t LandmarkTable::flagsFor(const SearchOptions& options)
+	{
+		uint32_t result = 0;
+
+		if (options.allowDiagonal)
+			result |= DiagonalFlag;
+
+		if (options.allowDiagonal && options.moveCost == MoveCostType::Octile)
+			result |= OctileFlag;
+
+		if (options.terrainCosts)
+			result |= TerrainFlag;
+
+		return result;
+	}
+
+	// FNV-1a over the size and every cell
+	uint64_t LandmarkTable::hashGrid(const Grid& grid)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&hash](uint8_t byte)
+		{
+			hash ^= byte;
+			hash *= 1099511628211ull;
+		};
+
+		const uint32_t size[2] = { uint32_t(grid.rows()), uint32_t(grid.cols()) };
+		for (uint32_t value : size)
+		{
+			for (int shift = 0; shift < 32; shift += 8)
+				add(uint8_t(value >> shift));
+		}
+
+		const uint8_t* cells = grid.data();
+		for (size_t i = 0; i < grid.size(); i++)
+			add(cells[i]);
+
+		return hash;
+	}
+
+	void LandmarkTable::build(const Grid& grid, int landmarkCount, const SearchOptions& options)
+	{
+		clear();
+
+		rows = grid.rows();
+		cols = grid.cols();
+		flags = flagsFor(options);
+		unitScale = (flags & OctileFlag) ? 1024 : 1;
+		gridHash = hashGrid(grid);
+		gridVersion = grid.version();
+
+		Steps steps;
+		steps.diagonal = (flags & DiagonalFlag) != 0;
+		steps.terrain = (flags & TerrainFlag) != 0;
+		steps.straight = unitScale;
+		steps.diagonalLength = !(flags & OctileFlag) ? 1 : steps.terrain ? uint64_t(TerrainOctileMoves::diagonal) : 1448;
+
+		// Start from the walkable cell closest to the middle, which is
+		// rarely cut off from the rest of the map
+		const size_t cells = grid.size();
+		uint32_t seed = UINT32_MAX;
+		int seedDistance = 0;
+
+		for (uint32_t i = 0; i < cells; i++)
+		{
+			const Pair pos = grid.position(i);
+			const int distance = std::abs(2 * pos.first - rows) + std::abs(2 * pos.second - cols);
+
+			if (grid.isUnBlocked(pos.first, pos.second) && (seed == UINT32_MAX || distance < seedDistance))
+			{
+				seed = i;
+				seedDistance = distance;
+			}
+		}
+
+		if (seed == UINT32_MAX || landmarkCount <= 0)
+			return;
+
+		const uint32_t requested = uint32_t(landmarkCount);
+		owned.assign(cells * requested, Unreachable);
+
+		std::vector<uint64_t> distance(cells);
+		IndexedDaryHeap<4, uint64_t> openList;
+		openList.reserve(cells);
+
+		// Distance to the closest landmark so far, the next landmark is
+		// the reachable cell farthest from all of them. The first is the
+		// one farthest from the seed, on the edge of the map
+		std::vector<uint64_t> closest(cells, UINT64_MAX);
+		measure(grid, steps, seed, distance, openList);
+		std::copy(distance.begin(), distance.end(), closest.begin());
+
+		while (landmarks.size() < requested)
+		{
+			uint32_t farthest = UINT32_MAX;
+			for (uint32_t i = 0; i < cells; i++)
+			{
+				if (closest[i] != UINT64_MAX && closest[i] > 0 && (farthest == UINT32_MAX || closest[i] > closest[farthest]))
+					farthest = i;
+			}
+
+			// Every reachable cell is a landmark already
+			if (farthest == UINT32_MAX)
+				break;
+
+			const uint32_t slot = uint32_t(landmarks.size());
+			landmarks.push_back(farthest);
+			measure(grid, steps, farthest, distance, openList);
+
+			for (uint32_t i = 0; i < cells; i++)
+			{
+				owned[size_t(i) * requested + slot] = tableDistance(distance[i]);
+				closest[i] = std::min(closest[i], distance[i]);
+			}
+		}
+
+		count = uint32_t(landmarks.size());
+
+		// Fewer landmarks than asked for, close the gaps between cells
+		if (count < requested)
+		{
+			for (size_t i = 0; i < cells; i++)
+				std::copy_n(owned.begin() + i * requested, count, owned.begin() + i * count);
+
+			owned.resize(cells * count);
+		}
+
+		table = owned.data();
+	}
+
+	bool LandmarkTable::save(const std::string& path) const
+	{
+		FILE* out = std::fopen(path.c_str(), "wb");
+		if (out == nullptr)
+			return false;
+
+		FileHeader header;
+		std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+		header.version = fileVersion;
+		header.rows = rows;
+		header.cols = cols;
+		header.count = count;
+		header.flags = flags;
+		header.scale = unitScale;
+		header.gridHash = gridHash;
+
+		const size_t values = size_t(rows) * size_t(cols) * count;
+		bool written = std::fwrite(&header, sizeof(header), 1, out) == 1;
+		written = written && std::fwrite(landmarks.data(), sizeof(uint32_t), count, out) == count;
+		written = written && std::fwrite(table, sizeof(uint32_t), values, out) == values;
+
+		return std::fclose(out) == 0 && written;
+	}
+
+	bool LandmarkTable::load(const std::string& path, const Grid& grid)
+	{
+		clear();
+
+		if (!file.open(path) || file.size() < sizeof(FileHeader))
+		{
+			file.close();
+			return false;
+		}
+
+		FileHeader header;
+		std::memcpy(&header, file.data(), sizeof(header));
+
+		const size_t values = size_t(grid.rows()) * size_t(grid.cols()) * header.count;
+		const bool valid = std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) == 0 && header.version == fileVersion &&
+			header.rows == grid.rows() && header.cols == grid.cols() && header.count > 0 &&
+			file.size() == sizeof(FileHeader) + sizeof(uint32_t) * (header.count + values);
+
+		// Hashing reads the whole grid, but none of the table
+		if (!valid || header.gridHash != hashGrid(grid))
+		{
+			file.close();
+			return false;
+		}
+
+		rows = header.rows;
+		cols = header.cols;
+		count = header.count;
+		flags = header.flags;
+		unitScale = header.scale;
+		gridHash = header.gridHash;
+
+		// The hash matched, so the table holds for the grid as it is now
+		gridVersion = grid.version();
+
+		const uint32_t* cells = reinterpret_cast<const uint32_t*>(file.data() + sizeof(FileHeader));
+		landmarks.assign(cells, cells + count);
+		table = cells + count;
+		return true;
+	}
+
+	Pair LandmarkTable::landmark(int i) const
+	{
+		return Pair(int(landmarks[i] / uint32_t(cols)), int(landmarks[i] % uint32_t(cols)));
+	}
+
+	bool LandmarkTable::matches(const Grid& grid, const SearchOptions& options) const
+	{
+		return count > 0 && gridVersion == grid.version() && rows == grid.rows() && cols == grid.cols() && flags == flagsFor(options);
+	}
+}
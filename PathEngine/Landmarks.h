@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AStarSearch.h"
+#include "MappedFile.h"
+
+namespace PathEngine
+{
+	/*
+	 Distance tables for the ALT heuristic (A*, Landmarks, Triangle
+	 inequality). A few landmark cells are spread over the map and the
+	 true distance from each of them to every cell is stored. For any
+	 landmark L the triangle inequality gives
+	   d(n, t) >= d(L, t) - d(L, n)
+	 (and the mirrored bound when moves cost the same both ways), which
+	 knows about walls and is far tighter than a straight-line distance
+	 on maze-like maps.
+	 Distances are exact integers in the units of the search: steps, or
+	 1/1024th of a step with octile diagonals, where a diagonal counts
+	 1448 (just under sqrt(2)) so the bound stays admissible, or the 1449
+	 that terrain moves use, so it is exact for them. A table is
+	 built for one set of moves and one grid. Building costs a Dijkstra
+	 per landmark, so tables are meant to be saved once and mapped into
+	 memory when the program starts.
+	 Numbers are saved in the byte order of the machine that wrote the
+	 file; read on the other byte order the version does not match and
+	 the file is refused.*/
+	class LandmarkTable
+	{
+	public:
+		// Distance of a cell the landmark can not reach, or too far to count
+		static const uint32_t Unreachable = 0xFFFFFFFFu;
+
+		LandmarkTable();
+
+		// Spreads count landmarks over grid, each as far as possible from
+		// the ones before, and measures the distances with the moves
+		// (allowDiagonal, moveCost, terrainCosts) of options
+		void build(const Grid& grid, int count, const SearchOptions& options);
+
+		// Writes the table, false on an I/O error
+		bool save(const std::string& path) const;
+
+		// Maps a file written by save. Fails, leaving the table empty, when
+		// the file is missing, of another version, or built for another grid
+		bool load(const std::string& path, const Grid& grid);
+
+		void clear();
+
+		bool empty() const { return count == 0; }
+		int landmarkCount() const { return int(count); }
+		Pair landmark(int i) const;
+
+		// Whether the table was built for this grid as it is now, by its
+		// version, and the moves of options. Any grid.set since, even one
+		// that opens a cell, asks for a rebuild: distances that could now
+		// be shorter no longer bound the search from below
+		bool matches(const Grid& grid, const SearchOptions& options) const;
+
+		// Table units per step, 1024 with octile diagonals, else 1
+		uint32_t scale() const { return unitScale; }
+
+		// Whether moves cost the same both ways (no terrain costs)
+		bool symmetric() const { return (flags & TerrainFlag) == 0; }
+
+		// The distances from every landmark to cell
+		const uint32_t* distances(uint32_t cell) const { return table + size_t(cell) * count; }
+
+	private:
+		enum Flags : uint32_t
+		{
+			DiagonalFlag = 1,
+			OctileFlag = 2,
+			TerrainFlag = 4
+		};
+
+		static uint32_t flagsFor(const SearchOptions& options);
+		static uint64_t hashGrid(const Grid& grid);
+
+		int rows;
+		int cols;
+		uint32_t count;
+		uint32_t flags;
+		uint32_t unitScale;
+		uint64_t gridHash;
+		uint64_t gridVersion;
+
+		std::vector<uint32_t> landmarks;
+
+		// cells * count distances, cell-major so that one heuristic call
+		// reads one run of memory. Points into owned or into file
+		const uint32_t* table;
+		std::vector<uint32_t> owned;
+		MappedFile file;
+	};
+
+	// The ALT heuristic on top of a geometric one, taking the larger of
+	// the two. base is scaled by baseWeight (terrain units), the table
+	// by unit (table units to g units), and both by weight
+	template <class HValue>
+	struct LandmarkHValue
+	{
+		LandmarkHValue(const Grid& grid, const LandmarkTable& table, HValue base, double baseWeight, double unit, double weight)
+			: grid(grid), table(table), base(base), baseWeight(baseWeight), unit(unit), weight(weight), count(table.landmarkCount()), symmetric(table.symmetric())
+		{
+		}
+
+		double operator()(int row, int col, Pair dest) const
+		{
+			const uint32_t* from = table.distances(grid.index(row, col));
+			const uint32_t* to = table.distances(grid.index(dest.first, dest.second));
+			uint32_t bound = 0;
+
+			for (int i = 0; i < count; i++)
+			{
+				if (from[i] == LandmarkTable::Unreachable || to[i] == LandmarkTable::Unreachable)
+					continue;
+
+				if (to[i] > from[i])
+				{
+					if (to[i] - from[i] > bound)
+						bound = to[i] - from[i];
+				}
+				else if (symmetric && from[i] - to[i] > bound)
+				{
+					bound = from[i] - to[i];
+				}
+			}
+
+			const double geometric = baseWeight * base(row, col, dest);
+			const double landmark = unit * bound;
+			return weight * (geometric > landmark ? geometric : landmark);
+		}
+
+		const Grid& grid;
+		const LandmarkTable& table;
+		HValue base;
+		double baseWeight;
+		double unit;
+		double weight;
+		int count;
+		bool symmetric;
+	};
+}
@@ -0,0 +1,119 @@
+#include "LineOfSight.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+namespace PathEngine
+{
+	namespace
+	{
+		// Every cell from first to last on the row is walkable
+		bool runOpen(const BitGrid& bits, int row, int first, int last)
+		{
+			for (int col = first; col <= last; col += 64)
+			{
+				const int length = last - col + 1;
+				const uint64_t wanted = length >= 64 ? ~uint64_t(0) : (uint64_t(1) << length) - 1;
+
+				if ((bits.bitsFrom(row, col) & wanted) != wanted)
+					return false;
+			}
+
+			return true;
+		}
+
+		// A column along the line, col + fraction / denominator, with
+		// 0 <= fraction < denominator
+		struct Crossing
+		{
+			int64_t col;
+			int64_t fraction;
+		};
+
+		// A move along the line by step / denominator columns, split the
+		// same way, so that advancing is two additions and a carry
+		struct Step
+		{
+			Step(int64_t step, int64_t denominator)
+			{
+				whole = step / denominator;
+				fraction = step % denominator;
+
+				if (fraction < 0)
+				{
+					whole--;
+					fraction += denominator;
+				}
+			}
+
+			int64_t whole;
+			int64_t fraction;
+		};
+
+		Crossing advance(Crossing at, const Step& step, int64_t denominator)
+		{
+			at.fraction += step.fraction;
+			const int64_t carry = at.fraction >= denominator;
+			at.col += step.whole + carry;
+			at.fraction -= carry * denominator;
+			return at;
+		}
+
+		// The line from the centre of (r0, c0) to the centre of (r1, c1),
+		// crossing no more rows than columns
+		bool shallowLineOfSight(const BitGrid& bits, int r0, int c0, int r1, int c1)
+		{
+			if (r0 > r1)
+			{
+				std::swap(r0, r1);
+				std::swap(c0, c1);
+			}
+
+			if (r0 == r1)
+				return c0 <= c1 ? runOpen(bits, r0, c0, c1) : runOpen(bits, r0, c1, c0);
+
+			// In units of 1 / denominator columns the line moves
+			// (c1 - c0) * 4 per row, and crosses the first border between
+			// rows half a row after the centre it starts from
+			const int64_t denominator = 4 * int64_t(r1 - r0);
+			const int64_t perRow = 4 * int64_t(c1 - c0);
+			const Step halfRow(perRow / 2, denominator);
+			const Step wholeRow(perRow, denominator);
+			const bool rightwards = c1 >= c0;
+
+			Crossing entry = { c0, denominator / 2 };
+			Crossing exit = advance(entry, halfRow, denominator);
+
+			for (int row = r0; row <= r1; row++)
+			{
+				if (row == r1)
+					exit = Crossing{ c1, denominator / 2 };
+
+				const Crossing& left = rightwards ? entry : exit;
+				const Crossing& right = rightwards ? exit : entry;
+
+				// A crossing on a corner touches the cell on each side of it
+				const int first = int(left.col - (left.fraction == 0));
+				const int last = int(right.col);
+
+				if (!runOpen(bits, row, first, last))
+					return false;
+
+				entry = exit;
+				exit = advance(exit, wholeRow, denominator);
+			}
+
+			return true;
+		}
+	}
+
+	bool lineOfSight(const Grid& grid, Pair from, Pair to)
+	{
+		if (std::abs(to.first - from.first) <= std::abs(to.second - from.second))
+			return shallowLineOfSight(grid.bits(), from.first, from.second, to.first, to.second);
+
+		// Steep lines cross fewer columns than rows, walk the columns
+		return shallowLineOfSight(grid.transposedBits(), from.second, from.first, to.second, to.first);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Grid.h"
+
+namespace PathEngine
+{
+	/*
+	 Whether a straight line from the centre of one cell to the centre of
+	 another only crosses walkable cells, as the any-angle searches need
+	 it. Every cell the line passes through counts (a supercover, not
+	 the cells Bresenham would draw), and where the line runs exactly
+	 through the corner of four cells all four count, so the line never
+	 squeezes between two diagonal walls, like a diagonal move.
+	 The line is walked along its shorter axis: each row it crosses (or
+	 each column, on the transposed bits) covers one run of cells, which
+	 is tested 64 at a time. Where the line crosses into the next row is
+	 kept as an exact fraction, so there is no rounding and no division
+	 in the loop. Cells outside the grid read as blocked.*/
+	bool lineOfSight(const Grid& grid, Pair from, Pair to);
+}
@@ -0,0 +1,499 @@
+#include "MapGenerator.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace PathEngine
+{
+	namespace
+	{
+		const uint64_t golden = 0x9E3779B97F4A7C15ull;
+		const uint32_t none = 0xFFFFFFFF;
+
+		// The SplitMix64 finaliser, every bit of x affects every bit of
+		// the result
+		uint64_t mix(uint64_t x)
+		{
+			x ^= x >> 30;
+			x *= 0xBF58476D1CE4E5B9ull;
+			x ^= x >> 27;
+			x *= 0x94D049BB133111EBull;
+			x ^= x >> 31;
+			return x;
+		}
+
+		// Random numbers by position: draw(i) is the i-th number of the
+		// stream, computed on its own. Each use of randomness in a map
+		// has a stream of its own so the uses do not correlate
+		class CounterRng
+		{
+		public:
+			CounterRng(uint64_t seed, uint64_t stream) : key(mix(mix(seed) ^ (stream * golden))) {}
+
+			uint64_t draw(uint64_t counter) const { return mix(key + counter * golden); }
+
+			// In [0, 1)
+			double uniform(uint64_t counter) const { return double(draw(counter) >> 11) * (1.0 / 9007199254740992.0); }
+
+			// In [0, count)
+			int below(uint64_t counter, int count) const { return int(draw(counter) % uint64_t(count)); }
+
+		private:
+			uint64_t key;
+		};
+
+		enum Stream : uint64_t
+		{
+			NoiseStream = 1,
+			MazeStream,
+			RoomStream,
+			TerrainStream
+		};
+
+		struct Rect
+		{
+			int top, left, bottom, right;
+		};
+
+		// Rect covering the cells between a and b, both included
+		Rect span(int row0, int col0, int row1, int col1)
+		{
+			Rect rect = { std::min(row0, row1), std::min(col0, col1), std::max(row0, row1), std::max(col0, col1) };
+			return rect;
+		}
+
+		// Smooth step of Perlin's improved noise, flat at 0 and 1
+		double fade(double t)
+		{
+			return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
+		}
+
+		// The gradient of a lattice point of Perlin noise, one of 8
+		// directions picked by hash
+		const double* gradient(const CounterRng& rng, uint64_t octave, int64_t x, int64_t y)
+		{
+			static const double gradients[8][2] =
+			{
+				{ 1.0, 0.0 }, { -1.0, 0.0 }, { 0.0, 1.0 }, { 0.0, -1.0 },
+				{ 0.70710678, 0.70710678 }, { -0.70710678, 0.70710678 },
+				{ 0.70710678, -0.70710678 }, { -0.70710678, -0.70710678 }
+			};
+
+			const uint64_t counter = (octave << 56) ^ (uint64_t(uint32_t(x)) << 28) ^ uint64_t(uint32_t(y));
+			return gradients[rng.draw(counter) & 7];
+		}
+
+		// Adds one octave of Perlin gradient noise, about -1 to 1 times
+		// amplitude, to the values of a row of cells. Neighbouring cells
+		// share a lattice square, its gradients are only looked up when
+		// the row moves into the next one
+		void addNoiseRow(const CounterRng& rng, uint64_t octave, double frequency, double amplitude, int row, int cols, double* values)
+		{
+			const double y = row * frequency;
+			const double fy = std::floor(y);
+			const int64_t iy = int64_t(fy);
+			const double dy = y - fy, v = fade(dy);
+
+			int64_t square = INT64_MIN;
+			const double* g00 = nullptr;
+			const double* g10 = nullptr;
+			const double* g01 = nullptr;
+			const double* g11 = nullptr;
+
+			for (int col = 0; col < cols; col++)
+			{
+				const double x = col * frequency;
+				const double fx = std::floor(x);
+				const int64_t ix = int64_t(fx);
+
+				if (ix != square)
+				{
+					square = ix;
+					g00 = gradient(rng, octave, ix, iy);
+					g10 = gradient(rng, octave, ix + 1, iy);
+					g01 = gradient(rng, octave, ix, iy + 1);
+					g11 = gradient(rng, octave, ix + 1, iy + 1);
+				}
+
+				const double dx = x - fx, u = fade(dx);
+				const double n00 = g00[0] * dx + g00[1] * dy;
+				const double n10 = g10[0] * (dx - 1.0) + g10[1] * dy;
+				const double n01 = g01[0] * dx + g01[1] * (dy - 1.0);
+				const double n11 = g11[0] * (dx - 1.0) + g11[1] * (dy - 1.0);
+
+				const double top = n00 + u * (n10 - n00);
+				const double bottom = n01 + u * (n11 - n01);
+
+				// Unit gradients keep 2D Perlin noise within about +-0.71
+				values[col] += amplitude * 1.41421356 * (top + v * (bottom - top));
+			}
+		}
+	}
+
+	MapGenerator::MapGenerator(unsigned threadCount)
+		: pool(threadCount)
+	{
+	}
+
+	template <class Fill>
+	void MapGenerator::forEachRow(int rows, const Fill& fill)
+	{
+		const size_t count = size_t(std::max(rows, 0));
+		const size_t grain = count / (size_t(pool.threadCount()) * 8) + 1;
+
+		pool.parallelFor(count, grain, [&](size_t begin, size_t end, unsigned)
+		{
+			for (size_t row = begin; row < end; row++)
+				fill(int(row));
+		});
+	}
+
+	void MapGenerator::generate(int rows, int cols, const MapOptions& options, Grid& grid)
+	{
+		rows = std::max(rows, 0);
+		cols = std::max(cols, 0);
+		cells.resize(size_t(rows) * size_t(cols));
+
+		switch (options.type)
+		{
+		case MapType::Rooms:
+			generateRooms(rows, cols, options);
+			break;
+		case MapType::Maze:
+			generateMaze(rows, cols, options);
+			break;
+		case MapType::Terrain:
+			generateTerrain(rows, cols, options);
+			break;
+		case MapType::Noise:
+		default:
+			generateNoise(rows, cols, options);
+			break;
+		}
+
+		if (options.connected)
+			connectRegions(cells, cols);
+
+		grid.assign(cells.data(), rows, cols);
+	}
+
+	void MapGenerator::generateNoise(int rows, int cols, const MapOptions& options)
+	{
+		const CounterRng rng(options.seed, NoiseStream);
+
+		forEachRow(rows, [&](int row)
+		{
+			const size_t first = size_t(row) * size_t(cols);
+			for (size_t i = first; i < first + size_t(cols); i++)
+				cells[i] = rng.uniform(i) < options.obstacleDensity ? 0 : 1;
+		});
+	}
+
+	// Sidewinder: passage cells sit at odd rows and columns. Along each
+	// maze row runs of cells are joined eastwards, and each run is joined
+	// to the row above through one of its cells picked at random. A row
+	// only decides its own east walls and the walls above it, so maze
+	// rows are independent and are made in parallel. The top row is one
+	// long corridor
+	void MapGenerator::generateMaze(int rows, int cols, const MapOptions& options)
+	{
+		const CounterRng rng(options.seed, MazeStream);
+		const int mazeRows = std::max((rows - 1) / 2, 0);
+		const int mazeCols = std::max((cols - 1) / 2, 0);
+
+		std::fill(cells.begin(), cells.end(), uint8_t(0));
+
+		forEachRow(mazeRows, [&](int mazeRow)
+		{
+			uint8_t* passage = cells.data() + size_t(2 * mazeRow + 1) * size_t(cols);
+			uint8_t* above = passage - cols;
+			int runStart = 0;
+
+			for (int mazeCol = 0; mazeCol < mazeCols; mazeCol++)
+			{
+				const uint64_t counter = uint64_t(mazeRow) * uint64_t(mazeCols) + uint64_t(mazeCol);
+				passage[2 * mazeCol + 1] = 1;
+
+				const bool lastCol = mazeCol == mazeCols - 1;
+				const bool closeRun = lastCol || (mazeRow > 0 && (rng.draw(counter) & 1));
+
+				if (!closeRun)
+				{
+					passage[2 * mazeCol + 2] = 1;
+					continue;
+				}
+
+				if (mazeRow > 0)
+				{
+					const int chosen = runStart + rng.below(counter ^ (uint64_t(1) << 63), mazeCol - runStart + 1);
+					above[2 * chosen + 1] = 1;
+				}
+
+				runStart = mazeCol + 1;
+			}
+		});
+	}
+
+	// The map is cut into square slots a little larger than the largest
+	// room. Most slots get a room somewhere inside, and each room is
+	// joined by an L-shaped corridor to the next room along its slot row
+	// and to the room right below it, when there is one. The rooms and
+	// corridors are laid out first, as rectangles kept with the slot row
+	// they start in, then rows are filled in parallel: a rectangle never
+	// reaches past the slot row after its own
+	void MapGenerator::generateRooms(int rows, int cols, const MapOptions& options)
+	{
+		const CounterRng rng(options.seed, RoomStream);
+		const int minSize = std::max(options.minRoomSize, 1);
+		const int maxSize = std::max(options.maxRoomSize, minSize);
+		const int slot = maxSize + 3;
+
+		const int slotRows = std::max(rows / slot, 1);
+		const int slotCols = std::max(cols / slot, 1);
+
+		std::vector<Rect> rooms(size_t(slotRows) * size_t(slotCols));
+		std::vector<bool> present(rooms.size());
+
+		for (int sr = 0; sr < slotRows; sr++)
+		{
+			for (int sc = 0; sc < slotCols; sc++)
+			{
+				const size_t s = size_t(sr) * size_t(slotCols) + size_t(sc);
+				const uint64_t counter = uint64_t(s) * 8;
+
+				present[s] = rng.uniform(counter) < 0.8;
+
+				const int height = minSize + rng.below(counter + 1, maxSize - minSize + 1);
+				const int width = minSize + rng.below(counter + 2, maxSize - minSize + 1);
+				const int top = sr * slot + 1 + rng.below(counter + 3, slot - height - 1);
+				const int left = sc * slot + 1 + rng.below(counter + 4, slot - width - 1);
+
+				Rect room = { top, left, top + height - 1, left + width - 1 };
+				rooms[s] = room;
+			}
+		}
+
+		std::vector<std::vector<Rect>> bySlotRow(slotRows);
+
+		for (int sr = 0; sr < slotRows; sr++)
+		{
+			for (int sc = 0; sc < slotCols; sc++)
+			{
+				const size_t s = size_t(sr) * size_t(slotCols) + size_t(sc);
+				if (!present[s])
+					continue;
+
+				const Rect& room = rooms[s];
+				const int row = (room.top + room.bottom) / 2;
+				const int col = (room.left + room.right) / 2;
+				bySlotRow[sr].push_back(room);
+
+				auto corridorTo = [&](const Rect& other)
+				{
+					const int otherRow = (other.top + other.bottom) / 2;
+					const int otherCol = (other.left + other.right) / 2;
+					bySlotRow[sr].push_back(span(row, col, row, otherCol));
+					bySlotRow[sr].push_back(span(row, otherCol, otherRow, otherCol));
+				};
+
+				for (int next = sc + 1; next < slotCols; next++)
+				{
+					if (present[s + size_t(next - sc)])
+					{
+						corridorTo(rooms[s + size_t(next - sc)]);
+						break;
+					}
+				}
+
+				if (sr + 1 < slotRows && present[s + size_t(slotCols)])
+					corridorTo(rooms[s + size_t(slotCols)]);
+			}
+		}
+
+		forEachRow(rows, [&](int row)
+		{
+			uint8_t* line = cells.data() + size_t(row) * size_t(cols);
+			std::fill(line, line + cols, uint8_t(0));
+
+			const int sr = row / slot;
+			for (int group = std::max(sr - 1, 0); group <= std::min(sr, slotRows - 1); group++)
+			{
+				for (const Rect& rect : bySlotRow[group])
+				{
+					if (row < rect.top || row > rect.bottom || rect.left >= cols)
+						continue;
+
+					std::fill(line + rect.left, line + std::min(rect.right + 1, cols), uint8_t(1));
+				}
+			}
+		});
+	}
+
+	// Octaves of gradient noise, each at twice the frequency and half
+	// the amplitude of the one before
+	void MapGenerator::generateTerrain(int rows, int cols, const MapOptions& options)
+	{
+		const CounterRng rng(options.seed, TerrainStream);
+		const int octaves = std::max(options.octaves, 1);
+		const int maxCost = std::min(std::max(options.maxCost, 1), 255);
+		const double baseFrequency = 1.0 / std::max(options.featureSize, 1);
+
+		double amplitudes = 0.0;
+		for (int o = 0; o < octaves; o++)
+			amplitudes += std::ldexp(1.0, -o);
+
+		forEachRow(rows, [&](int row)
+		{
+			uint8_t* line = cells.data() + size_t(row) * size_t(cols);
+			std::vector<double> values(size_t(cols), 0.0);
+
+			for (int o = 0; o < octaves; o++)
+				addNoiseRow(rng, uint64_t(o), std::ldexp(baseFrequency, o), std::ldexp(1.0, -o), row, cols, values.data());
+
+			for (int col = 0; col < cols; col++)
+			{
+				const double value = std::max(-1.0, std::min(1.0, values[col] / amplitudes));
+
+				if (value < options.waterLevel)
+				{
+					line[col] = 0;
+					continue;
+				}
+
+				const int cost = 1 + int((value + 1.0) * 0.5 * maxCost);
+				line[col] = uint8_t(std::min(cost, maxCost));
+			}
+		});
+	}
+
+	size_t MapGenerator::connectRegions(Grid& grid)
+	{
+		std::vector<uint8_t> values(grid.data(), grid.data() + grid.size());
+		const size_t opened = connectRegions(values, grid.cols());
+
+		if (opened > 0)
+			grid.assign(values.data(), grid.rows(), grid.cols());
+
+		return opened;
+	}
+
+	// Labels the regions, then runs one breadth-first search over every
+	// cell, blocked or not, outwards from the largest region. The first
+	// time it steps onto a region not joined yet, the cells it crossed to
+	// get there are opened and the whole region joins the search
+	size_t MapGenerator::connectRegions(std::vector<uint8_t>& cells, int cols)
+	{
+		const size_t count = cells.size();
+		std::vector<uint32_t> label(count, none);
+		std::vector<size_t> regionSize;
+		std::vector<uint32_t> queue;
+		queue.reserve(count);
+
+		auto forNeighbours = [&](uint32_t cell, auto visit)
+		{
+			const uint32_t col = cell % uint32_t(cols);
+			if (cell >= uint32_t(cols)) visit(cell - uint32_t(cols));
+			if (cell + uint32_t(cols) < count) visit(cell + uint32_t(cols));
+			if (col > 0) visit(cell - 1);
+			if (col + 1 < uint32_t(cols)) visit(cell + 1);
+		};
+
+		for (uint32_t start = 0; start < count; start++)
+		{
+			if (cells[start] == 0 || label[start] != none)
+				continue;
+
+			const uint32_t region = uint32_t(regionSize.size());
+			label[start] = region;
+			queue.assign(1, start);
+
+			for (size_t head = 0; head < queue.size(); head++)
+			{
+				forNeighbours(queue[head], [&](uint32_t next)
+				{
+					if (cells[next] != 0 && label[next] == none)
+					{
+						label[next] = region;
+						queue.push_back(next);
+					}
+				});
+			}
+
+			regionSize.push_back(queue.size());
+		}
+
+		if (regionSize.size() <= 1)
+			return 0;
+
+		const uint32_t largest = uint32_t(std::max_element(regionSize.begin(), regionSize.end()) - regionSize.begin());
+		std::vector<bool> joined(regionSize.size(), false);
+		std::vector<uint32_t> parent(count, none);
+		size_t regionsLeft = regionSize.size();
+		size_t opened = 0;
+
+		queue.clear();
+
+		// Puts a whole region on the search queue
+		auto join = [&](uint32_t start)
+		{
+			const uint32_t region = label[start];
+			joined[region] = true;
+			regionsLeft--;
+
+			const size_t first = queue.size();
+			parent[start] = start;
+			queue.push_back(start);
+
+			for (size_t i = first; i < queue.size(); i++)
+			{
+				forNeighbours(queue[i], [&](uint32_t next)
+				{
+					if (label[next] == region && parent[next] == none)
+					{
+						parent[next] = next;
+						queue.push_back(next);
+					}
+				});
+			}
+		};
+
+		for (uint32_t cell = 0; cell < count; cell++)
+		{
+			if (label[cell] == largest)
+			{
+				join(cell);
+				break;
+			}
+		}
+
+		for (size_t head = 0; head < queue.size() && regionsLeft > 0; head++)
+		{
+			const uint32_t current = queue[head];
+
+			forNeighbours(current, [&](uint32_t next)
+			{
+				if (parent[next] != none)
+					return;
+
+				if (cells[next] == 0)
+				{
+					parent[next] = current;
+					queue.push_back(next);
+					return;
+				}
+
+				// A region not joined yet, open the way back to the joined ones
+				for (uint32_t cell = current; cells[cell] == 0; cell = parent[cell])
+				{
+					cells[cell] = 1;
+					opened++;
+				}
+
+				join(next);
+			});
+		}
+
+		return opened;
+	}
+}
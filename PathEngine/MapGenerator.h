@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Grid.h"
+#include "ThreadPool.h"
+
+namespace PathEngine
+{
+	enum class MapType
+	{
+		// Every cell blocked with the same chance
+		Noise,
+
+		// Rectangular rooms joined by corridors one cell wide, on walls
+		Rooms,
+
+		// A perfect maze: passages one cell wide between walls one cell
+		// thick, exactly one way between any two passage cells
+		Maze,
+
+		// Fractal Perlin noise turned into cell costs, see terrainCosts
+		// in SearchOptions. The lowest ground can be blocked as water
+		Terrain
+	};
+
+	struct MapOptions
+	{
+		MapType type = MapType::Noise;
+
+		// The same seed, size and options always make the same map,
+		// whatever the number of threads
+		uint64_t seed = 0;
+
+		// Noise: the chance of a cell being blocked
+		double obstacleDensity = 0.3;
+
+		// Rooms: the smallest and largest side of a room. Each room sits
+		// in a slot of its own, most slots get one
+		int minRoomSize = 4;
+		int maxRoomSize = 12;
+
+		// Terrain: cells per noise feature at the coarsest octave, the
+		// number of octaves added up and the highest cost (the lowest is
+		// 1). Noise runs from -1 to 1, cells below waterLevel are blocked
+		int featureSize = 32;
+		int octaves = 4;
+		int maxCost = 9;
+		double waterLevel = -1.0;
+
+		// Afterwards join every walkable region to the largest one, see
+		// MapGenerator::connectRegions
+		bool connected = false;
+	};
+
+	/*
+	 Makes maps for tests, stress runs and the window. Random numbers
+	 come from a hash of the seed and the position they are drawn for
+	 (a counter-based generator) rather than from a sequence, so rows
+	 are made in parallel on a pool of threads and every row comes out
+	 the same whichever thread makes it and in whatever order.
+	 Joining regions is one sequential pass over the map.*/
+	class MapGenerator
+	{
+	public:
+		// 0 threads means one per hardware thread
+		explicit MapGenerator(unsigned threadCount = 0);
+
+		unsigned threadCount() const { return pool.threadCount(); }
+
+		void generate(int rows, int cols, const MapOptions& options, Grid& grid);
+
+		// Opens the shortest corridors it can find between each walkable
+		// region (4-connected) and the largest one, until every walkable
+		// cell can reach every other. Opened cells cost 1. Returns the
+		// number of cells opened
+		static size_t connectRegions(Grid& grid);
+
+	private:
+		void generateNoise(int rows, int cols, const MapOptions& options);
+		void generateRooms(int rows, int cols, const MapOptions& options);
+		void generateMaze(int rows, int cols, const MapOptions& options);
+		void generateTerrain(int rows, int cols, const MapOptions& options);
+
+		static size_t connectRegions(std::vector<uint8_t>& cells, int cols);
+
+		// Calls fill(row) for every row in [0, rows) on the pool
+		template <class Fill>
+		void forEachRow(int rows, const Fill& fill);
+
+		ThreadPool pool;
+		std::vector<uint8_t> cells;
+	};
+}
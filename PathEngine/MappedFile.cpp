@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PathEngine
+{
+#ifdef _WIN32
+	MappedFile::MappedFile()
+		: bytes(nullptr), length(0), writable(false), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+	{
+	}
+#else
+	MappedFile::MappedFile()
+		: bytes(nullptr), length(0), writable(false)
+	{
+	}
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path, bool copyOnWrite)
+	{
+		close();
+
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+
+		mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			close();
+			return false;
+		}
+
+		bytes = static_cast<uint8_t*>(MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+		if (bytes == nullptr)
+		{
+			close();
+			return false;
+		}
+
+		length = size_t(fileSize.QuadPart);
+		writable = copyOnWrite;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (bytes != nullptr)
+			UnmapViewOfFile(bytes);
+
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+
+		bytes = nullptr;
+		length = 0;
+		writable = false;
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	bool MappedFile::open(const std::string& path, bool copyOnWrite)
+	{
+		close();
+
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		// The mapping keeps the file alive, the descriptor is not needed
+		void* view = mmap(nullptr, size_t(info.st_size), copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (view == MAP_FAILED)
+			return false;
+
+		bytes = static_cast<uint8_t*>(view);
+		length = size_t(info.st_size);
+		writable = copyOnWrite;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (bytes != nullptr)
+			munmap(bytes, length);
+
+		bytes = nullptr;
+		length = 0;
+		writable = false;
+	}
+#endif
+}
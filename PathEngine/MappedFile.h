@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace PathEngine
+{
+	/*
+	 A read-only view of a whole file mapped into memory. Pages are only
+	 read from disk when they are first touched, and processes mapping
+	 the same file share them, so opening a large table is immediate no
+	 matter its size. The view stays valid until close or destruction.
+	 A copy-on-write view can also be written to: a page is copied the
+	 first time it changes and the file itself never does.*/
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Maps the file, false if it can not be opened or is empty
+		bool open(const std::string& path, bool copyOnWrite = false);
+		void close();
+
+		bool isOpen() const { return bytes != nullptr; }
+		const uint8_t* data() const { return bytes; }
+		size_t size() const { return length; }
+
+		// The view to write to, nullptr unless opened copy-on-write
+		uint8_t* writableData() const { return writable ? bytes : nullptr; }
+
+	private:
+		uint8_t* bytes;
+		size_t length;
+		bool writable;
+
+#ifdef _WIN32
+		void* file;
+		void* mapping;
+#endif
+	};
+}
@@ -0,0 +1,119 @@
+#include "MovingAI.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace PathEngine
+{
+	namespace
+	{
+		// Reads one line, without the '\r' of files written on Windows
+		bool readLine(std::istream& in, std::string& line)
+		{
+			if (!std::getline(in, line))
+				return false;
+
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			return true;
+		}
+
+		uint8_t terrainValue(char c)
+		{
+			return (c == '.' || c == 'G' || c == 'S') ? 1 : 0;
+		}
+	}
+
+	bool importMovingAIMap(const std::string& path, Grid& grid)
+	{
+		std::ifstream in(path);
+		if (!in)
+			return false;
+
+		// The header is a few "key value" lines ending with "map"
+		int rows = -1, cols = -1;
+		std::string line;
+
+		for (;;)
+		{
+			if (!readLine(in, line))
+				return false;
+
+			std::istringstream fields(line);
+			std::string key;
+			fields >> key;
+
+			if (key == "map")
+				break;
+
+			if (key == "height")
+				fields >> rows;
+			else if (key == "width")
+				fields >> cols;
+		}
+
+		if (rows <= 0 || cols <= 0)
+			return false;
+
+		std::vector<uint8_t> cells(size_t(rows) * size_t(cols));
+
+		for (int row = 0; row < rows; row++)
+		{
+			if (!readLine(in, line) || line.size() < size_t(cols))
+				return false;
+
+			uint8_t* target = cells.data() + size_t(row) * size_t(cols);
+			for (int col = 0; col < cols; col++)
+				target[col] = terrainValue(line[col]);
+		}
+
+		grid.assign(cells.data(), rows, cols);
+		return true;
+	}
+
+	bool loadMovingAIScenarios(const std::string& path, std::vector<MovingAIScenario>& scenarios)
+	{
+		std::ifstream in(path);
+		std::string line;
+
+		if (!in || !readLine(in, line) || line.compare(0, 7, "version") != 0)
+			return false;
+
+		while (readLine(in, line))
+		{
+			if (line.find_first_not_of(" \t") == std::string::npos)
+				continue;
+
+			// Fields are separated by tabs, map names may hold spaces
+			std::vector<std::string> fields;
+			size_t start = 0;
+
+			for (;;)
+			{
+				const size_t end = line.find('\t', start);
+				fields.push_back(line.substr(start, end - start));
+				if (end == std::string::npos)
+					break;
+				start = end + 1;
+			}
+
+			if (fields.size() < 9)
+				return false;
+
+			MovingAIScenario scenario;
+			scenario.map = fields[1];
+
+			std::istringstream numbers(fields[0] + ' ' + fields[2] + ' ' + fields[3] + ' ' + fields[4] + ' ' + fields[5] + ' ' + fields[6] + ' ' + fields[7] + ' ' + fields[8]);
+			numbers >> scenario.bucket >> scenario.mapWidth >> scenario.mapHeight >> scenario.src.second >> scenario.src.first >> scenario.dest.second >> scenario.dest.first >> scenario.optimalLength;
+
+			if (!numbers)
+				return false;
+
+			scenarios.push_back(scenario);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Grid.h"
+
+namespace PathEngine
+{
+	/*
+	 Maps of the MovingAI grid benchmark sets (movingai.com/benchmarks),
+	 plain text in the form
+	   type octile
+	   height <rows>
+	   width <cols>
+	   map
+	   <rows lines of cols characters>
+	 '.', 'G' and 'S' (swamp) are walkable and cost 1; '@', 'O', 'T'
+	 (trees) and 'W' (water) are blocked. Save the grid with Grid::save
+	 to load it again without parsing.
+	 A scenario file (.scen) lists queries on such maps, one per line
+	 after a "version 1" line:
+	   bucket  map  width  height  start x  start y  goal x  goal y  optimal length
+	 x is the column and y the row. The optimal length is for 8-connected
+	 moves at octile cost that do not cut corners, the moves of a search
+	 with allowDiagonal set.*/
+
+	struct MovingAIScenario
+	{
+		// Queries are grouped in buckets of similar length
+		int bucket = 0;
+
+		// The map file as named in the scenario, usually relative to it
+		std::string map;
+		int mapWidth = 0;
+		int mapHeight = 0;
+
+		Pair src;
+		Pair dest;
+		double optimalLength = 0.0;
+	};
+
+	// Replaces grid with the map, false if the file can not be read or
+	// is not a map. grid is left as it was then
+	bool importMovingAIMap(const std::string& path, Grid& grid);
+
+	// Appends the queries of a scenario file, false if it can not be read
+	// or a line can not be parsed
+	bool loadMovingAIScenarios(const std::string& path, std::vector<MovingAIScenario>& scenarios);
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace PathEngine
+{
+	/*
+	 The open lists the search can run on. They all share the same
+	 small interface so the search loop is written once:
+	   reserve(cells)     make room for cell indices [0, cells)
+	   clear()            forget every entry
+	   empty(), size()
+	   push(index, key)   insert a cell, or lower the key of a cell that
+	                      is already on the list
+	   pop()              remove and return the cell with the lowest key
+	 Lists without a real decrease-key (Set, Bucket) keep the old entry
+	 around, so the search has to skip cells that are already closed.*/
+	enum class OpenListType
+	{
+		DaryHeap,
+		Bucket,
+		Set
+	};
+
+	// An indexed d-ary min-heap. Each cell remembers where it lives in
+	// the heap, so lowering its key is a sift-up instead of a second entry.
+	// Key only needs operator<, incremental searches key on pairs
+	template <unsigned D = 4, class Key = double>
+	class IndexedDaryHeap
+	{
+		static_assert(D >= 2, "A heap needs at least two children per node");
+
+	public:
+		void reserve(size_t cellCount)
+		{
+			if (position.size() < cellCount)
+				position.resize(cellCount);
+		}
+
+		void clear() { heap.clear(); }
+		bool empty() const { return heap.empty(); }
+		size_t size() const { return heap.size(); }
+
+		// The position table is never cleared, an index is only on the
+		// heap if the slot it points at points back at it
+		bool contains(uint32_t index) const
+		{
+			uint32_t at = position[index];
+			return at < heap.size() && heap[at].index == index;
+		}
+
+		void push(uint32_t index, Key key)
+		{
+			if (contains(index))
+			{
+				decreaseKey(index, key);
+				return;
+			}
+
+			heap.push_back(Entry{ key, index });
+			siftUp(heap.size() - 1);
+		}
+
+		void decreaseKey(uint32_t index, Key key)
+		{
+			size_t at = position[index];
+			if (key < heap[at].key)
+			{
+				heap[at].key = key;
+				siftUp(at);
+			}
+		}
+
+		// Moves a cell that is on the heap to a higher or lower key
+		void update(uint32_t index, Key key)
+		{
+			size_t at = position[index];
+			bool lower = key < heap[at].key;
+			heap[at].key = key;
+
+			if (lower)
+				siftUp(at);
+			else
+				siftDown(at);
+		}
+
+		// Takes a cell that is on the heap off it
+		void remove(uint32_t index)
+		{
+			size_t at = position[index];
+			Entry last = heap.back();
+			heap.pop_back();
+
+			if (at == heap.size())
+				return;
+
+			bool lower = last.key < heap[at].key;
+			heap[at] = last;
+			position[last.index] = uint32_t(at);
+
+			if (lower)
+				siftUp(at);
+			else
+				siftDown(at);
+		}
+
+		Key topKey() const { return heap.front().key; }
+		uint32_t top() const { return heap.front().index; }
+
+		uint32_t pop()
+		{
+			uint32_t top = heap.front().index;
+			heap.front() = heap.back();
+			heap.pop_back();
+
+			if (!heap.empty())
+				siftDown(0);
+
+			return top;
+		}
+
+	private:
+		struct Entry
+		{
+			Key key;
+			uint32_t index;
+		};
+
+		void siftUp(size_t at)
+		{
+			Entry entry = heap[at];
+
+			while (at > 0)
+			{
+				size_t parent = (at - 1) / D;
+				if (!(entry.key < heap[parent].key))
+					break;
+
+				heap[at] = heap[parent];
+				position[heap[at].index] = uint32_t(at);
+				at = parent;
+			}
+
+			heap[at] = entry;
+			position[entry.index] = uint32_t(at);
+		}
+
+		void siftDown(size_t at)
+		{
+			Entry entry = heap[at];
+			const size_t count = heap.size();
+
+			for (;;)
+			{
+				size_t first = at * D + 1;
+				if (first >= count)
+					break;
+
+				// Find the smallest of the (up to) D children
+				size_t last = first + D < count ? first + D : count;
+				size_t best = first;
+				for (size_t child = first + 1; child < last; child++)
+				{
+					if (heap[child].key < heap[best].key)
+						best = child;
+				}
+
+				if (!(heap[best].key < entry.key))
+					break;
+
+				heap[at] = heap[best];
+				position[heap[at].index] = uint32_t(at);
+				at = best;
+			}
+
+			heap[at] = entry;
+			position[entry.index] = uint32_t(at);
+		}
+
+		std::vector<Entry> heap;
+		std::vector<uint32_t> position;
+	};
+
+	// A bucket queue for integral keys, one bucket per key value. With a
+	// consistent heuristic A* pops keys in non-decreasing order, so the
+	// lowest non-empty bucket is found by moving a cursor forward.
+	// Buckets are LIFO, which breaks ties in favour of the deepest node.
+	// The buckets form a ring indexed by key modulo its size, which only
+	// has to cover the keys on the list at once: about the largest step
+	// plus what the heuristic changes by on it, not the cost of the path.
+	// The ring grows when a key falls outside it; searches whose steps
+	// span more than MaxSpread keys use the heap instead
+	class BucketQueue
+	{
+	public:
+		static constexpr size_t MaxSpread = size_t(1) << 16;
+
+		BucketQueue() : cursor(0), highest(0), count(0) {}
+
+		void reserve(size_t) {}
+
+		void clear()
+		{
+			// Only the buckets the last query used can hold anything
+			if (count > 0)
+			{
+				for (size_t key = cursor; key <= highest; key++)
+					buckets[key & mask()].clear();
+			}
+
+			cursor = 0;
+			highest = 0;
+			count = 0;
+		}
+
+		bool empty() const { return count == 0; }
+		size_t size() const { return count; }
+
+		void push(uint32_t index, double key)
+		{
+			size_t bucket = size_t(std::lround(key));
+
+			if (count == 0)
+			{
+				cursor = bucket;
+				highest = bucket;
+			}
+
+			// Only an inconsistent heuristic can go below the cursor,
+			// but it is cheap to stay correct
+			const size_t low = bucket < cursor ? bucket : cursor;
+			const size_t high = bucket > highest ? bucket : highest;
+
+			if (high - low >= buckets.size())
+				grow(high - low + 1);
+
+			cursor = low;
+			highest = high;
+
+			buckets[bucket & mask()].push_back(index);
+			count++;
+		}
+
+		uint32_t pop()
+		{
+			while (buckets[cursor & mask()].empty())
+				cursor++;
+
+			std::vector<uint32_t>& bucket = buckets[cursor & mask()];
+			uint32_t top = bucket.back();
+			bucket.pop_back();
+			count--;
+			return top;
+		}
+
+	private:
+		size_t mask() const { return buckets.size() - 1; }
+
+		// Moves the live buckets into a ring of at least span, a power of
+		// two so a key finds its bucket with a mask
+		void grow(size_t span)
+		{
+			size_t size = buckets.empty() ? 64 : buckets.size();
+			while (size < span)
+				size *= 2;
+
+			std::vector<std::vector<uint32_t>> ring(size);
+			if (count > 0)
+			{
+				for (size_t key = cursor; key <= highest; key++)
+					ring[key & (size - 1)].swap(buckets[key & mask()]);
+			}
+
+			buckets.swap(ring);
+		}
+
+		std::vector<std::vector<uint32_t>> buckets;
+
+		// The lowest and highest key that can be on the list
+		size_t cursor;
+		size_t highest;
+		size_t count;
+	};
+
+	// The original open list: a red-black tree of <f, cell> pairs where
+	// an improved cell is inserted again next to its stale entry.
+	// Kept for comparison in the benchmarks
+	class SetOpenList
+	{
+	public:
+		void reserve(size_t) {}
+		void clear() { openList.clear(); }
+		bool empty() const { return openList.empty(); }
+		size_t size() const { return openList.size(); }
+
+		void push(uint32_t index, double key)
+		{
+			openList.insert(std::make_pair(key, index));
+		}
+
+		uint32_t pop()
+		{
+			uint32_t top = openList.begin()->second;
+			openList.erase(openList.begin());
+			return top;
+		}
+
+	private:
+		std::set<std::pair<double, uint32_t>> openList;
+	};
+}
@@ -0,0 +1,428 @@
+#include "PathCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+
+namespace PathEngine
+{
+	namespace
+	{
+		// About the memory of one entry of the index: the node of the
+		// multimap and its share of the buckets
+		const size_t postingBytes = sizeof(std::pair<const uint32_t, uint64_t>) + 2 * sizeof(void*);
+
+		bool diagonalStep(Pair from, Pair to)
+		{
+			return from.first != to.first && from.second != to.second;
+		}
+	}
+
+	const uint32_t PathCache::Corner;
+
+	PathCache::PathCache(const SearchOptions& options, size_t maxBytes)
+		: options(options), maxBytes(maxBytes), gridVersion(0), clockHand(0), pathCount(0), usedBytes(0),
+		  hitCount(0), subpathHitCount(0), missCount(0), invalidatedCount(0), evictedCount(0)
+	{
+		// The cache hands out whole paths of its own
+		this->options.pathFormat = PathFormat::Cells;
+		this->options.pathBuffer = nullptr;
+
+		// Off terrain Jump Point Search moves like this whatever the
+		// options say, and paths are measured by the moves
+		if (options.mode == SearchMode::JumpPoint && !options.terrainCosts)
+		{
+			this->options.allowDiagonal = true;
+			this->options.moveCost = MoveCostType::Octile;
+		}
+	}
+
+	PathCache::~PathCache()
+	{
+	}
+
+	bool PathCache::cached() const
+	{
+		return options.mode != SearchMode::ThetaStar && options.mode != SearchMode::LazyThetaStar;
+	}
+
+	bool PathCache::shortest() const
+	{
+		return options.heuristicWeight <= 1.0;
+	}
+
+	SearchResult PathCache::search(const Grid& grid, Pair src, Pair dest, SearchContext& context)
+	{
+		SearchResult result;
+		if (find(grid, src, dest, result))
+			return result;
+
+		result = aStarSearch(grid, src, dest, options, context);
+		insert(grid, result);
+		return result;
+	}
+
+	bool PathCache::find(const Grid& grid, Pair src, Pair dest, SearchResult& result)
+	{
+		if (!cached())
+			return false;
+
+		std::shared_lock<std::shared_mutex> reading(lock);
+
+		uint32_t entry = 0;
+		size_t first = 0, last = 0;
+
+		if (gridVersion != grid.version() || !locate(grid, src, dest, entry, first, last))
+		{
+			missCount.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		Entry& found = *entries[entry];
+		found.referenced.store(true, std::memory_order_relaxed);
+
+		result = SearchResult();
+		result.status = SearchStatus::Found;
+
+		if (first < last)
+		{
+			result.path.assign(found.path.begin() + first, found.path.begin() + last + 1);
+		}
+		else
+		{
+			result.path.assign(found.path.rbegin() + (found.path.size() - 1 - first), found.path.rbegin() + (found.path.size() - last));
+		}
+
+		const bool whole = std::min(first, last) == 0 && std::max(first, last) == found.path.size() - 1;
+		result.cost = whole && first == 0 ? found.cost : costOf(grid, found.path, first, last);
+
+		(whole ? hitCount : subpathHitCount).fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool PathCache::locate(const Grid& grid, Pair src, Pair dest, uint32_t& entry, size_t& first, size_t& last) const
+	{
+		if (src == dest || !grid.isValid(src.first, src.second) || !grid.isValid(dest.first, dest.second))
+			return false;
+
+		const auto sources = postings.equal_range(grid.index(src.first, src.second));
+		if (sources.first == sources.second)
+			return false;
+
+		const auto dests = postings.equal_range(grid.index(dest.first, dest.second));
+
+		// Backwards is as short only when a step costs the same both ways
+		const bool reversible = shortest() && !options.terrainCosts;
+
+		for (auto from = sources.first; from != sources.second; ++from)
+		{
+			if (from->second.position == Corner)
+				continue;
+
+			for (auto to = dests.first; to != dests.second; ++to)
+			{
+				if (to->second.entry != from->second.entry || to->second.position == Corner)
+					continue;
+
+				const size_t a = from->second.position, b = to->second.position;
+				const size_t end = entries[from->second.entry]->path.size() - 1;
+
+				const bool usable = shortest() ? (a < b || reversible)
+					: (a == 0 && b == end) || (reversible && a == end && b == 0);
+
+				if (usable)
+				{
+					entry = from->second.entry;
+					first = a;
+					last = b;
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	// Summed step by step from the start, as the search sums g, so that a
+	// path cost the same whether it was searched or cut from another
+	double PathCache::costOf(const Grid& grid, const std::vector<Pair>& path, size_t first, size_t last) const
+	{
+		const bool octile = options.allowDiagonal && options.moveCost == MoveCostType::Octile;
+		const int step = first < last ? 1 : -1;
+
+		if (options.terrainCosts)
+		{
+			const uint64_t straight = octile ? uint64_t(TerrainOctileMoves::straight) : 1;
+			const uint64_t diagonal = octile ? uint64_t(TerrainOctileMoves::diagonal) : 1;
+			uint64_t sum = 0;
+
+			for (size_t i = first; i != last; i += step)
+			{
+				const Pair to = path[i + step];
+				sum += (diagonalStep(path[i], to) ? diagonal : straight) * grid.get(to.first, to.second);
+			}
+
+			return double(sum) / (octile ? TerrainOctileMoves::scale : 1.0);
+		}
+
+		double sum = 0.0;
+		for (size_t i = first; i != last; i += step)
+			sum += diagonalStep(path[i], path[i + step]) && octile ? sqrt2 : 1.0;
+
+		return sum;
+	}
+
+	double PathCache::lowerBound(const Grid& grid, Pair a, Pair b) const
+	{
+		double distance;
+
+		if (!options.allowDiagonal)
+			distance = ManhattanHValue()(a.first, a.second, b);
+		else if (options.moveCost == MoveCostType::Octile)
+			distance = OctileHValue()(a.first, a.second, b);
+		else
+			distance = ChebyshevHValue()(a.first, a.second, b);
+
+		return options.terrainCosts ? distance * grid.minCost() : distance;
+	}
+
+	size_t PathCache::entryBytes(const Entry& entry) const
+	{
+		size_t corners = 0;
+		for (size_t i = 1; i < entry.path.size(); i++)
+			corners += diagonalStep(entry.path[i - 1], entry.path[i]) ? 2 : 0;
+
+		return sizeof(Entry) + entry.path.size() * sizeof(Pair) + (entry.path.size() + corners) * postingBytes;
+	}
+
+	void PathCache::insert(const Grid& grid, const SearchResult& result)
+	{
+		if (!cached() || !result.found() || result.path.size() < 2)
+			return;
+
+		std::unique_lock<std::shared_mutex> writing(lock);
+
+		// The grid changed without update, nothing cached can be trusted
+		if (gridVersion != grid.version())
+		{
+			removeAll();
+			gridVersion = grid.version();
+		}
+
+		// Already answered by a path in the cache
+		uint32_t covering = 0;
+		size_t first = 0, last = 0;
+		if (locate(grid, result.path.front(), result.path.back(), covering, first, last))
+			return;
+
+		std::unique_ptr<Entry> added(new Entry);
+		added->path = result.path;
+		added->cost = result.cost;
+
+		const size_t bytes = entryBytes(*added);
+		if (bytes > maxBytes)
+			return;
+
+		while (usedBytes + bytes > maxBytes && evictOne(grid))
+		{
+		}
+
+		uint32_t entry;
+		if (!freeEntries.empty())
+		{
+			entry = freeEntries.back();
+			freeEntries.pop_back();
+			entries[entry] = std::move(added);
+		}
+		else
+		{
+			entry = uint32_t(entries.size());
+			entries.push_back(std::move(added));
+		}
+
+		const std::vector<Pair>& path = entries[entry]->path;
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			postings.emplace(grid.index(path[i].first, path[i].second), Posting{ entry, uint32_t(i) });
+
+			if (i > 0 && diagonalStep(path[i - 1], path[i]))
+			{
+				postings.emplace(grid.index(path[i - 1].first, path[i].second), Posting{ entry, Corner });
+				postings.emplace(grid.index(path[i].first, path[i - 1].second), Posting{ entry, Corner });
+			}
+		}
+
+		usedBytes += bytes;
+		pathCount++;
+	}
+
+	void PathCache::remove(const Grid& grid, uint32_t entry)
+	{
+		const std::vector<Pair>& path = entries[entry]->path;
+
+		auto unindex = [&](int row, int col)
+		{
+			const auto range = postings.equal_range(grid.index(row, col));
+			for (auto it = range.first; it != range.second;)
+			{
+				if (it->second.entry == entry)
+					it = postings.erase(it);
+				else
+					++it;
+			}
+		};
+
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			unindex(path[i].first, path[i].second);
+
+			if (i > 0 && diagonalStep(path[i - 1], path[i]))
+			{
+				unindex(path[i - 1].first, path[i].second);
+				unindex(path[i].first, path[i - 1].second);
+			}
+		}
+
+		usedBytes -= entryBytes(*entries[entry]);
+		pathCount--;
+
+		entries[entry].reset();
+		freeEntries.push_back(entry);
+	}
+
+	void PathCache::removeAll()
+	{
+		invalidatedCount.fetch_add(pathCount, std::memory_order_relaxed);
+
+		entries.clear();
+		freeEntries.clear();
+		postings.clear();
+		clockHand = 0;
+		pathCount = 0;
+		usedBytes = 0;
+	}
+
+	// The clock hand sweeps the entries, giving each used since it last
+	// passed another round, and drops the first that was not
+	bool PathCache::evictOne(const Grid& grid)
+	{
+		if (pathCount == 0)
+			return false;
+
+		for (;;)
+		{
+			if (clockHand >= entries.size())
+				clockHand = 0;
+
+			Entry* entry = entries[clockHand].get();
+			if (entry != nullptr && !entry->referenced.exchange(false, std::memory_order_relaxed))
+			{
+				remove(grid, uint32_t(clockHand));
+				evictedCount.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+
+			clockHand++;
+		}
+	}
+
+	void PathCache::update(const Grid& grid, int row, int col)
+	{
+		std::unique_lock<std::shared_mutex> writing(lock);
+
+		if (pathCount == 0 || gridVersion != grid.previousVersion())
+		{
+			removeAll();
+			gridVersion = grid.version();
+			return;
+		}
+
+		gridVersion = grid.version();
+
+		const bool walkable = grid.isUnBlocked(row, col);
+		const bool terrain = options.terrainCosts;
+		const Pair cell(row, col);
+
+		std::vector<uint32_t> affected;
+		bool onAPath = false;
+
+		// Blocked, the paths through it or around its corner are gone. On
+		// terrain a cost changed on a path changes the cost of the path
+		const auto range = postings.equal_range(grid.index(row, col));
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			onAPath = true;
+			if (!walkable || (terrain && it->second.position != Corner))
+				affected.push_back(it->second.entry);
+		}
+
+		// Open, or maybe cheaper, it could be on a shorter way between the
+		// ends of a path. Without terrain a cell a path runs through or
+		// beside was open already, and nothing changed
+		if (walkable && (terrain || !onAPath))
+		{
+			const double weight = std::max(options.heuristicWeight, 1.0);
+
+			// Opened, it also lets diagonal steps between its neighbours
+			// past its corners, so a shorter way may only pass beside it
+			std::vector<Pair> via(1, cell);
+			if (options.allowDiagonal)
+			{
+				for (int dr = -1; dr <= 1; dr++)
+				{
+					for (int dc = -1; dc <= 1; dc++)
+					{
+						if ((dr != 0 || dc != 0) && grid.isValid(row + dr, col + dc) && grid.isUnBlocked(row + dr, col + dc))
+							via.push_back(Pair(row + dr, col + dc));
+					}
+				}
+			}
+
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				const Entry* entry = entries[i].get();
+				if (entry == nullptr)
+					continue;
+
+				for (const Pair& through : via)
+				{
+					if (lowerBound(grid, entry->path.front(), through) + lowerBound(grid, through, entry->path.back()) < entry->cost / weight)
+					{
+						affected.push_back(uint32_t(i));
+						break;
+					}
+				}
+			}
+		}
+
+		std::sort(affected.begin(), affected.end());
+		affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+		for (uint32_t entry : affected)
+			remove(grid, entry);
+
+		invalidatedCount.fetch_add(affected.size(), std::memory_order_relaxed);
+	}
+
+	void PathCache::clear()
+	{
+		std::unique_lock<std::shared_mutex> writing(lock);
+		removeAll();
+	}
+
+	PathCacheStats PathCache::stats() const
+	{
+		PathCacheStats stats;
+		stats.hits = hitCount.load(std::memory_order_relaxed);
+		stats.subpathHits = subpathHitCount.load(std::memory_order_relaxed);
+		stats.misses = missCount.load(std::memory_order_relaxed);
+		stats.invalidated = invalidatedCount.load(std::memory_order_relaxed);
+		stats.evicted = evictedCount.load(std::memory_order_relaxed);
+
+		std::shared_lock<std::shared_mutex> reading(lock);
+		stats.paths = pathCount;
+		stats.bytes = usedBytes;
+		return stats;
+	}
+}
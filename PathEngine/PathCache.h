@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "AStarSearch.h"
+
+namespace PathEngine
+{
+	// What a PathCache has been asked and what it holds
+	struct PathCacheStats
+	{
+		// Queries answered by a cached path from end to end, by a part of
+		// a longer one, and by searching
+		size_t hits = 0;
+		size_t subpathHits = 0;
+		size_t misses = 0;
+
+		// Paths dropped because a change to the grid could make them
+		// wrong or no longer the shortest, or by clear, and to make room
+		size_t invalidated = 0;
+		size_t evicted = 0;
+
+		size_t paths = 0;
+
+		// About the memory the paths and the index of their cells take
+		size_t bytes = 0;
+
+		double hitRate() const
+		{
+			const size_t queries = hits + subpathHits + misses;
+			return queries > 0 ? double(hits + subpathHits) / double(queries) : 0.0;
+		}
+	};
+
+	/*
+	 Paths found before, to answer queries that come back without
+	 searching. Every part of a shortest path is a shortest path too, so
+	 a query is answered from any cached path that passes through its
+	 source and then its destination, and without terrain costs, where a
+	 path is as short backwards, through its destination and then its
+	 source. A cache serves one grid with one SearchOptions and keeps
+	 about maxBytes of paths, dropping the ones not used lately (the
+	 clock algorithm) to make room.
+	 update drops every path a change to the grid could affect, and
+	 some it does not: a cell blocked on a path or at the corner of one
+	 of its diagonal steps, a cost changed on a path, or a cell opened or
+	 made cheaper close enough to a path, by the heuristic of the moves,
+	 that a way through it or, with diagonal moves, through one of the
+	 cells around it could be shorter. Any number of threads can look up
+	 paths at once; adding and dropping them takes the lock alone.
+	 With a heuristicWeight above 1 paths are not the shortest, and only
+	 a query repeated end to end is answered. The any-angle searches are
+	 not cached.*/
+	class PathCache
+	{
+	public:
+		PathCache(const SearchOptions& options, size_t maxBytes);
+		~PathCache();
+
+		PathCache(const PathCache&) = delete;
+		PathCache& operator=(const PathCache&) = delete;
+
+		// Answers the query from the cache, or runs aStarSearch with the
+		// options of the cache and adds the path found. The path is always
+		// in SearchResult::path, every cell of it
+		SearchResult search(const Grid& grid, Pair src, Pair dest, SearchContext& context);
+
+		// The cached path from src to dest, false when there is none
+		bool find(const Grid& grid, Pair src, Pair dest, SearchResult& result);
+
+		// Adds the path of a query found with the options of the cache
+		void insert(const Grid& grid, const SearchResult& result);
+
+		// Call after every grid.set, with the cell that was set. Without
+		// it the grid's version no longer matches and every path is
+		// dropped on the next insert
+		void update(const Grid& grid, int row, int col);
+
+		void clear();
+
+		PathCacheStats stats() const;
+
+	private:
+		// A path's cell, or a cell at the corner of one of its diagonal
+		// steps, which does not count as on the path
+		struct Posting
+		{
+			uint32_t entry;
+			uint32_t position;
+		};
+
+		static const uint32_t Corner = 0xFFFFFFFF;
+
+		struct Entry
+		{
+			std::vector<Pair> path;
+			double cost = 0.0;
+
+			// Set on every use, cleared as the clock hand passes by
+			std::atomic<bool> referenced{ false };
+		};
+
+		// Whether the search can be cached and its paths cut into parts
+		bool cached() const;
+		bool shortest() const;
+
+		// The functions below expect the lock held, to write for the ones
+		// that change the cache
+
+		// A cached path through src and then dest, and where on it they are
+		bool locate(const Grid& grid, Pair src, Pair dest, uint32_t& entry, size_t& first, size_t& last) const;
+
+		// The cost of the path from cell first to cell last of it, which
+		// may come before first
+		double costOf(const Grid& grid, const std::vector<Pair>& path, size_t first, size_t last) const;
+
+		// The heuristic of the moves from a to b, times the cheapest cost
+		// of a cell on terrain: no way from a to b is shorter
+		double lowerBound(const Grid& grid, Pair a, Pair b) const;
+
+		size_t entryBytes(const Entry& entry) const;
+		void remove(const Grid& grid, uint32_t entry);
+		void removeAll();
+		bool evictOne(const Grid& grid);
+
+		SearchOptions options;
+		size_t maxBytes;
+
+		mutable std::shared_mutex lock;
+
+		uint64_t gridVersion;
+		std::vector<std::unique_ptr<Entry>> entries;
+		std::vector<uint32_t> freeEntries;
+		std::unordered_multimap<uint32_t, Posting> postings;
+		size_t clockHand;
+		size_t pathCount;
+		size_t usedBytes;
+
+		std::atomic<size_t> hitCount;
+		std::atomic<size_t> subpathHitCount;
+		std::atomic<size_t> missCount;
+		std::atomic<size_t> invalidatedCount;
+		std::atomic<size_t> evictedCount;
+	};
+}
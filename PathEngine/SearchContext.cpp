@@ -0,0 +1,57 @@
+#include "SearchContext.h"
+
+namespace PathEngine
+{
+	SearchContext::SearchContext()
+		: generation(0), touched(0), claimCount(0)
+	{
+	}
+
+	void SearchContext::beginQuery(size_t cellCount)
+	{
+		// New cells are stamped with generation 0, which no query uses
+		if (nodes.size() < cellCount)
+			nodes.resize(cellCount, Node{ DBL_MAX, 0, 0 });
+
+		// Only once every billion queries do the stamps have to be wiped
+		if (generation == MaxGeneration)
+		{
+			for (Node& n : nodes)
+				n.stamp = 0;
+
+			for (size_t i = 0; i < claimCount; i++)
+				claims[i].store(0);
+
+			generation = 0;
+		}
+
+		generation++;
+		touched = 0;
+
+		heapList.clear();
+		heapList.reserve(cellCount);
+		bucketList.clear();
+		setList.clear();
+	}
+
+	SearchContext& SearchContext::reverse()
+	{
+		if (!reverseContext)
+			reverseContext.reset(new SearchContext);
+
+		return *reverseContext;
+	}
+
+	void SearchContext::prepareClaims()
+	{
+		if (claimCount >= nodes.size())
+			return;
+
+		// Generation 0 is never a current one, so 0 means unclaimed
+		claims.reset(new std::atomic<uint32_t>[nodes.size()]);
+		claimCount = nodes.size();
+
+		for (size_t i = 0; i < claimCount; i++)
+			claims[i].store(0, std::memory_order_relaxed);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "OpenList.h"
+
+namespace PathEngine
+{
+	enum NodeState : uint32_t
+	{
+		Unvisited = 0,
+		Open = 1,
+		Closed = 2
+	};
+
+	// Per-cell search state, packed into 16 bytes so that a cache
+	// line holds four of them. f is recomputed from g when needed
+	// and h is never stored. The low two bits of stamp hold the
+	// NodeState, the rest the generation the node was last touched in
+	struct Node
+	{
+		double g;
+		uint32_t parent;
+		uint32_t stamp;
+	};
+
+	static_assert(sizeof(Node) == 16, "Node should stay 16 bytes");
+
+	/*
+	 Reusable memory for searches on grids of the same (or a smaller) size.
+	 Instead of resetting every node before a query, each query gets a new
+	 generation number and a node is only reset the first time the query
+	 touches it, so starting a query is O(1) and the total cost scales with
+	 the number of nodes actually touched.
+	 A context must only be used by one search at a time; give every
+	 thread its own.*/
+	class SearchContext
+	{
+	public:
+		SearchContext();
+
+		// Starts a new query on a grid with cellCount cells
+		void beginQuery(size_t cellCount);
+
+		// The node of a cell, reset to unvisited if the current
+		// query has not touched it yet
+		Node& node(uint32_t index)
+		{
+			Node& n = nodes[index];
+			if ((n.stamp >> StateBits) != generation)
+			{
+				n.g = DBL_MAX;
+				n.stamp = (generation << StateBits) | Unvisited;
+				touched++;
+			}
+			return n;
+		}
+
+		// State of a cell without touching it
+		NodeState state(uint32_t index) const
+		{
+			const Node& n = nodes[index];
+			return (n.stamp >> StateBits) == generation ? NodeState(n.stamp & StateMask) : Unvisited;
+		}
+
+		static NodeState state(const Node& n) { return NodeState(n.stamp & StateMask); }
+		static void setState(Node& n, NodeState s) { n.stamp = (n.stamp & ~StateMask) | s; }
+
+		const Node& at(uint32_t index) const { return nodes[index]; }
+
+		// Number of nodes the current query has touched
+		size_t touchedCount() const { return touched; }
+
+		IndexedDaryHeap<4>& heap() { return heapList; }
+		BucketQueue& bucketQueue() { return bucketList; }
+		SetOpenList& setOpenList() { return setList; }
+
+		// A second context for the backward half of a bidirectional
+		// search, made the first time it is asked for
+		SearchContext& reverse();
+
+		// The two halves (0 and 1) of a bidirectional search run on
+		// different threads and share the claims of the forward context:
+		// a cell belongs to the half that claims it first. prepareClaims
+		// makes room for them after beginQuery
+		void prepareClaims();
+
+		// Claims the cell for half unless the other half already has it,
+		// returns the half that owns it. Safe to call from both threads.
+		// The owner no longer changes the node of a claimed cell
+		unsigned claim(uint32_t index, unsigned half)
+		{
+			uint32_t seen = claims[index].load();
+			const uint32_t mine = (generation << 1) | half;
+
+			if ((seen >> 1) != generation && claims[index].compare_exchange_strong(seen, mine))
+				return half;
+
+			return seen & 1;
+		}
+
+		// The half that owns the cell, or -1
+		int owner(uint32_t index) const
+		{
+			const uint32_t seen = claims[index].load();
+			return (seen >> 1) == generation ? int(seen & 1) : -1;
+		}
+
+	private:
+		static const uint32_t StateBits = 2;
+		static const uint32_t StateMask = (1u << StateBits) - 1;
+		static const uint32_t MaxGeneration = (1u << (32 - StateBits)) - 1;
+
+		std::vector<Node> nodes;
+		uint32_t generation;
+		size_t touched;
+
+		IndexedDaryHeap<4> heapList;
+		BucketQueue bucketList;
+		SetOpenList setList;
+
+		// The generation a cell was last claimed in and by which half
+		std::unique_ptr<std::atomic<uint32_t>[]> claims;
+		size_t claimCount;
+
+		std::unique_ptr<SearchContext> reverseContext;
+	};
+}
@@ -0,0 +1,223 @@
+#include "SearchStats.h"
+
+#include <atomic>
+#include <cfloat>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+
+namespace PathEngine
+{
+	namespace
+	{
+		const size_t slowQueryCount = 64;
+
+		struct Registry
+		{
+			Registry() : slowThreshold(DBL_MAX) { reset(); }
+
+			void reset()
+			{
+				queries = 0;
+				found = 0;
+				expanded = 0;
+				generated = 0;
+				reinserted = 0;
+				searchNanos = 0;
+				reconstructNanos = 0;
+
+				for (int i = 0; i < SearchStatistics::Buckets; i++)
+				{
+					expandedHistogram[i] = 0;
+					microsHistogram[i] = 0;
+				}
+
+				std::lock_guard<std::mutex> lock(slowMutex);
+				slowQueries.clear();
+			}
+
+			std::atomic<uint64_t> queries;
+			std::atomic<uint64_t> found;
+			std::atomic<uint64_t> expanded;
+			std::atomic<uint64_t> generated;
+			std::atomic<uint64_t> reinserted;
+
+			// Times are summed as integers, atomic doubles can not be added to
+			std::atomic<uint64_t> searchNanos;
+			std::atomic<uint64_t> reconstructNanos;
+
+			std::atomic<uint64_t> expandedHistogram[SearchStatistics::Buckets];
+			std::atomic<uint64_t> microsHistogram[SearchStatistics::Buckets];
+
+			std::atomic<double> slowThreshold;
+			std::mutex slowMutex;
+			std::deque<SlowQuery> slowQueries;
+		};
+
+		Registry& registry()
+		{
+			static Registry instance;
+			return instance;
+		}
+
+#if PATHENGINE_STATS
+		// Only recording needs it, and that is compiled out without stats
+		int bucket(double value)
+		{
+			if (value < 1.0)
+				return 0;
+
+			if (value >= double(uint64_t(1) << (SearchStatistics::Buckets - 2)))
+				return SearchStatistics::Buckets - 1;
+
+			return highestBit(uint64_t(value)) + 1;
+		}
+#endif
+
+		// Upper end of a bucket, as the "le" label of a Prometheus bucket
+		double bucketLimit(int i)
+		{
+			return i == 0 ? 1.0 : double(uint64_t(1) << i);
+		}
+
+		void appendHistogram(std::string& text, const char* name, const char* help, const uint64_t* histogram, uint64_t count, double sum)
+		{
+			char line[160];
+
+			std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+			text += line;
+
+			uint64_t cumulative = 0;
+			for (int i = 0; i < SearchStatistics::Buckets - 1; i++)
+			{
+				cumulative += histogram[i];
+				std::snprintf(line, sizeof(line), "%s_bucket{le=\"%.0f\"} %llu\n", name, bucketLimit(i), (unsigned long long)cumulative);
+				text += line;
+			}
+
+			std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.3f\n%s_count %llu\n",
+				name, (unsigned long long)count, name, sum, name, (unsigned long long)count);
+			text += line;
+		}
+
+		void appendCounter(std::string& text, const char* name, const char* help, double value)
+		{
+			char line[160];
+			std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %.0f\n", name, help, name, name, value);
+			text += line;
+		}
+	}
+
+	double SearchStatistics::percentile(const uint64_t* histogram, double fraction)
+	{
+		uint64_t total = 0;
+		for (int i = 0; i < Buckets; i++)
+			total += histogram[i];
+
+		if (total == 0)
+			return 0.0;
+
+		const double wanted = fraction * double(total);
+		uint64_t seen = 0;
+
+		for (int i = 0; i < Buckets; i++)
+		{
+			seen += histogram[i];
+			if (double(seen) >= wanted)
+				return bucketLimit(i);
+		}
+
+		return bucketLimit(Buckets - 1);
+	}
+
+	bool searchStatisticsEnabled()
+	{
+		return PATHENGINE_STATS != 0;
+	}
+
+	SearchStatistics searchStatistics()
+	{
+		Registry& r = registry();
+		SearchStatistics statistics;
+
+		statistics.queries = r.queries.load(std::memory_order_relaxed);
+		statistics.found = r.found.load(std::memory_order_relaxed);
+		statistics.expanded = r.expanded.load(std::memory_order_relaxed);
+		statistics.generated = r.generated.load(std::memory_order_relaxed);
+		statistics.reinserted = r.reinserted.load(std::memory_order_relaxed);
+		statistics.searchMicros = double(r.searchNanos.load(std::memory_order_relaxed)) / 1000.0;
+		statistics.reconstructMicros = double(r.reconstructNanos.load(std::memory_order_relaxed)) / 1000.0;
+
+		for (int i = 0; i < SearchStatistics::Buckets; i++)
+		{
+			statistics.expandedHistogram[i] = r.expandedHistogram[i].load(std::memory_order_relaxed);
+			statistics.microsHistogram[i] = r.microsHistogram[i].load(std::memory_order_relaxed);
+		}
+
+		std::lock_guard<std::mutex> lock(r.slowMutex);
+		statistics.slowQueries.assign(r.slowQueries.begin(), r.slowQueries.end());
+		return statistics;
+	}
+
+	void resetSearchStatistics()
+	{
+		registry().reset();
+	}
+
+	void setSlowQueryThreshold(double micros)
+	{
+		registry().slowThreshold.store(micros);
+	}
+
+	std::string formatSearchStatistics(const SearchStatistics& statistics)
+	{
+		std::string text;
+
+		appendCounter(text, "pathengine_queries_total", "Searches run.", double(statistics.queries));
+		appendCounter(text, "pathengine_found_total", "Searches that found a path.", double(statistics.found));
+		appendCounter(text, "pathengine_generated_total", "Cells put on the open list.", double(statistics.generated));
+		appendCounter(text, "pathengine_reinserted_total", "Cells put on the open list again with a lower cost.", double(statistics.reinserted));
+		appendCounter(text, "pathengine_reconstruct_microseconds_total", "Time spent tracing paths back.", statistics.reconstructMicros);
+
+		appendHistogram(text, "pathengine_expanded_cells", "Cells expanded per search.",
+			statistics.expandedHistogram, statistics.queries, double(statistics.expanded));
+		appendHistogram(text, "pathengine_search_microseconds", "Time per search.",
+			statistics.microsHistogram, statistics.queries, statistics.searchMicros);
+
+		return text;
+	}
+
+	void recordSearch(Pair src, Pair dest, const SearchResult& result)
+	{
+#if PATHENGINE_STATS
+		Registry& r = registry();
+
+		r.queries.fetch_add(1, std::memory_order_relaxed);
+		if (result.found())
+			r.found.fetch_add(1, std::memory_order_relaxed);
+
+		r.expanded.fetch_add(result.expanded, std::memory_order_relaxed);
+		r.generated.fetch_add(result.generated, std::memory_order_relaxed);
+		r.reinserted.fetch_add(result.reinserted, std::memory_order_relaxed);
+		r.searchNanos.fetch_add(uint64_t(result.searchMicros * 1000.0), std::memory_order_relaxed);
+		r.reconstructNanos.fetch_add(uint64_t(result.reconstructMicros * 1000.0), std::memory_order_relaxed);
+
+		r.expandedHistogram[bucket(double(result.expanded))].fetch_add(1, std::memory_order_relaxed);
+		r.microsHistogram[bucket(result.searchMicros)].fetch_add(1, std::memory_order_relaxed);
+
+		if (result.searchMicros > r.slowThreshold.load(std::memory_order_relaxed))
+		{
+			SlowQuery slow = { src, dest, result.status, result.expanded, result.reinserted, result.peakOpen, result.searchMicros };
+
+			std::lock_guard<std::mutex> lock(r.slowMutex);
+			r.slowQueries.push_back(slow);
+			if (r.slowQueries.size() > slowQueryCount)
+				r.slowQueries.pop_front();
+		}
+#else
+		(void)src;
+		(void)dest;
+		(void)result;
+#endif
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AStarSearch.h"
+
+// Build the engine with PATHENGINE_STATS=0 to compile the statistics
+// out: nothing is counted or timed in the searches and the aggregate
+// below stays empty. The fields of SearchResult exist either way, so
+// code using the engine does not have to be built the same way
+#ifndef PATHENGINE_STATS
+#define PATHENGINE_STATS 1
+#endif
+
+#if PATHENGINE_STATS
+#define PATHENGINE_STAT(statement) statement
+#else
+#define PATHENGINE_STAT(statement)
+#endif
+
+namespace PathEngine
+{
+	// Measures a part of a query, a no-op when statistics are compiled out
+	class StatsTimer
+	{
+	public:
+#if PATHENGINE_STATS
+		StatsTimer() : start(std::chrono::steady_clock::now()) {}
+
+		double elapsedMicros() const
+		{
+			return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point start;
+#else
+		double elapsedMicros() const { return 0.0; }
+#endif
+	};
+
+	// A query that took longer than the slow query threshold
+	struct SlowQuery
+	{
+		Pair src;
+		Pair dest;
+		SearchStatus status;
+		size_t expanded;
+		size_t reinserted;
+		size_t peakOpen;
+		double micros;
+	};
+
+	/*
+	 Totals over every aStarSearch since the start or the last reset,
+	 from all threads. Queries are counted with a few relaxed atomic adds
+	 each, and only slow queries take a lock.
+	 The histograms count queries by cells expanded and by microseconds
+	 taken: bucket 0 holds values below 1, bucket i values in
+	 [2^(i-1), 2^i), and the last bucket everything larger.*/
+	struct SearchStatistics
+	{
+		static const int Buckets = 32;
+
+		uint64_t queries = 0;
+		uint64_t found = 0;
+		uint64_t expanded = 0;
+		uint64_t generated = 0;
+		uint64_t reinserted = 0;
+		double searchMicros = 0.0;
+		double reconstructMicros = 0.0;
+
+		uint64_t expandedHistogram[Buckets] = {};
+		uint64_t microsHistogram[Buckets] = {};
+
+		// The latest slow queries, oldest first
+		std::vector<SlowQuery> slowQueries;
+
+		// Upper end of the bucket that holds the given fraction of the
+		// queries, 0.99 for the 99th percentile
+		static double percentile(const uint64_t* histogram, double fraction);
+	};
+
+	// False when the engine was built with PATHENGINE_STATS=0
+	bool searchStatisticsEnabled();
+
+	SearchStatistics searchStatistics();
+	void resetSearchStatistics();
+
+	// Queries taking longer are kept in SearchStatistics::slowQueries,
+	// the last 64 of them. None are kept until a threshold is set
+	void setSlowQueryThreshold(double micros);
+
+	// The statistics in the Prometheus text format, for a metrics endpoint
+	std::string formatSearchStatistics(const SearchStatistics& statistics);
+
+	// Adds a finished query to the totals, aStarSearch calls it
+	void recordSearch(Pair src, Pair dest, const SearchResult& result);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace PathEngine
+{
+	/*
+	 A bounded queue between exactly one producer thread and one consumer
+	 thread, without locks. The slots are a ring whose size is a power of
+	 two; the producer only writes tail and the consumer only writes
+	 head, each on a cache line of its own so the two threads do not
+	 fight over it. A value pushed is visible to the consumer with
+	 everything the producer wrote before pushing it.*/
+	template <class T>
+	class SpscQueue
+	{
+	public:
+		// Holds at least capacity values
+		explicit SpscQueue(size_t capacity)
+			: head(0), tail(0)
+		{
+			size_t size = 2;
+			while (size < capacity)
+				size *= 2;
+
+			slots.resize(size);
+			mask = size - 1;
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		size_t capacity() const { return slots.size(); }
+
+		// Producer only, false when the queue is full
+		bool tryPush(const T& value)
+		{
+			const size_t back = tail.load(std::memory_order_relaxed);
+			if (back - head.load(std::memory_order_acquire) == slots.size())
+				return false;
+
+			slots[back & mask] = value;
+			tail.store(back + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only, false when the queue is empty
+		bool tryPop(T& value)
+		{
+			const size_t front = head.load(std::memory_order_relaxed);
+			if (front == tail.load(std::memory_order_acquire))
+				return false;
+
+			value = slots[front & mask];
+			head.store(front + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		std::vector<T> slots;
+		size_t mask;
+
+		alignas(64) std::atomic<size_t> head;
+		alignas(64) std::atomic<size_t> tail;
+	};
+}
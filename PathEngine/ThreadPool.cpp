@@ -0,0 +1,145 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace PathEngine
+{
+	namespace
+	{
+		// The pool a worker thread belongs to and its number in it
+		thread_local const ThreadPool* currentPool = nullptr;
+		thread_local unsigned currentWorker = 0;
+	}
+
+	ThreadPool::ThreadPool(unsigned threadCount)
+		: jobId(0), pendingRanges(0), stopping(false)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		for (unsigned i = 0; i < threadCount; i++)
+			queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+
+		for (unsigned i = 0; i < threadCount; i++)
+			workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			stopping = true;
+		}
+		jobReady.notify_all();
+
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, unsigned)>& task)
+	{
+		if (count == 0)
+			return;
+
+		grain = std::max<size_t>(grain, 1);
+
+		// Nested in one of this pool's own tasks: the other workers are
+		// busy with the outer job, or waiting on the caller
+		if (inWorker())
+		{
+			for (size_t begin = 0; begin < count; begin += grain)
+				task(begin, std::min(count, begin + grain), currentWorker);
+			return;
+		}
+
+		std::lock_guard<std::mutex> run(runMutex);
+
+		const size_t rangeCount = (count + grain - 1) / grain;
+		const size_t workerCount = workers.size();
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			pendingRanges = rangeCount;
+		}
+
+		// Every worker starts with a contiguous block of the ranges, so
+		// neighbouring indices stay on one thread unless they get stolen
+		for (size_t w = 0; w < workerCount; w++)
+		{
+			size_t first = rangeCount * w / workerCount;
+			size_t last = rangeCount * (w + 1) / workerCount;
+
+			std::lock_guard<std::mutex> lock(queues[w]->mutex);
+			for (size_t r = first; r < last; r++)
+				queues[w]->ranges.push_back(Range{ r * grain, std::min(count, (r + 1) * grain), &task });
+		}
+
+		std::unique_lock<std::mutex> lock(jobMutex);
+		jobId++;
+		jobReady.notify_all();
+		jobDone.wait(lock, [this] { return pendingRanges == 0; });
+	}
+
+	bool ThreadPool::inWorker() const
+	{
+		return currentPool == this;
+	}
+
+	// Own queue from the back, then the other queues from the front
+	bool ThreadPool::takeRange(unsigned worker, Range& range)
+	{
+		{
+			WorkQueue& own = *queues[worker];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.ranges.empty())
+			{
+				range = own.ranges.back();
+				own.ranges.pop_back();
+				return true;
+			}
+		}
+
+		const size_t workerCount = queues.size();
+		for (size_t i = 1; i < workerCount; i++)
+		{
+			WorkQueue& victim = *queues[(worker + i) % workerCount];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.ranges.empty())
+			{
+				range = victim.ranges.front();
+				victim.ranges.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ThreadPool::workerLoop(unsigned worker)
+	{
+		size_t seenJob = 0;
+		currentPool = this;
+		currentWorker = worker;
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(jobMutex);
+				jobReady.wait(lock, [&] { return stopping || jobId != seenJob; });
+				if (stopping)
+					return;
+				seenJob = jobId;
+			}
+
+			Range range;
+			while (takeRange(worker, range))
+			{
+				(*range.task)(range.begin, range.end, worker);
+
+				std::lock_guard<std::mutex> lock(jobMutex);
+				if (--pendingRanges == 0)
+					jobDone.notify_all();
+			}
+		}
+	}
+}
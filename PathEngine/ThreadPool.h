@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PathEngine
+{
+	/*
+	 A fixed set of worker threads that run index ranges in parallel.
+	 Each worker has its own queue of ranges and takes work from the back
+	 of it; a worker whose queue is empty steals from the front of the
+	 others, so uneven ranges (long and short queries) still keep every
+	 core busy. Only one parallelFor runs at a time. One called from a
+	 task of the pool, which would wait for workers that are all busy
+	 with the outer one, runs its ranges on the calling worker instead.*/
+	class ThreadPool
+	{
+	public:
+		// 0 threads means one per hardware thread
+		explicit ThreadPool(unsigned threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		unsigned threadCount() const { return unsigned(workers.size()); }
+
+		// Calls task(begin, end, worker) over [0, count) in ranges of at
+		// most grain indices and returns when all of them are done.
+		// worker is in [0, threadCount()) and no two ranges run on the
+		// same worker at once, so it can index per-thread state
+		void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, unsigned)>& task);
+
+		// Whether the calling thread is one of the workers of this pool
+		bool inWorker() const;
+
+	private:
+		// A range carries its task, so a worker that wakes up late can
+		// never run one job's range with another job's task
+		struct Range
+		{
+			size_t begin, end;
+			const std::function<void(size_t, size_t, unsigned)>* task;
+		};
+
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<Range> ranges;
+		};
+
+		void workerLoop(unsigned worker);
+		bool takeRange(unsigned worker, Range& range);
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+
+		std::mutex jobMutex;
+		std::condition_variable jobReady;
+		std::condition_variable jobDone;
+		size_t jobId;
+		size_t pendingRanges;
+		bool stopping;
+
+		std::mutex runMutex;
+	};
+}